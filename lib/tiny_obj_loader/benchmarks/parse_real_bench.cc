@@ -0,0 +1,252 @@
+//
+// Floats/s of the number parser on `v`/`vn`/`vt` style tokens.
+//
+// Compares tryParseReal() with the digit-by-digit tryParseDouble() it
+// replaced(copied below as baselineTryParseDouble()) and with strtod().
+// The token sets are "%.6f", "%e" and "%.9f" of random coordinates, or the
+// numbers of the `v`, `vn` and `vt` lines of an .obj given on the command
+// line(e.g. written by gen_obj).
+//
+// Usage: parse_real_bench [file.obj]
+// Built with -DTINYOBJLOADER_BUILD_BENCHMARKS=On; use a Release build.
+//
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// tryParseDouble() of the loader before correctly rounded parsing.
+bool baselineTryParseDouble(const char *s, const char *s_end, double *result) {
+  if (s >= s_end) {
+    return false;
+  }
+
+  double mantissa = 0.0;
+  int exponent = 0;
+  char sign = '+';
+  char exp_sign = '+';
+  char const *curr = s;
+  int read = 0;
+  bool end_not_reached = false;
+
+  if (*curr == '+' || *curr == '-') {
+    sign = *curr;
+    curr++;
+  } else if (IS_DIGIT(*curr)) { /* Pass through. */
+  } else {
+    goto fail;
+  }
+
+  end_not_reached = (curr != s_end);
+  while (end_not_reached && IS_DIGIT(*curr)) {
+    mantissa *= 10;
+    mantissa += static_cast<int>(*curr - 0x30);
+    curr++;
+    read++;
+    end_not_reached = (curr != s_end);
+  }
+
+  if (read == 0) goto fail;
+  if (!end_not_reached) goto assemble;
+
+  if (*curr == '.') {
+    curr++;
+    read = 1;
+    end_not_reached = (curr != s_end);
+    while (end_not_reached && IS_DIGIT(*curr)) {
+      static const double pow_lut[] = {
+          1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001,
+      };
+      const int lut_entries = sizeof pow_lut / sizeof pow_lut[0];
+      mantissa += static_cast<int>(*curr - 0x30) *
+                  (read < lut_entries ? pow_lut[read] : std::pow(10.0, -read));
+      read++;
+      curr++;
+      end_not_reached = (curr != s_end);
+    }
+  } else if (*curr == 'e' || *curr == 'E') {
+  } else {
+    goto assemble;
+  }
+
+  if (!end_not_reached) goto assemble;
+
+  if (*curr == 'e' || *curr == 'E') {
+    curr++;
+    end_not_reached = (curr != s_end);
+    if (end_not_reached && (*curr == '+' || *curr == '-')) {
+      exp_sign = *curr;
+      curr++;
+    } else if (IS_DIGIT(*curr)) { /* Pass through. */
+    } else {
+      goto fail;
+    }
+
+    read = 0;
+    end_not_reached = (curr != s_end);
+    while (end_not_reached && IS_DIGIT(*curr)) {
+      exponent *= 10;
+      exponent += static_cast<int>(*curr - 0x30);
+      curr++;
+      read++;
+      end_not_reached = (curr != s_end);
+    }
+    exponent *= (exp_sign == '+' ? 1 : -1);
+    if (read == 0) goto fail;
+  }
+
+assemble:
+  *result = (sign == '+' ? 1 : -1) *
+            (exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent)
+                      : mantissa);
+  return true;
+fail:
+  return false;
+}
+
+// Tokens stored back to back, each followed by a space.
+struct token_set_t {
+  std::string name;
+  std::string text;
+  std::vector<size_t> begin;
+  std::vector<size_t> end;
+};
+
+void AddToken(token_set_t *set, const char *token, size_t len) {
+  set->begin.push_back(set->text.size());
+  set->text.append(token, len);
+  set->end.push_back(set->text.size());
+  set->text += ' ';
+}
+
+void MakeTokenSet(const char *name, const char *format, size_t count,
+                  token_set_t *set) {
+  set->name = name;
+  unsigned long long state = 88172645463325252ULL;
+  char buf[64];
+  for (size_t i = 0; i < count; i++) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    // Coordinates within +-100, as in typical models.
+    double value = (double(state >> 11) / 9007199254740992.0 - 0.5) * 200.0;
+    int len = snprintf(buf, sizeof(buf), format, value);
+    AddToken(set, buf, size_t(len));
+  }
+}
+
+// Numbers of the `v`, `vn` and `vt` lines of `filename`.
+bool ReadTokenSet(const char *filename, token_set_t *set) {
+  std::ifstream ifs(filename);
+  if (!ifs) {
+    return false;
+  }
+  set->name = filename;
+  std::string line;
+  while (std::getline(ifs, line)) {
+    if ((line.size() < 2) || (line[0] != 'v')) {
+      continue;
+    }
+    size_t p = line.find(' ');
+    while (p != std::string::npos) {
+      size_t b = line.find_first_not_of(" \r", p);
+      if (b == std::string::npos) {
+        break;
+      }
+      p = line.find_first_of(" \r", b);
+      size_t e = (p == std::string::npos) ? line.size() : p;
+      AddToken(set, line.data() + b, e - b);
+    }
+  }
+  return !set->begin.empty();
+}
+
+template <typename T>
+struct parse_real_t {
+  static bool parse(const char *s, const char *s_end, T *result) {
+    return tinyobj::tryParseReal(s, s_end, result);
+  }
+};
+
+struct parse_baseline_t {
+  static bool parse(const char *s, const char *s_end, double *result) {
+    return baselineTryParseDouble(s, s_end, result);
+  }
+};
+
+struct parse_strtod_t {
+  static bool parse(const char *s, const char *, double *result) {
+    char *end;
+    *result = strtod(s, &end);
+    return end != s;
+  }
+};
+
+// Floats/s of one pass over `set`.
+template <typename Parser, typename T>
+double FloatsPerSecond(const token_set_t &set, double *checksum) {
+  const char *text = set.text.c_str();
+  double sum = 0.0;
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < set.begin.size(); i++) {
+    T value = T(0);
+    Parser::parse(text + set.begin[i], text + set.end[i], &value);
+    sum += double(value);
+  }
+  double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+          .count();
+  *checksum += sum;
+  return double(set.begin.size()) / seconds;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::vector<token_set_t> sets;
+  if (argc > 1) {
+    sets.resize(1);
+    if (!ReadTokenSet(argv[1], &sets[0])) {
+      fprintf(stderr, "No v/vn/vt numbers in %s\n", argv[1]);
+      return EXIT_FAILURE;
+    }
+  } else {
+    const size_t kCount = 1000000;
+    sets.resize(3);
+    MakeTokenSet("%.6f", "%.6f", kCount, &sets[0]);
+    MakeTokenSet("%e", "%e", kCount, &sets[1]);
+    MakeTokenSet("%.9f", "%.9f", kCount, &sets[2]);
+  }
+
+  double checksum = 0.0;
+  printf("%-12s %10s %14s %14s %13s %10s\n", "tokens", "count",
+         "baseline M/s", "double M/s", "float M/s", "strtod M/s");
+  for (size_t i = 0; i < sets.size(); i++) {
+    const token_set_t &set = sets[i];
+    // Best of several passes. The parsers take turns, so that clock changes
+    // during the run affect all of them alike.
+    double best[4] = {0.0, 0.0, 0.0, 0.0};
+    for (int pass = 0; pass < 9; pass++) {
+      double rate[4];
+      rate[0] = FloatsPerSecond<parse_baseline_t, double>(set, &checksum);
+      rate[1] = FloatsPerSecond<parse_real_t<double>, double>(set, &checksum);
+      rate[2] = FloatsPerSecond<parse_real_t<float>, float>(set, &checksum);
+      rate[3] = FloatsPerSecond<parse_strtod_t, double>(set, &checksum);
+      for (int k = 0; k < 4; k++) {
+        best[k] = (rate[k] > best[k]) ? rate[k] : best[k];
+      }
+    }
+    printf("%-12s %10zu %14.1f %14.1f %13.1f %10.1f\n", set.name.c_str(),
+           set.begin.size(), best[0] * 1e-6, best[1] * 1e-6, best[2] * 1e-6,
+           best[3] * 1e-6);
+  }
+  printf("(checksum %g)\n", checksum);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,376 @@
+//
+// Triangles/s of polygon triangulation, without parsing.
+//
+// The faces are built in memory and passed straight to
+// exportFaceGroupToShape(), as the loader does with `triangulate`, and to
+// TriangulateShape() for the same faces loaded without triangulation. The
+// ear clipper they replaced(copied below as
+// baselineExportFaceGroupToShape()) is timed on the same faces.
+//
+// Polygons: convex and concave(dart) quads, convex 32- and 1024-gons and
+// stars of 128 and 8192 corners, on a tilted plane. TriangulateShape()
+// is not timed for faces of more than 255 vertices, which the loader always
+// triangulates.
+//
+// Usage: triangulate_bench
+// Built with -DTINYOBJLOADER_BUILD_BENCHMARKS=On; use a Release build.
+//
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+using tinyobj::index_t;
+using tinyobj::real_t;
+using tinyobj::shape_t;
+using tinyobj::tag_t;
+using tinyobj::vertex_index_t;
+
+// Face of the loader before faces were stored as offsets into one array.
+struct baseline_face_t {
+  unsigned int smoothing_group_id;
+  std::vector<vertex_index_t> vertex_indices;
+};
+
+// code from https://wrf.ecse.rpi.edu//Research/Short_Notes/pnpoly.html
+template <typename T>
+int pnpoly(int nvert, T *vertx, T *verty, T testx, T testy) {
+  int i, j, c = 0;
+  for (i = 0, j = nvert - 1; i < nvert; j = i++) {
+    if (((verty[i] > testy) != (verty[j] > testy)) &&
+        (testx <
+         (vertx[j] - vertx[i]) * (testy - verty[i]) / (verty[j] - verty[i]) +
+             vertx[i]))
+      c = !c;
+  }
+  return c;
+}
+
+void pushBaselineTriangle(shape_t *shape, const vertex_index_t *ind,
+                          int material_id, unsigned int smoothing_group_id) {
+  for (int k = 0; k < 3; k++) {
+    index_t idx;
+    idx.vertex_index = ind[k].v_idx;
+    idx.normal_index = ind[k].vn_idx;
+    idx.texcoord_index = ind[k].vt_idx;
+    shape->mesh.indices.push_back(idx);
+  }
+  shape->mesh.num_face_vertices.push_back(3);
+  shape->mesh.material_ids.push_back(material_id);
+  shape->mesh.smoothing_group_ids.push_back(smoothing_group_id);
+}
+
+// exportFaceGroupToShape() of the loader before the current triangulator,
+// with `triangulate` = true.
+bool baselineExportFaceGroupToShape(shape_t *shape,
+                                    const std::vector<baseline_face_t> &faces,
+                                    const std::vector<tag_t> &tags,
+                                    const int material_id,
+                                    const std::string &name,
+                                    const std::vector<real_t> &v) {
+  if (faces.empty()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < faces.size(); i++) {
+    const baseline_face_t &face = faces[i];
+
+    if (face.vertex_indices.size() < 3) {
+      // Face must have 3+ vertices.
+      continue;
+    }
+
+    size_t npolys = face.vertex_indices.size();
+
+    // find the two axes to work in
+    size_t axes[2] = {1, 2};
+    for (size_t k = 0; k < npolys; ++k) {
+      size_t vi0 = size_t(face.vertex_indices[(k + 0) % npolys].v_idx);
+      size_t vi1 = size_t(face.vertex_indices[(k + 1) % npolys].v_idx);
+      size_t vi2 = size_t(face.vertex_indices[(k + 2) % npolys].v_idx);
+      real_t e0x = v[vi1 * 3 + 0] - v[vi0 * 3 + 0];
+      real_t e0y = v[vi1 * 3 + 1] - v[vi0 * 3 + 1];
+      real_t e0z = v[vi1 * 3 + 2] - v[vi0 * 3 + 2];
+      real_t e1x = v[vi2 * 3 + 0] - v[vi1 * 3 + 0];
+      real_t e1y = v[vi2 * 3 + 1] - v[vi1 * 3 + 1];
+      real_t e1z = v[vi2 * 3 + 2] - v[vi1 * 3 + 2];
+      real_t cx = std::fabs(e0y * e1z - e0z * e1y);
+      real_t cy = std::fabs(e0z * e1x - e0x * e1z);
+      real_t cz = std::fabs(e0x * e1y - e0y * e1x);
+      const real_t epsilon = std::numeric_limits<real_t>::epsilon();
+      if (cx > epsilon || cy > epsilon || cz > epsilon) {
+        // found a corner
+        if (cx > cy && cx > cz) {
+        } else {
+          axes[0] = 0;
+          if (cz > cx && cz > cy) axes[1] = 1;
+        }
+        break;
+      }
+    }
+
+    real_t area = 0;
+    for (size_t k = 0; k < npolys; ++k) {
+      size_t vi0 = size_t(face.vertex_indices[(k + 0) % npolys].v_idx);
+      size_t vi1 = size_t(face.vertex_indices[(k + 1) % npolys].v_idx);
+      real_t v0x = v[vi0 * 3 + axes[0]];
+      real_t v0y = v[vi0 * 3 + axes[1]];
+      real_t v1x = v[vi1 * 3 + axes[0]];
+      real_t v1y = v[vi1 * 3 + axes[1]];
+      area += (v0x * v1y - v0y * v1x) * static_cast<real_t>(0.5);
+    }
+
+    int maxRounds =
+        10;  // arbitrary max loop count to protect against unexpected errors
+
+    baseline_face_t remainingFace = face;  // copy
+    size_t guess_vert = 0;
+    vertex_index_t ind[3];
+    real_t vx[3];
+    real_t vy[3];
+    while (remainingFace.vertex_indices.size() > 3 && maxRounds > 0) {
+      npolys = remainingFace.vertex_indices.size();
+      if (guess_vert >= npolys) {
+        maxRounds -= 1;
+        guess_vert -= npolys;
+      }
+      for (size_t k = 0; k < 3; k++) {
+        ind[k] = remainingFace.vertex_indices[(guess_vert + k) % npolys];
+        size_t vi = size_t(ind[k].v_idx);
+        vx[k] = v[vi * 3 + axes[0]];
+        vy[k] = v[vi * 3 + axes[1]];
+      }
+      real_t e0x = vx[1] - vx[0];
+      real_t e0y = vy[1] - vy[0];
+      real_t e1x = vx[2] - vx[1];
+      real_t e1y = vy[2] - vy[1];
+      real_t cross = e0x * e1y - e0y * e1x;
+      // if an internal angle
+      if (cross * area < static_cast<real_t>(0.0)) {
+        guess_vert += 1;
+        continue;
+      }
+
+      // check all other verts in case they are inside this triangle
+      bool overlap = false;
+      for (size_t otherVert = 3; otherVert < npolys; ++otherVert) {
+        size_t ovi = size_t(
+            remainingFace.vertex_indices[(guess_vert + otherVert) % npolys]
+                .v_idx);
+        real_t tx = v[ovi * 3 + axes[0]];
+        real_t ty = v[ovi * 3 + axes[1]];
+        if (pnpoly(3, vx, vy, tx, ty)) {
+          overlap = true;
+          break;
+        }
+      }
+
+      if (overlap) {
+        guess_vert += 1;
+        continue;
+      }
+
+      // this triangle is an ear
+      pushBaselineTriangle(shape, ind, material_id, face.smoothing_group_id);
+
+      // remove v1 from the list
+      size_t removed_vert_index = (guess_vert + 1) % npolys;
+      while (removed_vert_index + 1 < npolys) {
+        remainingFace.vertex_indices[removed_vert_index] =
+            remainingFace.vertex_indices[removed_vert_index + 1];
+        removed_vert_index += 1;
+      }
+      remainingFace.vertex_indices.pop_back();
+    }
+
+    if (remainingFace.vertex_indices.size() == 3) {
+      pushBaselineTriangle(shape, &remainingFace.vertex_indices[0],
+                           material_id, face.smoothing_group_id);
+    }
+  }
+
+  shape->name = name;
+  shape->mesh.tags = tags;
+
+  return true;
+}
+
+// The same polygon repeated, in the layouts of the loader and the baseline.
+struct polygon_set_t {
+  const char *name;
+  size_t num_corners;
+  size_t num_faces;
+  std::vector<real_t> v;
+  tinyobj::face_vector_t faces;
+  tinyobj::vertex_index_vector_t face_indices;
+  std::vector<baseline_face_t> baseline_faces;
+  shape_t polygons;  // Loaded with `triangulate` = false.
+};
+
+void MakePolygonSet(const char *name, const double *x, const double *y,
+                    size_t n, polygon_set_t *set) {
+  set->name = name;
+  set->num_corners = n;
+  // Roughly 100k triangles per face group.
+  set->num_faces = (n - 2 < 100000) ? (100000 / (n - 2)) : 1;
+
+  // A plane tilted about the x axis, so the projection axes matter.
+  const double kTilt = 0.3;
+  for (size_t k = 0; k < n; k++) {
+    set->v.push_back(real_t(x[k]));
+    set->v.push_back(real_t(y[k] * std::cos(kTilt)));
+    set->v.push_back(real_t(y[k] * std::sin(kTilt) + 0.25));
+  }
+
+  baseline_face_t baseline_face;
+  baseline_face.smoothing_group_id = 0;
+  for (size_t k = 0; k < n; k++) {
+    baseline_face.vertex_indices.push_back(vertex_index_t(int(k), -1, -1));
+  }
+  for (size_t i = 0; i < set->num_faces; i++) {
+    tinyobj::face_t face;
+    face.num_vertices = static_cast<unsigned int>(n);
+    face.vertex_offset = set->face_indices.size();
+    set->faces.push_back(face);
+    set->face_indices.insert(set->face_indices.end(),
+                             baseline_face.vertex_indices.begin(),
+                             baseline_face.vertex_indices.end());
+    set->baseline_faces.push_back(baseline_face);
+  }
+
+  const std::vector<tag_t> tags;
+  tinyobj::exportFaceGroupToShape(&set->polygons, set->faces,
+                                  set->face_indices, 0, set->faces.size(),
+                                  tags, 0, name, false, false, set->v, 0, NULL);
+}
+
+void MakeQuadSet(const char *name, const double (*quad)[2],
+                 polygon_set_t *set) {
+  double x[4], y[4];
+  for (int k = 0; k < 4; k++) {
+    x[k] = quad[k][0];
+    y[k] = quad[k][1];
+  }
+  MakePolygonSet(name, x, y, 4, set);
+}
+
+// A circle of n corners, or a star of n / 2 points.
+void MakeRoundSet(const char *name, size_t n, bool star, polygon_set_t *set) {
+  const double kPi = 3.14159265358979323846;
+  std::vector<double> x(n), y(n);
+  for (size_t k = 0; k < n; k++) {
+    double a = 2.0 * kPi * double(k) / double(n);
+    double r = (star && (k % 2)) ? 0.5 : 1.0;
+    x[k] = r * std::cos(a);
+    y[k] = r * std::sin(a);
+  }
+  MakePolygonSet(name, &x[0], &y[0], n, set);
+}
+
+enum triangulator_t { BASELINE, EXPORT, TRIANGULATE_SHAPE };
+
+// Triangulates the face group of `set` once. Only the triangulation itself
+// is timed; returns the number of triangles.
+size_t Triangulate(const polygon_set_t &set, triangulator_t triangulator,
+                   double *seconds) {
+  const std::vector<tag_t> tags;
+  tinyobj::attrib_t attrib;
+  shape_t shape;
+  if (triangulator == TRIANGULATE_SHAPE) {
+    attrib.vertices = set.v;
+    shape = set.polygons;
+  }
+
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  if (triangulator == BASELINE) {
+    baselineExportFaceGroupToShape(&shape, set.baseline_faces, tags, 0,
+                                   set.name, set.v);
+  } else if (triangulator == EXPORT) {
+    tinyobj::exportFaceGroupToShape(&shape, set.faces, set.face_indices, 0,
+                                    set.faces.size(), tags, 0, set.name, true,
+                                    false, set.v, 0, NULL);
+  } else {
+    tinyobj::TriangulateShape(attrib, &shape);
+  }
+  *seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                            t0)
+                  .count();
+  return shape.mesh.num_face_vertices.size();
+}
+
+// Triangles/s of triangulating the face group of `set` for at least 0.1s.
+// `*complete` is cleared when a face gave fewer than n - 2 triangles.
+double TrianglesPerSecond(const polygon_set_t &set,
+                          triangulator_t triangulator, bool *complete) {
+  double seconds = 0.0;
+  size_t triangles = 0;
+  do {
+    size_t n = Triangulate(set, triangulator, &seconds);
+    *complete &= (n == set.num_faces * (set.num_corners - 2));
+    triangles += n;
+  } while (seconds < 0.1);
+  return double(triangles) / seconds;
+}
+
+}  // namespace
+
+int main() {
+  static const double kConvexQuad[4][2] = {
+      {0.0, 0.0}, {2.0, 0.1}, {2.2, 1.9}, {-0.1, 2.0}};
+  static const double kConcaveQuad[4][2] = {
+      {0.0, 0.0}, {2.0, 0.0}, {0.5, 0.5}, {0.0, 2.0}};
+
+  std::vector<polygon_set_t> sets(6);
+  MakeQuadSet("convex quad", kConvexQuad, &sets[0]);
+  MakeQuadSet("concave quad", kConcaveQuad, &sets[1]);
+  MakeRoundSet("convex 32-gon", 32, false, &sets[2]);
+  MakeRoundSet("convex 1024-gon", 1024, false, &sets[3]);
+  MakeRoundSet("star 128", 128, true, &sets[4]);
+  MakeRoundSet("star 8192", 8192, true, &sets[5]);
+
+  printf("%-16s %7s %7s %14s %14s %16s\n", "polygon", "corners", "faces",
+         "baseline tri/s", "export tri/s", "Triangulate tri/s");
+  bool all_complete = true;
+  for (size_t i = 0; i < sets.size(); i++) {
+    const polygon_set_t &set = sets[i];
+    const bool shape_timed = set.num_corners <= 255;
+    // Best of several passes. The triangulators take turns, so that clock
+    // changes during the run affect all of them alike.
+    bool complete[3] = {true, true, true};
+    double best[3] = {0.0, 0.0, 0.0};
+    for (int pass = 0; pass < 5; pass++) {
+      for (int t = 0; t < 3; t++) {
+        if ((t == TRIANGULATE_SHAPE) && !shape_timed) {
+          continue;
+        }
+        double rate =
+            TrianglesPerSecond(set, triangulator_t(t), &complete[t]);
+        best[t] = (rate > best[t]) ? rate : best[t];
+      }
+    }
+
+    char columns[3][32];
+    for (int t = 0; t < 3; t++) {
+      if ((t == TRIANGULATE_SHAPE) && !shape_timed) {
+        snprintf(columns[t], sizeof(columns[t]), "-");
+      } else {
+        snprintf(columns[t], sizeof(columns[t]), "%.3g%s", best[t],
+                 complete[t] ? "" : "*");
+      }
+      all_complete &= complete[t];
+    }
+    printf("%-16s %7zu %7zu %14s %14s %16s\n", set.name, set.num_corners,
+           set.num_faces, columns[0], columns[1], columns[2]);
+  }
+  if (!all_complete) {
+    printf("* fewer than n - 2 triangles per face\n");
+  }
+  return EXIT_SUCCESS;
+}
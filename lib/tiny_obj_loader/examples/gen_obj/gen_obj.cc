@@ -0,0 +1,500 @@
+//
+// Writes deterministic synthetic .obj/.mtl files, for measuring how loading
+// and triangulation scale with file size.
+//
+// The same options and seed always give the same bytes: positions come from
+// a fixed xorshift generator, not from rand().
+//
+// Usage: gen_obj -o out.obj [options]  (see Usage() below)
+//
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+enum PolygonKind { POLYGON_CONVEX = 0, POLYGON_CONCAVE, POLYGON_SPIRAL };
+
+const char *const kPolygonKindNames[] = {"convex", "concave", "spiral"};
+
+typedef struct {
+  int value;  // Vertex count or PolygonKind.
+  unsigned int weight;
+} weighted_t;
+
+typedef struct {
+  std::string obj_filename;
+  unsigned long long seed;
+  unsigned long long max_bytes;     // 0 = no limit
+  unsigned long long max_faces;     // 0 = no limit
+  unsigned long long max_vertices;  // 0 = no limit
+  std::vector<weighted_t> ngons;
+  std::vector<weighted_t> kinds;
+  int num_materials;
+  unsigned long long material_every;  // 0 = never switch
+  unsigned long long object_every;    // 0 = no `o`
+  unsigned long long group_every;     // 0 = no `g`
+  bool texcoords;
+  bool normals;
+  bool colors;
+  bool negative_indices;
+  bool crlf;
+} options_t;
+
+// xorshift64*, so that the output does not depend on the C library.
+class Random {
+ public:
+  explicit Random(unsigned long long seed)
+      : state_(seed ? seed : 0x9E3779B97F4A7C15ULL) {}
+
+  unsigned long long Next() {
+    state_ ^= state_ >> 12;
+    state_ ^= state_ << 25;
+    state_ ^= state_ >> 27;
+    return state_ * 0x2545F4914F6CDD1DULL;
+  }
+
+  // [0, 1)
+  double Uniform() {
+    return static_cast<double>(Next() >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  int Pick(const std::vector<weighted_t> &table) {
+    unsigned long long total = 0;
+    for (size_t i = 0; i < table.size(); i++) {
+      total += table[i].weight;
+    }
+    unsigned long long r = Next() % total;
+    for (size_t i = 0; i < table.size(); i++) {
+      if (r < table[i].weight) {
+        return table[i].value;
+      }
+      r -= table[i].weight;
+    }
+    return table.back().value;
+  }
+
+ private:
+  unsigned long long state_;
+};
+
+// Buffered writer that counts the bytes written.
+class Writer {
+ public:
+  Writer(FILE *fp, bool crlf)
+      : fp_(fp), eol_(crlf ? "\r\n" : "\n"), bytes_(0) {}
+
+  // Lines of up to 255 bytes.
+  void Line(const char *format, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (len < 0) {
+      return;
+    }
+    Write(buf, (len < int(sizeof(buf))) ? size_t(len) : sizeof(buf) - 1);
+  }
+
+  void Line(const std::string &line) { Write(line.data(), line.size()); }
+
+  unsigned long long bytes() const { return bytes_; }
+
+ private:
+  void Write(const char *line, size_t len) {
+    fwrite(line, 1, len, fp_);
+    fputs(eol_, fp_);
+    bytes_ += len + strlen(eol_);
+  }
+
+  FILE *fp_;
+  const char *eol_;
+  unsigned long long bytes_;
+};
+
+// Corners of a polygon in its own plane, inside the unit circle.
+// Spirals need 6+ corners and concave polygons 4+; smaller polygons
+// fall back to the next simpler kind.
+int PolygonOutline(Random *rng, int kind, int n, std::vector<double> *xy) {
+  if (kind == POLYGON_SPIRAL && n < 6) {
+    kind = POLYGON_CONCAVE;
+  }
+  if (kind == POLYGON_CONCAVE && n < 4) {
+    kind = POLYGON_CONVEX;
+  }
+
+  xy->resize(size_t(n) * 2);
+  if (kind == POLYGON_SPIRAL) {
+    // Out along one arm of up to 1.5 turns(in steps of at most 60 degrees),
+    // back along a thinner inner arm.
+    const int outer = (n + 1) / 2;
+    const int inner = n - outer;
+    const double turns = std::min(3.0 * kPi, double(outer - 1) * kPi / 3.0);
+    for (int k = 0; k < outer; k++) {
+      double t = double(k) / double(outer - 1);
+      double a = turns * t;
+      double r = 0.2 + 0.8 * t;
+      (*xy)[size_t(k) * 2 + 0] = r * std::cos(a);
+      (*xy)[size_t(k) * 2 + 1] = r * std::sin(a);
+    }
+    for (int k = 0; k < inner; k++) {
+      double t = 1.0 - double(k) / double(inner - 1);
+      double a = turns * t;
+      double r = 0.2 + 0.8 * t - 0.15;
+      (*xy)[size_t(outer + k) * 2 + 0] = r * std::cos(a);
+      (*xy)[size_t(outer + k) * 2 + 1] = r * std::sin(a);
+    }
+  } else {
+    // Corners on a circle stay convex however the angles are jittered, as
+    // long as they keep their order. Concave polygons are regular with every
+    // other corner dented past the chord of its neighbors(quads get one
+    // dent, making a dart).
+    for (int k = 0; k < n; k++) {
+      const bool dent =
+          (kind == POLYGON_CONCAVE) && (k % 2) && (n > 4 || k == 1);
+      double jitter =
+          (kind == POLYGON_CONVEX) ? 0.8 * (rng->Uniform() - 0.5) : 0.0;
+      double a = 2.0 * kPi * (double(k) + jitter) / double(n);
+      double r = 1.0;
+      if (dent) {
+        r = (n == 4) ? -0.3 : 0.5 * std::cos(2.0 * kPi / double(n));
+      }
+      (*xy)[size_t(k) * 2 + 0] = r * std::cos(a);
+      (*xy)[size_t(k) * 2 + 1] = r * std::sin(a);
+    }
+  }
+  return kind;
+}
+
+bool Generate(const options_t &options) {
+  FILE *fp = fopen(options.obj_filename.c_str(), "wb");
+  if (!fp) {
+    fprintf(stderr, "Cannot open %s\n", options.obj_filename.c_str());
+    return false;
+  }
+  std::vector<char> buffer(1 << 20);
+  setvbuf(fp, &buffer[0], _IOFBF, buffer.size());
+  Writer obj(fp, options.crlf);
+
+  Random rng(options.seed);
+
+  if (options.num_materials > 0) {
+    std::string mtl_filename = options.obj_filename;
+    std::string::size_type dot = mtl_filename.find_last_of('.');
+    std::string::size_type slash = mtl_filename.find_last_of("/\\");
+    if (dot != std::string::npos &&
+        (slash == std::string::npos || dot > slash)) {
+      mtl_filename.erase(dot);
+    }
+    mtl_filename += ".mtl";
+
+    FILE *mtl_fp = fopen(mtl_filename.c_str(), "wb");
+    if (!mtl_fp) {
+      fprintf(stderr, "Cannot open %s\n", mtl_filename.c_str());
+      fclose(fp);
+      return false;
+    }
+    Writer mtl(mtl_fp, options.crlf);
+    for (int i = 0; i < options.num_materials; i++) {
+      mtl.Line("newmtl material_%d", i);
+      mtl.Line("Ka 0.000000 0.000000 0.000000");
+      mtl.Line("Kd %.6f %.6f %.6f", rng.Uniform(), rng.Uniform(),
+               rng.Uniform());
+      mtl.Line("Ks %.6f %.6f %.6f", rng.Uniform(), rng.Uniform(),
+               rng.Uniform());
+      mtl.Line("Ns %.6f", 1.0 + 999.0 * rng.Uniform());
+      mtl.Line("d 1.000000");
+      mtl.Line("illum 2");
+      mtl.Line("map_Kd texture_%d.png", i);
+      mtl.Line("");
+    }
+    fclose(mtl_fp);
+
+    std::string::size_type base = mtl_filename.find_last_of("/\\");
+    obj.Line("mtllib %s", base == std::string::npos
+                              ? mtl_filename.c_str()
+                              : mtl_filename.c_str() + base + 1);
+  }
+
+  std::vector<double> xy;
+  unsigned long long faces = 0;
+  unsigned long long vertices = 0;
+  unsigned long long kind_counts[3] = {0, 0, 0};
+  const int grid = 1024;
+  while ((options.max_faces == 0 || faces < options.max_faces) &&
+         (options.max_vertices == 0 || vertices < options.max_vertices) &&
+         (options.max_bytes == 0 || obj.bytes() < options.max_bytes)) {
+    if (options.object_every && (faces % options.object_every) == 0) {
+      obj.Line("o object_%llu", faces / options.object_every);
+    }
+    if (options.group_every && (faces % options.group_every) == 0) {
+      obj.Line("g group_%llu", faces / options.group_every);
+    }
+    if (options.num_materials > 0 &&
+        (faces == 0 || (options.material_every &&
+                        (faces % options.material_every) == 0))) {
+      obj.Line("usemtl material_%d",
+               int(rng.Next() % (unsigned long long)options.num_materials));
+    }
+
+    const int n = rng.Pick(options.ngons);
+    const int kind = PolygonOutline(&rng, rng.Pick(options.kinds), n, &xy);
+    kind_counts[kind]++;
+
+    // Each face gets its own corners, in a tilted plane at its grid cell.
+    const double cx = 2.5 * double(faces % grid);
+    const double cy = 2.5 * double((faces / grid) % grid);
+    const double cz = 2.5 * double(faces / (grid * grid));
+    const double tilt = kPi * (rng.Uniform() - 0.5);
+    const double ct = std::cos(tilt), st = std::sin(tilt);
+    for (int k = 0; k < n; k++) {
+      const double x = xy[size_t(k) * 2 + 0], y = xy[size_t(k) * 2 + 1];
+      if (options.colors) {
+        obj.Line("v %.6f %.6f %.6f %.4f %.4f %.4f", cx + x, cy + y * ct,
+                 cz + y * st, 0.5 + 0.5 * x, 0.5 + 0.5 * y, rng.Uniform());
+      } else {
+        obj.Line("v %.6f %.6f %.6f", cx + x, cy + y * ct, cz + y * st);
+      }
+      if (options.texcoords) {
+        obj.Line("vt %.6f %.6f", 0.5 + 0.5 * x, 0.5 + 0.5 * y);
+      }
+    }
+    if (options.normals) {
+      obj.Line("vn 0.000000 %.6f %.6f", -st, ct);
+    }
+
+    std::string line = "f";
+    char corner[96];
+    for (int k = 0; k < n; k++) {
+      long long v = options.negative_indices
+                        ? -(long long)(n - k)
+                        : (long long)(vertices + 1 + (unsigned long long)k);
+      long long vn = options.negative_indices ? -1 : (long long)(faces + 1);
+      if (options.texcoords && options.normals) {
+        snprintf(corner, sizeof(corner), " %lld/%lld/%lld", v, v, vn);
+      } else if (options.texcoords) {
+        snprintf(corner, sizeof(corner), " %lld/%lld", v, v);
+      } else if (options.normals) {
+        snprintf(corner, sizeof(corner), " %lld//%lld", v, vn);
+      } else {
+        snprintf(corner, sizeof(corner), " %lld", v);
+      }
+      line += corner;
+    }
+    obj.Line(line);
+
+    vertices += (unsigned long long)n;
+    faces++;
+  }
+
+  fclose(fp);
+
+  fprintf(stderr,
+          "%s: %llu bytes, %llu vertices, %llu faces(%llu convex, "
+          "%llu concave, %llu spiral)\n",
+          options.obj_filename.c_str(), obj.bytes(), vertices, faces,
+          kind_counts[POLYGON_CONVEX], kind_counts[POLYGON_CONCAVE],
+          kind_counts[POLYGON_SPIRAL]);
+  return true;
+}
+
+// "10G", "512M", "64k" or a plain number.
+bool ParseSize(const char *s, unsigned long long *size) {
+  char *end = NULL;
+  double value = strtod(s, &end);
+  if (end == s || value < 0) {
+    return false;
+  }
+  double scale = 1;
+  switch (*end) {
+    case 'k':
+    case 'K':
+      scale = 1024.0;
+      end++;
+      break;
+    case 'm':
+    case 'M':
+      scale = 1024.0 * 1024.0;
+      end++;
+      break;
+    case 'g':
+    case 'G':
+      scale = 1024.0 * 1024.0 * 1024.0;
+      end++;
+      break;
+    default:
+      break;
+  }
+  if (*end != '\0') {
+    return false;
+  }
+  *size = (unsigned long long)(value * scale);
+  return true;
+}
+
+// "3:60,4:30,8:10"; a value without weight gets weight 1.
+bool ParseWeights(const char *s, const char *const *names, int num_names,
+                  std::vector<weighted_t> *table) {
+  table->clear();
+  std::string spec(s);
+  size_t begin = 0;
+  while (begin <= spec.size()) {
+    size_t end = spec.find(',', begin);
+    if (end == std::string::npos) {
+      end = spec.size();
+    }
+    std::string item = spec.substr(begin, end - begin);
+    std::string key = item, weight = "1";
+    size_t colon = item.find(':');
+    if (colon != std::string::npos) {
+      key = item.substr(0, colon);
+      weight = item.substr(colon + 1);
+    }
+
+    weighted_t w;
+    w.value = -1;
+    if (names) {
+      for (int i = 0; i < num_names; i++) {
+        if (key == names[i]) {
+          w.value = i;
+        }
+      }
+    } else {
+      w.value = atoi(key.c_str());
+      if (w.value < 3) {
+        w.value = -1;
+      }
+    }
+    w.weight = (unsigned int)strtoul(weight.c_str(), NULL, 10);
+    if (w.value < 0) {
+      return false;
+    }
+    if (w.weight > 0) {
+      table->push_back(w);
+    }
+    begin = end + 1;
+  }
+  return !table->empty();
+}
+
+void Usage() {
+  fprintf(
+      stderr,
+      "Usage: gen_obj -o out.obj [options]\n"
+      "Writes out.obj, and out.mtl with --materials. Stops at the first\n"
+      "limit reached(default: --faces 100000).\n"
+      "  --seed N              Random seed(default 1)\n"
+      "  --size BYTES          Stop at this .obj size, e.g. 512M, 20G\n"
+      "  --faces N             Stop after N faces\n"
+      "  --vertices N          Stop after N vertices\n"
+      "  --ngon SPEC           Corner counts, e.g. 3:50,4:40,8:10"
+      "(default 4)\n"
+      "  --kinds SPEC          Polygon shapes, e.g. convex:90,concave:8,"
+      "spiral:2\n"
+      "                        (default convex)\n"
+      "  --materials N         Number of materials(default 0)\n"
+      "  --material-every N    Switch material every N faces\n"
+      "  --object-every N      Start an object(`o`) every N faces\n"
+      "  --group-every N       Start a group(`g`) every N faces\n"
+      "  --texcoords           Write `vt`\n"
+      "  --normals             Write `vn`\n"
+      "  --colors              Write vertex colors\n"
+      "  --negative-indices    Use relative(negative) indices\n"
+      "  --crlf                Use CRLF line endings\n");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  options_t options;
+  options.seed = 1;
+  options.max_bytes = 0;
+  options.max_faces = 0;
+  options.max_vertices = 0;
+  options.num_materials = 0;
+  options.material_every = 0;
+  options.object_every = 0;
+  options.group_every = 0;
+  options.texcoords = false;
+  options.normals = false;
+  options.colors = false;
+  options.negative_indices = false;
+  options.crlf = false;
+
+  weighted_t quad = {4, 1};
+  options.ngons.push_back(quad);
+  weighted_t convex = {POLYGON_CONVEX, 1};
+  options.kinds.push_back(convex);
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+    bool ok = true;
+    bool takes_value = true;
+    if (strcmp(arg, "-o") == 0 && value) {
+      options.obj_filename = value;
+    } else if (strcmp(arg, "--seed") == 0 && value) {
+      options.seed = strtoull(value, NULL, 10);
+    } else if (strcmp(arg, "--size") == 0 && value) {
+      ok = ParseSize(value, &options.max_bytes);
+    } else if (strcmp(arg, "--faces") == 0 && value) {
+      ok = ParseSize(value, &options.max_faces);
+    } else if (strcmp(arg, "--vertices") == 0 && value) {
+      ok = ParseSize(value, &options.max_vertices);
+    } else if (strcmp(arg, "--ngon") == 0 && value) {
+      ok = ParseWeights(value, NULL, 0, &options.ngons);
+    } else if (strcmp(arg, "--kinds") == 0 && value) {
+      ok = ParseWeights(value, kPolygonKindNames, 3, &options.kinds);
+    } else if (strcmp(arg, "--materials") == 0 && value) {
+      options.num_materials = atoi(value);
+    } else if (strcmp(arg, "--material-every") == 0 && value) {
+      options.material_every = strtoull(value, NULL, 10);
+    } else if (strcmp(arg, "--object-every") == 0 && value) {
+      options.object_every = strtoull(value, NULL, 10);
+    } else if (strcmp(arg, "--group-every") == 0 && value) {
+      options.group_every = strtoull(value, NULL, 10);
+    } else {
+      takes_value = false;
+      if (strcmp(arg, "--texcoords") == 0) {
+        options.texcoords = true;
+      } else if (strcmp(arg, "--normals") == 0) {
+        options.normals = true;
+      } else if (strcmp(arg, "--colors") == 0) {
+        options.colors = true;
+      } else if (strcmp(arg, "--negative-indices") == 0) {
+        options.negative_indices = true;
+      } else if (strcmp(arg, "--crlf") == 0) {
+        options.crlf = true;
+      } else {
+        ok = false;
+      }
+    }
+    if (!ok) {
+      fprintf(stderr, "Invalid argument: %s\n", arg);
+      Usage();
+      return EXIT_FAILURE;
+    }
+    if (takes_value) {
+      i++;
+    }
+  }
+
+  if (options.obj_filename.empty()) {
+    Usage();
+    return EXIT_FAILURE;
+  }
+  if (options.max_bytes == 0 && options.max_faces == 0 &&
+      options.max_vertices == 0) {
+    options.max_faces = 100000;
+  }
+
+  return Generate(options) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
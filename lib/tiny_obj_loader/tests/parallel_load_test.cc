@@ -0,0 +1,380 @@
+//
+// Checks that parsing in parallel chunks gives exactly the output of a
+// single-threaded load: the same attributes, shapes, materials, errors and
+// return value, for every index layout and with or without triangulation.
+//
+// The inputs mix `mtllib`/`usemtl`/`g`/`o`/`s`/`t` lines, faces of 3 to 8
+// vertices with positive and negative indices, vertex colors and a missing
+// material, with LF and CRLF line endings, and one of them has an invalid
+// `f` line. Chunk boundaries thus fall on every kind of line.
+//
+#include "tiny_obj_loader.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+const char *kMtl =
+    "newmtl red\n"
+    "Kd 1 0 0\n"
+    "map_Kd red.png\n"
+    "newmtl green\n"
+    "Kd 0 1 0\n"
+    "newmtl blue\n"
+    "Kd 0 0 1\n"
+    "illum 2\n";
+
+typedef struct {
+  bool ret;
+  std::string err;
+  tinyobj::attrib_t attrib;
+  std::vector<tinyobj::shape_t> shapes;
+  std::vector<tinyobj::material_t> materials;
+} load_result_t;
+
+// Fixed linear congruential generator, so the inputs are the same everywhere.
+class Random {
+ public:
+  explicit Random(unsigned int seed) : state_(seed) {}
+
+  unsigned int Next(unsigned int n) {
+    state_ = state_ * 1664525u + 1013904223u;
+    return (state_ >> 8) % n;
+  }
+
+ private:
+  unsigned int state_;
+};
+
+void AppendLine(std::string *obj, const std::string &line, bool crlf) {
+  *obj += line;
+  *obj += crlf ? "\r\n" : "\n";
+}
+
+std::string MakeObj(bool crlf, bool with_error) {
+  Random rng(12345);
+  std::string obj;
+  char buf[256];
+  int num_v = 0, num_vt = 0, num_vn = 0;
+
+  AppendLine(&obj, "# parallel_load_test", crlf);
+  AppendLine(&obj, "mtllib test.mtl", crlf);
+  const int kNumBlocks = 120;
+  for (int b = 0; b < kNumBlocks; b++) {
+    switch (rng.Next(8)) {
+      case 0:
+        snprintf(buf, sizeof(buf), "o object_%d", b);
+        AppendLine(&obj, buf, crlf);
+        break;
+      case 1:
+        snprintf(buf, sizeof(buf), "g group_%d part_%d", b, b % 3);
+        AppendLine(&obj, buf, crlf);
+        break;
+      case 2:
+        AppendLine(&obj, "g", crlf);
+        break;
+      case 3:
+        AppendLine(&obj, "t crease 2/1/1 1 2 0.5 edge", crlf);
+        break;
+      default:
+        break;
+    }
+    switch (rng.Next(6)) {
+      case 0:
+        AppendLine(&obj, "usemtl red", crlf);
+        break;
+      case 1:
+        AppendLine(&obj, "usemtl green", crlf);
+        break;
+      case 2:
+        AppendLine(&obj, "usemtl blue", crlf);
+        break;
+      case 3:
+        AppendLine(&obj, "usemtl missing", crlf);
+        break;
+      default:
+        break;
+    }
+    switch (rng.Next(4)) {
+      case 0:
+        AppendLine(&obj, "s off", crlf);
+        break;
+      case 1:
+        snprintf(buf, sizeof(buf), "s %d", 1 + int(rng.Next(4)));
+        AppendLine(&obj, buf, crlf);
+        break;
+      default:
+        break;
+    }
+
+    const int num_faces = 1 + int(rng.Next(12));
+    for (int f = 0; f < num_faces; f++) {
+      if (with_error && (b == kNumBlocks * 2 / 3) && (f == 0)) {
+        AppendLine(&obj, "f 0 1 2", crlf);
+      }
+
+      // A ring of n corners, every other one dented when concave.
+      const int n = 3 + int(rng.Next(6));
+      const bool concave = (n > 4) && (rng.Next(3) == 0);
+      const bool colors = (b % 7) == 0;
+      for (int k = 0; k < n; k++) {
+        double a = 2.0 * kPi * k / n;
+        double r = (concave && (k % 2)) ? 0.3 : 1.0;
+        if (colors) {
+          snprintf(buf, sizeof(buf), "v %.6f %.6f %.3f 0.5 0.25 %.2f",
+                   r * std::cos(a) + b, r * std::sin(a), 0.1 * f,
+                   double(k) / n);
+        } else {
+          snprintf(buf, sizeof(buf), "v %.6f %.6f %.3f", r * std::cos(a) + b,
+                   r * std::sin(a), 0.1 * f);
+        }
+        AppendLine(&obj, buf, crlf);
+        snprintf(buf, sizeof(buf), "vt %.4f %.4f", 0.5 + 0.5 * std::cos(a),
+                 0.5 + 0.5 * std::sin(a));
+        AppendLine(&obj, buf, crlf);
+      }
+      AppendLine(&obj, "vn 0 0 1", crlf);
+      num_v += n;
+      num_vt += n;
+      num_vn += 1;
+
+      // Positive or negative indices; v, v/vt, v//vn or v/vt/vn.
+      const bool negative = rng.Next(2) == 0;
+      const unsigned int form = rng.Next(4);
+      std::string line = "f";
+      for (int k = 0; k < n; k++) {
+        int v = negative ? (k - n) : (num_v - n + k + 1);
+        int vt = negative ? (k - n) : (num_vt - n + k + 1);
+        int vn = negative ? -1 : num_vn;
+        if (form == 0) {
+          snprintf(buf, sizeof(buf), " %d", v);
+        } else if (form == 1) {
+          snprintf(buf, sizeof(buf), " %d/%d", v, vt);
+        } else if (form == 2) {
+          snprintf(buf, sizeof(buf), " %d//%d", v, vn);
+        } else {
+          snprintf(buf, sizeof(buf), " %d/%d/%d", v, vt, vn);
+        }
+        line += buf;
+      }
+      AppendLine(&obj, line, crlf);
+    }
+  }
+  return obj;
+}
+
+void Load(const std::string &obj, const tinyobj::load_option_t &option,
+          load_result_t *result) {
+  std::istringstream mtl(kMtl);
+  tinyobj::MaterialStreamReader reader(mtl);
+  result->ret = tinyobj::LoadObjFromMemory(
+      &result->attrib, &result->shapes, &result->materials, &result->err,
+      obj.data(), obj.size(), &reader, option);
+}
+
+// Compares element by element, and bit for bit for reals.
+template <typename T>
+bool SameArray(const std::vector<T> &a, const std::vector<T> &b) {
+  return (a.size() == b.size()) &&
+         (a.empty() || (memcmp(&a[0], &b[0], a.size() * sizeof(T)) == 0));
+}
+
+bool SameIndices(const std::vector<tinyobj::index_t> &a,
+                 const std::vector<tinyobj::index_t> &b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    if ((a[i].vertex_index != b[i].vertex_index) ||
+        (a[i].normal_index != b[i].normal_index) ||
+        (a[i].texcoord_index != b[i].texcoord_index)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SameTags(const std::vector<tinyobj::tag_t> &a,
+              const std::vector<tinyobj::tag_t> &b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    if ((a[i].name != b[i].name) || (a[i].intValues != b[i].intValues) ||
+        !SameArray(a[i].floatValues, b[i].floatValues) ||
+        (a[i].stringValues != b[i].stringValues)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the first field that differs, or NULL.
+const char *FindDifference(const load_result_t &a, const load_result_t &b,
+                           size_t *shape_index) {
+  *shape_index = 0;
+  if (a.ret != b.ret) return "return value";
+  if (a.err != b.err) return "err";
+  if (!SameArray(a.attrib.vertices, b.attrib.vertices)) return "vertices";
+  if (!SameArray(a.attrib.normals, b.attrib.normals)) return "normals";
+  if (!SameArray(a.attrib.texcoords, b.attrib.texcoords)) return "texcoords";
+  if (!SameArray(a.attrib.colors, b.attrib.colors)) return "colors";
+  if (a.attrib.has_colors != b.attrib.has_colors) return "has_colors";
+  if (a.materials.size() != b.materials.size()) return "materials";
+  for (size_t i = 0; i < a.materials.size(); i++) {
+    if (a.materials[i].name != b.materials[i].name) return "material name";
+  }
+  if (a.shapes.size() != b.shapes.size()) return "number of shapes";
+  for (size_t i = 0; i < a.shapes.size(); i++) {
+    const tinyobj::shape_t &sa = a.shapes[i];
+    const tinyobj::shape_t &sb = b.shapes[i];
+    *shape_index = i;
+    if (sa.name != sb.name) return "name";
+    if (!SameIndices(sa.mesh.indices, sb.mesh.indices)) return "indices";
+    if (!SameArray(sa.mesh.vertex_indices, sb.mesh.vertex_indices)) {
+      return "vertex_indices";
+    }
+    if (!SameArray(sa.mesh.normal_indices, sb.mesh.normal_indices)) {
+      return "normal_indices";
+    }
+    if (!SameArray(sa.mesh.texcoord_indices, sb.mesh.texcoord_indices)) {
+      return "texcoord_indices";
+    }
+    if (!SameArray(sa.mesh.vertex_indices16, sb.mesh.vertex_indices16)) {
+      return "vertex_indices16";
+    }
+    if (!SameArray(sa.mesh.normal_indices16, sb.mesh.normal_indices16)) {
+      return "normal_indices16";
+    }
+    if (!SameArray(sa.mesh.texcoord_indices16, sb.mesh.texcoord_indices16)) {
+      return "texcoord_indices16";
+    }
+    if (!SameArray(sa.mesh.num_face_vertices, sb.mesh.num_face_vertices)) {
+      return "num_face_vertices";
+    }
+    if (!SameArray(sa.mesh.material_ids, sb.mesh.material_ids)) {
+      return "material_ids";
+    }
+    if (!SameArray(sa.mesh.smoothing_group_ids, sb.mesh.smoothing_group_ids)) {
+      return "smoothing_group_ids";
+    }
+    if (!SameTags(sa.mesh.tags, sb.mesh.tags)) return "tags";
+  }
+  return NULL;
+}
+
+// A `usemtl` right before an `o` line ends a shape whose faces are already
+// exported. The shape must still be emitted, with its triangles.
+int CheckUsemtlBeforeObject() {
+  const std::string obj =
+      "mtllib test.mtl\n"
+      "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+      "o A\n"
+      "f 1 2 3 4\nf 1 2 3 4\nf 1 2 3 4\n"
+      "usemtl red\n"
+      "o B\n"
+      "f 1 2 3\n";
+
+  const int thread_counts[] = {1, 2, 3, 7, 16};
+  int failures = 0;
+  for (int triangulate = 0; triangulate < 2; triangulate++) {
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(int); t++) {
+      tinyobj::load_option_t option;
+      option.triangulate = (triangulate != 0);
+      option.num_threads = thread_counts[t];
+      load_result_t result;
+      Load(obj, option, &result);
+
+      const size_t faces_a = triangulate ? 6 : 3;
+      const size_t indices_a = triangulate ? 18 : 12;
+      const std::vector<tinyobj::shape_t> &shapes = result.shapes;
+      if (!result.ret || (shapes.size() != 2) || (shapes[0].name != "A") ||
+          (shapes[0].mesh.num_face_vertices.size() != faces_a) ||
+          (shapes[0].mesh.indices.size() != indices_a) ||
+          (shapes[1].name != "B") ||
+          (shapes[1].mesh.num_face_vertices.size() != 1) ||
+          (shapes[1].mesh.indices.size() != 3)) {
+        printf("FAIL: usemtl before o, triangulate %d, %d threads\n",
+               triangulate, option.num_threads);
+        failures++;
+      }
+    }
+  }
+  return failures;
+}
+
+}  // namespace
+
+int main() {
+  const char *input_names[] = {"LF", "CRLF", "LF with error",
+                               "CRLF with error"};
+  std::string inputs[4];
+  inputs[0] = MakeObj(false, false);
+  inputs[1] = MakeObj(true, false);
+  inputs[2] = MakeObj(false, true);
+  inputs[3] = MakeObj(true, true);
+
+  const int thread_counts[] = {2, 3, 7, 16};
+  int failures = 0;
+  int checks = 0;
+  for (int input = 0; input < 4; input++) {
+    for (int layout = 0; layout < 3; layout++) {
+      for (int flags = 0; flags < 4; flags++) {
+        tinyobj::load_option_t option;
+        option.triangulate = (flags & 1) != 0;
+        option.precount = (flags & 2) != 0;
+        option.split_indices = (layout >= 1);
+        option.narrow_indices = (layout == 2);
+
+        load_result_t serial;
+        option.num_threads = 1;
+        Load(inputs[input], option, &serial);
+        if (serial.shapes.empty()) {
+          printf("FAIL: %s: nothing loaded\n", input_names[input]);
+          failures++;
+        }
+        if (serial.ret != (input < 2)) {
+          printf("FAIL: %s: LoadObjFromMemory() returned %d\n",
+                 input_names[input], int(serial.ret));
+          failures++;
+        }
+
+        for (size_t t = 0; t < sizeof(thread_counts) / sizeof(int); t++) {
+          load_result_t parallel;
+          option.num_threads = thread_counts[t];
+          Load(inputs[input], option, &parallel);
+          size_t shape_index;
+          const char *difference =
+              FindDifference(serial, parallel, &shape_index);
+          checks++;
+          if (difference) {
+            printf(
+                "FAIL: %s, triangulate %d, precount %d, split %d, narrow %d, "
+                "%d threads: %s differs(shape %d)\n",
+                input_names[input], int(option.triangulate),
+                int(option.precount), int(option.split_indices),
+                int(option.narrow_indices), option.num_threads, difference,
+                int(shape_index));
+            failures++;
+          }
+        }
+      }
+    }
+  }
+
+  failures += CheckUsemtlBeforeObject();
+
+  if (failures) {
+    printf("%d failures\n", failures);
+    return 1;
+  }
+  printf("OK: %d parallel loads match the single-threaded ones\n", checks);
+  return 0;
+}
@@ -0,0 +1,156 @@
+//
+// Checks that finished shapes are handed over without deep copies.
+//
+// Counts the heap allocations of loading N and 2N shapes through a global
+// operator new. Each shape is built in place and swapped into the output,
+// so the extra N shapes should cost one allocation per mesh array they fill
+// and one for the name list of their `g` line(plus amortized growth of the
+// shared arrays). A copy of a shape at finalization would cost the mesh
+// arrays again.
+//
+#include "tiny_obj_loader.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#if (__cplusplus >= 201103L) || (defined(_MSVC_LANG) && (_MSVC_LANG >= 201103L))
+#define TEST_THROW_BAD_ALLOC
+#define TEST_NOEXCEPT noexcept
+#else
+#define TEST_THROW_BAD_ALLOC throw(std::bad_alloc)
+#define TEST_NOEXCEPT throw()
+#endif
+
+namespace {
+
+bool g_counting = false;
+size_t g_allocations = 0;
+
+void *Allocate(size_t size) {
+  if (g_counting) {
+    g_allocations++;
+  }
+  void *p = malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+}  // namespace
+
+void *operator new(size_t size) TEST_THROW_BAD_ALLOC { return Allocate(size); }
+void *operator new[](size_t size) TEST_THROW_BAD_ALLOC {
+  return Allocate(size);
+}
+void operator delete(void *p) TEST_NOEXCEPT { free(p); }
+void operator delete[](void *p) TEST_NOEXCEPT { free(p); }
+#if defined(__cpp_sized_deallocation)
+void operator delete(void *p, size_t) TEST_NOEXCEPT { free(p); }
+void operator delete[](void *p, size_t) TEST_NOEXCEPT { free(p); }
+#endif
+
+namespace {
+
+const int kTrianglesPerShape = 100;
+
+// `num_shapes` groups of triangles over a shared set of vertices.
+std::string MakeObj(int num_shapes) {
+  std::string obj;
+  char buf[128];
+  for (int k = 0; k < kTrianglesPerShape + 2; k++) {
+    snprintf(buf, sizeof(buf), "v %d 0 %d\nvt 0 %d\n", k, k % 2, k % 2);
+    obj += buf;
+  }
+  obj += "vn 0 1 0\n";
+  for (int i = 0; i < num_shapes; i++) {
+    snprintf(buf, sizeof(buf), "g shape_%d\n", i);
+    obj += buf;
+    for (int k = 1; k <= kTrianglesPerShape; k++) {
+      snprintf(buf, sizeof(buf), "f %d/%d/1 %d/%d/1 %d/%d/1\n", k, k, k + 1,
+               k + 1, k + 2, k + 2);
+      obj += buf;
+    }
+  }
+  return obj;
+}
+
+// Allocations of loading `obj`, or 0 when loading failed.
+size_t CountAllocations(const std::string &obj,
+                        const tinyobj::load_option_t &option,
+                        size_t num_shapes) {
+  tinyobj::attrib_t attrib;
+  std::vector<tinyobj::shape_t> shapes;
+  std::vector<tinyobj::material_t> materials;
+  std::string err;
+  g_allocations = 0;
+  g_counting = true;
+  bool ret = tinyobj::LoadObjFromMemory(&attrib, &shapes, &materials, &err,
+                                        obj.data(), obj.size(), NULL, option);
+  g_counting = false;
+  if (!ret || (shapes.size() != num_shapes)) {
+    return 0;
+  }
+  return g_allocations;
+}
+
+}  // namespace
+
+int main() {
+  const int kNumShapes = 1000;
+  const std::string obj1 = MakeObj(kNumShapes);
+  const std::string obj2 = MakeObj(kNumShapes * 2);
+
+  typedef struct {
+    const char *name;
+    bool triangulate;
+    bool split_indices;
+    bool narrow_indices;
+    int num_arrays;  // Mesh arrays filled per shape.
+  } config_t;
+  const config_t configs[] = {
+      // indices, num_face_vertices, material_ids, smoothing_group_ids
+      {"indices", false, false, false, 4},
+      {"indices, triangulate", true, false, false, 4},
+      // vertex_indices, normal_indices, texcoord_indices and the rest
+      {"split", false, true, false, 6},
+      {"split, triangulate", true, true, false, 6},
+      // The split arrays are built first and then replaced by the 16-bit
+      // ones(num_face_vertices is dropped as all faces are triangles).
+      {"narrow", false, true, true, 9},
+  };
+
+  int failures = 0;
+  for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+    const config_t &config = configs[c];
+    tinyobj::load_option_t option;
+    option.num_threads = 1;
+    option.triangulate = config.triangulate;
+    option.split_indices = config.split_indices;
+    option.narrow_indices = config.narrow_indices;
+
+    const size_t n1 = CountAllocations(obj1, option, kNumShapes);
+    const size_t n2 = CountAllocations(obj2, option, kNumShapes * 2);
+    if (!n1 || !n2) {
+      printf("FAIL: %s: loading failed\n", config.name);
+      failures++;
+      continue;
+    }
+    const double per_shape = double(n2 - n1) / kNumShapes;
+    // One more for the `g` line, and half an allocation per shape of slack
+    // for amortized growth.
+    const int expected = config.num_arrays + 1;
+    const bool ok = per_shape <= expected + 0.5;
+    printf("%s: %s: %zu allocations for %d shapes, %zu for %d, %.2f per "
+           "shape(expected %d)\n",
+           ok ? "OK" : "FAIL", config.name, n1, kNumShapes, n2,
+           kNumShapes * 2, per_shape, expected);
+    if (!ok) {
+      failures++;
+    }
+  }
+  return failures ? 1 : 0;
+}
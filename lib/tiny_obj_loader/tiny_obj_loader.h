@@ -46,10 +46,21 @@ THE SOFTWARE.
 #ifndef TINY_OBJ_LOADER_H_
 #define TINY_OBJ_LOADER_H_
 
+#include <cstddef>
 #include <map>
 #include <string>
 #include <vector>
 
+// LoadObj*() overloads taking a std::pmr::memory_resource need C++17.
+// Define TINYOBJLOADER_DISABLE_PMR to leave them out.
+#if !defined(TINYOBJLOADER_DISABLE_PMR) && defined(__has_include) && \
+    ((__cplusplus >= 201703L) || (defined(_MSVC_LANG) && (_MSVC_LANG >= 201703L)))
+#if __has_include(<memory_resource>)
+#define TINYOBJLOADER_USE_PMR
+#include <memory_resource>
+#endif
+#endif
+
 namespace tinyobj {
 
 #ifdef __clang__
@@ -207,6 +218,70 @@ typedef struct {
   std::map<std::string, std::string> unknown_parameter;
 } material_t;
 
+// Texture slots of a material, in `material_t` member order.
+typedef enum {
+  TEXTURE_SLOT_AMBIENT,             // map_Ka
+  TEXTURE_SLOT_DIFFUSE,             // map_Kd
+  TEXTURE_SLOT_SPECULAR,            // map_Ks
+  TEXTURE_SLOT_SPECULAR_HIGHLIGHT,  // map_Ns
+  TEXTURE_SLOT_BUMP,                // map_bump, map_Bump, bump
+  TEXTURE_SLOT_DISPLACEMENT,        // disp
+  TEXTURE_SLOT_ALPHA,               // map_d
+  TEXTURE_SLOT_REFLECTION,          // refl
+  TEXTURE_SLOT_ROUGHNESS,           // map_Pr
+  TEXTURE_SLOT_METALLIC,            // map_Pm
+  TEXTURE_SLOT_SHEEN,               // map_Ps
+  TEXTURE_SLOT_EMISSIVE,            // map_Ke
+  TEXTURE_SLOT_NORMAL,              // norm
+  TEXTURE_SLOT_COUNT
+} texture_slot_t;
+
+// Colors and scalars of a material.
+typedef struct {
+  real_t ambient[3];
+  real_t diffuse[3];
+  real_t specular[3];
+  real_t transmittance[3];
+  real_t emission[3];
+  real_t shininess;
+  real_t ior;
+  real_t dissolve;
+  real_t roughness;
+  real_t metallic;
+  real_t sheen;
+  real_t clearcoat_thickness;
+  real_t clearcoat_roughness;
+  real_t anisotropy;
+  real_t anisotropy_rotation;
+  int illum;
+} material_params_t;
+
+// Material stored in `CompactMaterials`.
+// Strings are IDs of `CompactMaterials::GetString()`, 0 is "".
+typedef struct {
+  material_params_t params;
+  unsigned int name;
+  unsigned int texnames[TEXTURE_SLOT_COUNT];
+
+  // Range of the material in `CompactMaterials::GetTextureOptions()`.
+  unsigned int first_texopt;
+  unsigned int num_texopts;
+
+  // Range of the material in `CompactMaterials::GetUnknownParameters()`.
+  unsigned int first_unknown_parameter;
+  unsigned int num_unknown_parameters;
+} compact_material_t;
+
+typedef struct {
+  texture_slot_t slot;
+  texture_option_t option;
+} slot_texture_option_t;
+
+typedef struct {
+  unsigned int key;    // string ID
+  unsigned int value;  // string ID
+} unknown_parameter_t;
+
 typedef struct {
   std::string name;
 
@@ -225,9 +300,29 @@ typedef struct {
 
 typedef struct {
   std::vector<index_t> indices;
+
+  // Index arrays used instead of `indices` with
+  // `load_option_t::split_indices`, one element per face vertex.
+  // `normal_indices`(`texcoord_indices`) is empty when no face of the shape
+  // refers to a normal(texcoord). Otherwise -1 means not used.
+  std::vector<int> vertex_indices;
+  std::vector<int> normal_indices;
+  std::vector<int> texcoord_indices;
+
+  // The split index arrays as 16-bit integers, with
+  // `load_option_t::narrow_indices` and all indices of the shape below
+  // 0xffff. The split arrays are then empty. 0xffff means not used.
+  std::vector<unsigned short> vertex_indices16;
+  std::vector<unsigned short> normal_indices16;
+  std::vector<unsigned short> texcoord_indices16;
+
   std::vector<unsigned char> num_face_vertices;  // The number of vertices per
                                                  // face. 3 = polygon, 4 = quad,
-                                                 // ... Up to 255.
+                                                 // ... Up to 255(larger faces
+                                                 // are always triangulated).
+                                                 // Empty with
+                                                 // `narrow_indices` when all
+                                                 // faces are triangles.
   std::vector<int> material_ids;                 // per-face material ID
   std::vector<unsigned int> smoothing_group_ids;  // per-face smoothing group
                                                   // ID(0 = off. positive value
@@ -241,11 +336,17 @@ typedef struct {
 } shape_t;
 
 // Vertex attributes
-typedef struct {
+typedef struct attrib_t_ {
   std::vector<real_t> vertices;   // 'v'
   std::vector<real_t> normals;    // 'vn'
   std::vector<real_t> texcoords;  // 'vt'
   std::vector<real_t> colors;     // extension: vertex colors
+
+  // True when some `v` line has a color(`v x y z r g b`). Otherwise
+  // `colors` is empty. Vertices without a color are white(1, 1, 1).
+  bool has_colors;
+
+  attrib_t_() : has_colors(false) {}
 } attrib_t;
 
 typedef struct callback_t_ {
@@ -283,6 +384,59 @@ typedef struct callback_t_ {
         object_cb(NULL) {}
 } callback_t;
 
+// Options for LoadObj() and LoadObjFromMemory().
+typedef struct load_option_t_ {
+  // Triangulate polygon faces.
+  bool triangulate;
+
+  // The number of threads used to parse .obj. The input is split at line
+  // boundaries and the chunks are parsed concurrently; the result is the same
+  // as a single-threaded load. Polygons are triangulated by as many threads
+  // once all shapes have been built.
+  // 0 = decide from the input size and the number of hardware threads.
+  // Ignored(always single-threaded) when compiled without C++11.
+  int num_threads;
+
+  // Count `v`, `vn`, `vt` and `f` lines in a fast pre-pass, so that the
+  // attribute and face arrays are allocated once at their final size
+  // instead of growing by doubling(mesh arrays always are). Lowers the peak
+  // memory use for large files at the cost of one extra scan of the input.
+  bool precount;
+
+  // Store face vertex indices in `mesh_t::vertex_indices`, `normal_indices`
+  // and `texcoord_indices` instead of `mesh_t::indices`, leaving out the
+  // normal and texcoord arrays of shapes which do not use them.
+  bool split_indices;
+
+  // `split_indices`, with the index arrays of each shape stored as 16-bit
+  // integers(`mesh_t::vertex_indices16`, ...) when its indices fit, and
+  // `mesh_t::num_face_vertices` left empty when all of its faces are
+  // triangles(always the case with `triangulate`).
+  bool narrow_indices;
+
+  // Binary cache file of the loaded data, or NULL. LoadObj(filename) loads
+  // from it when it was written for the same .obj and .mtl files(size,
+  // modification time and content hash) and the same `triangulate`,
+  // `split_indices` and `narrow_indices`.
+  // Otherwise it parses the .obj and(re)writes the cache. Ignored by the
+  // other LoadObj* functions.
+  const char *cache_filename;
+
+  // Read .mtl files through the process-wide material cache of
+  // MaterialFileReader, so that a library shared by many .obj files is only
+  // parsed once. Used by LoadObj(filename) and ObjStreamReader::Open(filename).
+  bool cache_materials;
+
+  load_option_t_()
+      : triangulate(true),
+        num_threads(0),
+        precount(false),
+        split_indices(false),
+        narrow_indices(false),
+        cache_filename(NULL),
+        cache_materials(false) {}
+} load_option_t;
+
 class MaterialReader {
  public:
   MaterialReader() {}
@@ -296,8 +450,14 @@ class MaterialReader {
 
 class MaterialFileReader : public MaterialReader {
  public:
-  explicit MaterialFileReader(const std::string &mtl_basedir)
-      : m_mtlBaseDir(mtl_basedir) {}
+  /// With `use_cache`, each .mtl file is parsed once per process and later
+  /// reads copy the parsed materials from a shared cache, as long as the
+  /// file is unchanged(size, modification time and content hash). The cache
+  /// is thread-safe, except when compiled without C++11 or with
+  /// TINYOBJLOADER_DISABLE_THREADS. See ClearMaterialCache().
+  explicit MaterialFileReader(const std::string &mtl_basedir,
+                              bool use_cache = false)
+      : m_mtlBaseDir(mtl_basedir), m_useCache(use_cache) {}
   virtual ~MaterialFileReader() {}
   virtual bool operator()(const std::string &matId,
                           std::vector<material_t> *materials,
@@ -305,8 +465,12 @@ class MaterialFileReader : public MaterialReader {
 
  private:
   std::string m_mtlBaseDir;
+  bool m_useCache;
 };
 
+/// Releases the .mtl files cached by MaterialFileReader.
+void ClearMaterialCache();
+
 class MaterialStreamReader : public MaterialReader {
  public:
   explicit MaterialStreamReader(std::istream &inStream)
@@ -330,11 +494,36 @@ class MaterialStreamReader : public MaterialReader {
 /// directory.
 /// 'triangulate' is optional, and used whether triangulate polygon face in .obj
 /// or not.
+/// The file is memory mapped(read-only) and parsed in place when the platform
+/// supports it.
+/// With TINYOBJLOADER_USE_ZLIB, a gzip compressed .obj(detected by its magic
+/// bytes, also by the other LoadObj* functions) is inflated while it is
+/// parsed, and a .mtl may also be gzip compressed or found as `<name>.gz`.
 bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
              std::vector<material_t> *materials, std::string *err,
              const char *filename, const char *mtl_basedir = NULL,
              bool triangulate = true);
 
+/// Loads .obj from a file with options.
+/// See `load_option_t` for available options.
+bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
+             std::vector<material_t> *materials, std::string *err,
+             const char *filename, const char *mtl_basedir,
+             const load_option_t &option);
+
+#ifdef TINYOBJLOADER_USE_PMR
+/// Loads .obj from a file with options, taking the scratch buffers of the
+/// load(faces, face indices, grouping commands, ...) from `resource`, e.g.
+/// a std::pmr::monotonic_buffer_resource released after loading a batch of
+/// files. The loaded data is returned in the usual std::vectors.
+/// `resource` need not be thread-safe: parse threads share it under a lock.
+/// NULL uses std::pmr::get_default_resource().
+bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
+             std::vector<material_t> *materials, std::string *err,
+             const char *filename, const char *mtl_basedir,
+             const load_option_t &option, std::pmr::memory_resource *resource);
+#endif
+
 /// Loads .obj from a file with custom user callback.
 /// .mtl is loaded as usual and parsed material_t data will be passed to
 /// `callback.mtllib_cb`.
@@ -355,28 +544,265 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
              std::istream *inStream, MaterialReader *readMatFn = NULL,
              bool triangulate = true);
 
+bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
+             std::vector<material_t> *materials, std::string *err,
+             std::istream *inStream, MaterialReader *readMatFn,
+             const load_option_t &option);
+
+/// Loads .obj from a memory buffer of `len` bytes.
+/// `data` does not need to be null-terminated and is not modified; lines are
+/// parsed in place without copying.
+/// Returns true when loading .obj become success.
+/// Returns warning and error message into `err`
+bool LoadObjFromMemory(attrib_t *attrib, std::vector<shape_t> *shapes,
+                       std::vector<material_t> *materials, std::string *err,
+                       const char *data, size_t len,
+                       MaterialReader *readMatFn = NULL,
+                       bool triangulate = true);
+
+bool LoadObjFromMemory(attrib_t *attrib, std::vector<shape_t> *shapes,
+                       std::vector<material_t> *materials, std::string *err,
+                       const char *data, size_t len, MaterialReader *readMatFn,
+                       const load_option_t &option);
+
+#ifdef TINYOBJLOADER_USE_PMR
+/// LoadObjFromMemory() with the scratch buffers taken from `resource`(see
+/// the LoadObj() overload taking one).
+bool LoadObjFromMemory(attrib_t *attrib, std::vector<shape_t> *shapes,
+                       std::vector<material_t> *materials, std::string *err,
+                       const char *data, size_t len, MaterialReader *readMatFn,
+                       const load_option_t &option,
+                       std::pmr::memory_resource *resource);
+#endif
+
+/// Triangulates the polygons of `shape` in place, for shapes loaded with
+/// `triangulate` = false. Scenes can thus be loaded without triangulation
+/// and only the shapes that need triangles be triangulated, on demand.
+/// A shape whose faces are all triangles is left as it is, so calling this
+/// again for a shape is cheap. All index layouts(`indices`, split and
+/// 16-bit) are supported. `attrib` holds the vertices of the shape.
+/// Returns false, leaving `shape` unchanged, when its faces do not match its
+/// indices or refer to vertices outside of `attrib`.
+bool TriangulateShape(const attrib_t &attrib, shape_t *shape);
+
+/// Reads .obj one shape at a time.
+/// `Next()` returns each shape as soon as the `g` or `o` line that ends it
+/// has been read, so shapes can be processed while the rest of the input is
+/// still being parsed. The input is read in blocks and only the faces of the
+/// shape being built are kept in memory. Vertex attributes are kept for the
+/// whole input, since a face may refer to any preceding vertex.
+///
+///   tinyobj::ObjStreamReader reader;
+///   if (reader.Open("model.obj")) {
+///     tinyobj::shape_t shape;
+///     while (reader.Next(&shape)) {
+///       // `shape.mesh.indices` refer to `reader.GetAttrib()`.
+///     }
+///   }
+///
+/// `load_option_t::num_threads` and `load_option_t::precount` are ignored.
+class ObjStreamReader {
+ public:
+  ObjStreamReader();
+  ~ObjStreamReader();
+
+  /// Opens an .obj file. .mtl files are searched in `mtl_basedir`.
+  /// Returns false when the file cannot be opened.
+  bool Open(const char *filename, const char *mtl_basedir = NULL,
+            const load_option_t &option = load_option_t());
+
+  /// Reads .obj from `inStream`, which must outlive the reader.
+  bool Open(std::istream *inStream, MaterialReader *readMatFn = NULL,
+            const load_option_t &option = load_option_t());
+
+  /// Reads the next shape into `shape`.
+  /// When `shape_attrib` is not NULL, it receives only the attributes
+  /// referenced by the shape and the indices of `shape` refer to it instead
+  /// of `GetAttrib()`.
+  /// Returns false at the end of the input or when parsing failed(see
+  /// `Failed()`).
+  bool Next(shape_t *shape, attrib_t *shape_attrib = NULL);
+
+  /// Vertex attributes read so far.
+  const attrib_t &GetAttrib() const;
+
+  /// Materials loaded so far(by `mtllib` lines).
+  const std::vector<material_t> &GetMaterials() const;
+
+  /// Warning and error messages.
+  const std::string &GetError() const;
+
+  /// True when parsing stopped at an invalid line.
+  bool Failed() const;
+
+ private:
+  ObjStreamReader(const ObjStreamReader &);
+  ObjStreamReader &operator=(const ObjStreamReader &);
+
+  struct Impl;
+  Impl *m_impl;
+};
+
+/// Compact storage for many materials.
+/// Colors and scalars are kept in a dense POD block per material. Names,
+/// texture names and unknown parameters are interned once per container.
+/// Texture options are kept out of line and only when they differ from the
+/// defaults, and the unknown parameters of all materials share one array.
+/// The texture option of a slot without texture name is not kept.
+///
+///   tinyobj::CompactMaterials compact;
+///   compact.Add(materials);
+///   const tinyobj::compact_material_t &m = compact.GetMaterial(0);
+///   const std::string &diffuse_texname =
+///       compact.GetString(m.texnames[tinyobj::TEXTURE_SLOT_DIFFUSE]);
+class CompactMaterials {
+ public:
+  CompactMaterials();
+  CompactMaterials(const CompactMaterials &other);
+  CompactMaterials &operator=(const CompactMaterials &other);
+
+  /// Appends `material` and returns its index.
+  size_t Add(const material_t &material);
+
+  /// Appends `materials`.
+  void Add(const std::vector<material_t> &materials);
+
+  /// Converts the material at `index` back to `material_t`.
+  void Get(size_t index, material_t *material) const;
+
+  /// Converts all materials back to `material_t`.
+  void Get(std::vector<material_t> *materials) const;
+
+  size_t Size() const { return m_materials.size(); }
+
+  const compact_material_t &GetMaterial(size_t index) const {
+    return m_materials[index];
+  }
+
+  /// Returns the string of `id`.
+  const std::string &GetString(unsigned int id) const { return *m_strings[id]; }
+
+  /// Texture option of `slot` of the material at `index`, the default one
+  /// when it is not stored.
+  void GetTextureOption(size_t index, texture_slot_t slot,
+                        texture_option_t *option) const;
+
+  const std::vector<slot_texture_option_t> &GetTextureOptions() const {
+    return m_texopts;
+  }
+
+  const std::vector<unknown_parameter_t> &GetUnknownParameters() const {
+    return m_unknownParameters;
+  }
+
+  void Reserve(size_t num_materials);
+  void Clear();
+  void Swap(CompactMaterials &other);
+
+ private:
+  unsigned int intern(const std::string &str);
+
+  std::vector<compact_material_t> m_materials;
+  std::map<std::string, unsigned int> m_stringIds;
+  std::vector<const std::string *> m_strings;  // Keys of `m_stringIds`.
+  std::vector<slot_texture_option_t> m_texopts;
+  std::vector<unknown_parameter_t> m_unknownParameters;
+};
+
 /// Loads materials into std::map
 void LoadMtl(std::map<std::string, int> *material_map,
              std::vector<material_t> *materials, std::istream *inStream,
              std::string *warning);
 
+/// Loads materials into `CompactMaterials`, without keeping a `material_t`
+/// for each of them.
+void LoadMtl(std::map<std::string, int> *material_map,
+             CompactMaterials *materials, std::istream *inStream,
+             std::string *warning);
+
 }  // namespace tinyobj
 
 #endif  // TINY_OBJ_LOADER_H_
 
 #ifdef TINYOBJLOADER_IMPLEMENTATION
+#include <algorithm>
 #include <cassert>
 #include <cctype>
 #include <cmath>
 #include <cstddef>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
 #include <utility>
 #include <limits>
 
 #include <fstream>
+#include <locale>
 #include <sstream>
 
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// Multi-threaded parsing needs C++11 <thread>.
+// Define TINYOBJLOADER_DISABLE_THREADS to always parse on the calling thread.
+#if !defined(TINYOBJLOADER_DISABLE_THREADS) && \
+    ((__cplusplus >= 201103L) || (defined(_MSVC_LANG) && (_MSVC_LANG >= 201103L)))
+#define TINYOBJLOADER_USE_THREADS
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+// LoadObj() pages the memory mapped file in on a background thread while
+// parsing it(POSIX). Define TINYOBJLOADER_DISABLE_READ_AHEAD to disable it.
+#if defined(TINYOBJLOADER_USE_THREADS) && !defined(_WIN32) && \
+    !defined(TINYOBJLOADER_DISABLE_READ_AHEAD)
+#define TINYOBJLOADER_USE_READ_AHEAD
+#endif
+
+// Gzip compressed .obj and .mtl files are inflated with zlib when
+// TINYOBJLOADER_USE_ZLIB is defined.
+#ifdef TINYOBJLOADER_USE_ZLIB
+#include <zlib.h>
+#endif
+
+// Line and token scanners use SSE2(and AVX2 when the CPU supports it).
+// Define TINYOBJLOADER_DISABLE_SIMD to use the portable scanners only.
+#if !defined(TINYOBJLOADER_DISABLE_SIMD) &&                   \
+    (defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || \
+     (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#define TINYOBJLOADER_USE_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)
+#define TINYOBJLOADER_USE_AVX2
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define TINYOBJLOADER_TARGET_AVX2
+#else
+#define TINYOBJLOADER_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+#endif
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace tinyobj {
 
 MaterialReader::~MaterialReader() {}
@@ -390,16 +816,39 @@ struct vertex_index_t {
 };
 
 // Internal data structure for face representation
-// index + smoothing group.
+// index + smoothing group. The vertex indices of all faces are stored back to
+// back in one array; a face refers to `num_vertices` of them starting at
+// `vertex_offset`.
 struct face_t {
   unsigned int
       smoothing_group_id;  // smoothing group id. 0 = smoothing groupd is off.
-  int pad_;
-  std::vector<vertex_index_t> vertex_indices;  // face vertex indices.
+  unsigned int num_vertices;  // # of face vertex indices.
+  size_t vertex_offset;       // Position of the first face vertex index.
 
-  face_t() : smoothing_group_id(0) {}
+  face_t() : smoothing_group_id(0), num_vertices(0), vertex_offset(0) {}
 };
 
+// Scratch buffers of a load(faces, face indices, grouping commands, ...)
+// come from the memory resource passed to a LoadObj*() overload taking one,
+// otherwise from the default resource(std::allocator without std::pmr).
+#ifdef TINYOBJLOADER_USE_PMR
+typedef std::pmr::polymorphic_allocator<char> scratch_allocator_t;
+#else
+typedef std::allocator<char> scratch_allocator_t;
+#endif
+
+template <typename T>
+struct scratch_vector {
+#ifdef TINYOBJLOADER_USE_PMR
+  typedef std::pmr::vector<T> type;
+#else
+  typedef std::vector<T> type;
+#endif
+};
+
+typedef scratch_vector<face_t>::type face_vector_t;
+typedef scratch_vector<vertex_index_t>::type vertex_index_vector_t;
+
 struct tag_sizes {
   tag_sizes() : num_ints(0), num_reals(0), num_strings(0) {}
   int num_ints;
@@ -413,1458 +862,5327 @@ struct obj_shape {
   std::vector<real_t> vt;
 };
 
-// See
-// http://stackoverflow.com/questions/6089231/getting-std-ifstream-to-handle-lf-cr-and-crlf
-static std::istream &safeGetline(std::istream &is, std::string &t) {
-  t.clear();
+// The token scanners load 16 bytes at a time and may read up to this many
+// bytes past the end of a line. LineReader guarantees they are readable.
+static const size_t kScanPadding = 32;
 
-  // The characters in the stream are read one-by-one using a std::streambuf.
-  // That is faster than reading them one-by-one using the std::istream.
-  // Code that uses streambuf this way must be guarded by a sentry object.
-  // The sentry object performs various tasks,
-  // such as thread synchronization and updating the stream state.
+static inline unsigned int countTrailingZeros(unsigned int x) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long i;
+  _BitScanForward(&i, x);
+  return static_cast<unsigned int>(i);
+#else
+  return static_cast<unsigned int>(__builtin_ctz(x));
+#endif
+}
 
-  std::istream::sentry se(is, true);
-  std::streambuf *sb = is.rdbuf();
+// Returns the first '\n' or '\r' in [p, end), or `end`.
+static const char *findLineEndScalar(const char *p, const char *end) {
+  while ((p < end) && ((*p) != '\n') && ((*p) != '\r')) {
+    p++;
+  }
+  return p;
+}
 
-  if (se) {
-    for (;;) {
-      int c = sb->sbumpc();
-      switch (c) {
-        case '\n':
-          return is;
-        case '\r':
-          if (sb->sgetc() == '\n') sb->sbumpc();
-          return is;
-        case EOF:
-          // Also handle the case when the last line has no line ending
-          if (t.empty()) is.setstate(std::ios::eofbit);
-          return is;
-        default:
-          t += static_cast<char>(c);
-      }
+#ifdef TINYOBJLOADER_USE_SSE2
+static const char *findLineEndSSE2(const char *p, const char *end) {
+  const __m128i nl = _mm_set1_epi8('\n');
+  const __m128i cr = _mm_set1_epi8('\r');
+  while (end - p >= 16) {
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    int mask = _mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(c, nl), _mm_cmpeq_epi8(c, cr)));
+    if (mask) {
+      return p + countTrailingZeros(static_cast<unsigned int>(mask));
     }
+    p += 16;
   }
-
-  return is;
+  return findLineEndScalar(p, end);
 }
+#endif
 
-#define IS_SPACE(x) (((x) == ' ') || ((x) == '\t'))
-#define IS_DIGIT(x) \
-  (static_cast<unsigned int>((x) - '0') < static_cast<unsigned int>(10))
-#define IS_NEW_LINE(x) (((x) == '\r') || ((x) == '\n') || ((x) == '\0'))
+#ifdef TINYOBJLOADER_USE_AVX2
+TINYOBJLOADER_TARGET_AVX2
+static const char *findLineEndAVX2(const char *p, const char *end) {
+  const __m256i nl = _mm256_set1_epi8('\n');
+  const __m256i cr = _mm256_set1_epi8('\r');
+  while (end - p >= 32) {
+    __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    int mask = _mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(c, nl), _mm256_cmpeq_epi8(c, cr)));
+    if (mask) {
+      return p + countTrailingZeros(static_cast<unsigned int>(mask));
+    }
+    p += 32;
+  }
+  return findLineEndSSE2(p, end);
+}
 
-// Make index zero-base, and also support relative index.
-static inline bool fixIndex(int idx, int n, int *ret) {
-  if (!ret) {
+static bool cpuHasAVX2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) {
     return false;
   }
-
-  if (idx > 0) {
-    (*ret) = idx - 1;
-    return true;
+  __cpuid(info, 1);
+  const int kOSXSave = 1 << 27;
+  const int kAVX = 1 << 28;
+  if (((info[2] & kOSXSave) == 0) || ((info[2] & kAVX) == 0)) {
+    return false;
   }
-
-  if (idx == 0) {
-    // zero is not allowed according to the spec.
+  if ((_xgetbv(0) & 6) != 6) {  // OS saves the YMM registers.
     return false;
   }
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif
 
-  if (idx < 0) {
-    (*ret) = n + idx;  // negative value = relative
-    return true;
-  }
+typedef const char *(*find_line_end_fn_t)(const char *p, const char *end);
 
-  return false;  // never reach here.
+static find_line_end_fn_t selectFindLineEnd() {
+#if defined(TINYOBJLOADER_USE_AVX2)
+  static const bool has_avx2 = cpuHasAVX2();
+  if (has_avx2) {
+    return findLineEndAVX2;
+  }
+#endif
+#if defined(TINYOBJLOADER_USE_SSE2)
+  return findLineEndSSE2;
+#else
+  return findLineEndScalar;
+#endif
 }
 
-static inline std::string parseString(const char **token) {
-  std::string s;
-  (*token) += strspn((*token), " \t");
-  size_t e = strcspn((*token), " \t\r");
-  s = std::string((*token), &(*token)[e]);
-  (*token) += e;
-  return s;
-}
+// Input which is still being read in, e.g. by MappedFileReadAhead.
+class ReadProgress {
+ public:
+  virtual ~ReadProgress() {}
 
-static inline int parseInt(const char **token) {
-  (*token) += strspn((*token), " \t");
-  int i = atoi((*token));
-  (*token) += strcspn((*token), " \t\r");
-  return i;
-}
+  // Waits until at least `min_len` bytes from `p`(or up to the end of the
+  // input) have been read and returns the end of the data read contiguously
+  // from `p`.
+  virtual const char *waitFor(const char *p, size_t min_len) const = 0;
+};
 
-// Tries to parse a floating point number located at s.
-//
-// s_end should be a location in the string where reading should absolutely
-// stop. For example at the end of the string, to prevent buffer overflows.
-//
-// Parses the following EBNF grammar:
-//   sign    = "+" | "-" ;
-//   END     = ? anything not in digit ?
-//   digit   = "0" | "1" | "2" | "3" | "4" | "5" | "6" | "7" | "8" | "9" ;
-//   integer = [sign] , digit , {digit} ;
-//   decimal = integer , ["." , integer] ;
-//   float   = ( decimal , END ) | ( decimal , ("E" | "e") , integer , END ) ;
-//
-//  Valid strings are for example:
-//   -0  +3.1417e+2  -0.0E-3  1.0324  -1.41   11e2
-//
-// If the parsing is a success, result is set to the parsed value and true
-// is returned.
-//
-// The function is greedy and will parse until any of the following happens:
-//  - a non-conforming character is encountered.
-//  - s_end is reached.
-//
-// The following situations triggers a failure:
-//  - s >= s_end.
-//  - parse failure.
-//
-static bool tryParseDouble(const char *s, const char *s_end, double *result) {
-  if (s >= s_end) {
-    return false;
+// # of bytes LineReader and splitObjChunks() wait for at a time.
+static const size_t kReadProgressStep = 64 * 1024;
+
+// Hands out the lines of a contiguous buffer in place.
+// Each line returned is followed by '\n', "\r\n" or '\0' and at least
+// `kScanPadding` readable bytes, so the token scanners(which stop at any of
+// " \t\r\n" and '\0') never run off the line or the buffer. Lines ending
+// with a lone '\r'(old Mac) or close to the end of the buffer are copied into
+// `m_tail` to get such a terminator and padding.
+// With `progress`, lines are only handed out once they have been read in.
+class LineReader {
+ public:
+  LineReader(const char *buf, size_t len, const ReadProgress *progress = NULL)
+      : m_cur(buf),
+        m_end(buf + len),
+        m_findLineEnd(selectFindLineEnd()),
+        m_progress(progress),
+        m_ready(buf) {}
+
+  // [*line, *line_end) is the line without its line ending.
+  // Returns false when the whole buffer has been consumed.
+  bool next(const char **line, const char **line_end) {
+    if (m_cur >= m_end) {
+      return false;
+    }
+
+    const char *p = m_progress ? findReadyLineEnd()
+                               : m_findLineEnd(m_cur, m_end);
+    const bool padded = static_cast<size_t>(m_end - p) > kScanPadding;
+
+    if (padded && ((*p) == '\n')) {
+      (*line) = m_cur;
+      (*line_end) = p;
+      m_cur = p + 1;
+      return true;
+    }
+
+    if (padded && ((*p) == '\r') && (p[1] == '\n')) {
+      (*line) = m_cur;
+      (*line_end) = p;
+      m_cur = p + 2;
+      return true;
+    }
+
+    m_tail.assign(m_cur, p);
+    m_tail.append(kScanPadding, '\0');
+    (*line) = m_tail.c_str();
+    (*line_end) = (*line) + (p - m_cur);
+    if ((p < m_end) && ((*p) == '\r') && (p + 1 < m_end) && (p[1] == '\n')) {
+      m_cur = p + 2;
+    } else {
+      m_cur = (p < m_end) ? (p + 1) : p;
+    }
+    return true;
   }
 
-  double mantissa = 0.0;
-  // This exponent is base 2 rather than 10.
-  // However the exponent we parse is supposed to be one of ten,
-  // thus we must take care to convert the exponent/and or the
-  // mantissa to a * 2^E, where a is the mantissa and E is the
-  // exponent.
-  // To get the final double we will use ldexp, it requires the
-  // exponent to be in base 2.
-  int exponent = 0;
+ private:
+  // m_findLineEnd(m_cur, m_end) on input being read in. Also waits for the
+  // padding after the line end, as far as next() reads it.
+  const char *findReadyLineEnd() {
+    const char *from = m_cur;
+    for (;;) {
+      if (m_ready <= from) {
+        m_ready = m_progress->waitFor(from, kReadProgressStep);
+      }
+      const char *limit = (m_ready < m_end) ? m_ready : m_end;
+      const char *p = m_findLineEnd(from, limit);
+      if ((p == limit) && (limit < m_end)) {
+        from = limit;  // No line end in the data read so far.
+        continue;
+      }
 
-  // NOTE: THESE MUST BE DECLARED HERE SINCE WE ARE NOT ALLOWED
-  // TO JUMP OVER DEFINITIONS.
-  char sign = '+';
-  char exp_sign = '+';
-  char const *curr = s;
+      const char *needed = (static_cast<size_t>(m_end - p) > kScanPadding)
+                               ? (p + kScanPadding + 1)
+                               : m_end;
+      if (m_ready < needed) {
+        m_ready = m_progress->waitFor(p, static_cast<size_t>(needed - p));
+      }
+      return p;
+    }
+  }
 
-  // How many characters were read in a loop.
-  int read = 0;
-  // Tells whether a loop terminated due to reaching s_end.
-  bool end_not_reached = false;
+  const char *m_cur;
+  const char *m_end;
+  find_line_end_fn_t m_findLineEnd;
+  const ReadProgress *m_progress;
+  const char *m_ready;  // End of the data known to be read in.
+  std::string m_tail;
+};
 
-  /*
-          BEGIN PARSING.
-  */
+// Reads the remaining contents of `is` into `buf`.
+static void ReadStreamToBuffer(std::istream &is, std::vector<char> *buf) {
+  buf->clear();
+  if (!is) {
+    return;
+  }
 
-  // Find out what sign we've got.
-  if (*curr == '+' || *curr == '-') {
-    sign = *curr;
-    curr++;
-  } else if (IS_DIGIT(*curr)) { /* Pass through. */
-  } else {
-    goto fail;
+  const size_t kBlockSize = 1024 * 1024;
+  size_t len = 0;
+  while (is) {
+    buf->resize(len + kBlockSize);
+    is.read(&buf->at(len), static_cast<std::streamsize>(kBlockSize));
+    len += static_cast<size_t>(is.gcount());
   }
+  buf->resize(len);
+}
 
-  // Read the integer part.
-  end_not_reached = (curr != s_end);
-  while (end_not_reached && IS_DIGIT(*curr)) {
-    mantissa *= 10;
-    mantissa += static_cast<int>(*curr - 0x30);
-    curr++;
-    read++;
-    end_not_reached = (curr != s_end);
+// Read-only view of a whole file.
+// The file is memory mapped when possible, otherwise it is read into memory.
+class MappedFile {
+ public:
+  MappedFile()
+      : m_data(NULL),
+        m_size(0)
+#if defined(_WIN32)
+        ,
+        m_file(INVALID_HANDLE_VALUE),
+        m_mapping(NULL)
+#endif
+  {
   }
+  ~MappedFile() { close(); }
 
-  // We must make sure we actually got something.
-  if (read == 0) goto fail;
-  // We allow numbers of form "#", "###" etc.
-  if (!end_not_reached) goto assemble;
+  bool open(const char *filename) {
+    close();
+    if (map(filename)) {
+      return true;
+    }
 
-  // Read the decimal part.
-  if (*curr == '.') {
-    curr++;
-    read = 1;
-    end_not_reached = (curr != s_end);
-    while (end_not_reached && IS_DIGIT(*curr)) {
-      static const double pow_lut[] = {
-          1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001,
-      };
-      const int lut_entries = sizeof pow_lut / sizeof pow_lut[0];
-
-      // NOTE: Don't use powf here, it will absolutely murder precision.
-      mantissa += static_cast<int>(*curr - 0x30) *
-                  (read < lut_entries ? pow_lut[read] : std::pow(10.0, -read));
-      read++;
-      curr++;
-      end_not_reached = (curr != s_end);
+    std::ifstream ifs(filename, std::ios::in | std::ios::binary);
+    if (!ifs) {
+      return false;
     }
-  } else if (*curr == 'e' || *curr == 'E') {
-  } else {
-    goto assemble;
+    ReadStreamToBuffer(ifs, &m_buf);
+    m_data = m_buf.empty() ? NULL : &m_buf.at(0);
+    m_size = m_buf.size();
+    return true;
   }
 
-  if (!end_not_reached) goto assemble;
+  const char *data() const { return m_data; }
+  size_t size() const { return m_size; }
+  bool mapped() const { return m_data && m_buf.empty(); }
 
-  // Read the exponent part.
-  if (*curr == 'e' || *curr == 'E') {
-    curr++;
-    // Figure out if a sign is present and if it is.
-    end_not_reached = (curr != s_end);
-    if (end_not_reached && (*curr == '+' || *curr == '-')) {
-      exp_sign = *curr;
-      curr++;
-    } else if (IS_DIGIT(*curr)) { /* Pass through. */
-    } else {
-      // Empty E is not allowed.
-      goto fail;
+ private:
+  MappedFile(const MappedFile &);
+  MappedFile &operator=(const MappedFile &);
+
+#if defined(_WIN32)
+  bool map(const char *filename) {
+    m_file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                         OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (m_file == INVALID_HANDLE_VALUE) {
+      return false;
     }
-
-    read = 0;
-    end_not_reached = (curr != s_end);
-    while (end_not_reached && IS_DIGIT(*curr)) {
-      exponent *= 10;
-      exponent += static_cast<int>(*curr - 0x30);
-      curr++;
-      read++;
-      end_not_reached = (curr != s_end);
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_file, &size) || (size.QuadPart == 0) ||
+        (static_cast<unsigned long long>(size.QuadPart) >
+         static_cast<unsigned long long>((std::numeric_limits<size_t>::max)()))) {
+      close();
+      return false;
+    }
+    m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!m_mapping) {
+      close();
+      return false;
+    }
+    const void *p = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!p) {
+      close();
+      return false;
     }
-    exponent *= (exp_sign == '+' ? 1 : -1);
-    if (read == 0) goto fail;
+    m_data = static_cast<const char *>(p);
+    m_size = static_cast<size_t>(size.QuadPart);
+    return true;
   }
 
-assemble:
-  *result = (sign == '+' ? 1 : -1) *
-            (exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent)
-                      : mantissa);
-  return true;
-fail:
-  return false;
-}
-
-static inline real_t parseReal(const char **token, double default_value = 0.0) {
-  (*token) += strspn((*token), " \t");
-  const char *end = (*token) + strcspn((*token), " \t\r");
-  double val = default_value;
-  tryParseDouble((*token), end, &val);
-  real_t f = static_cast<real_t>(val);
-  (*token) = end;
-  return f;
-}
+  void close() {
+    if (m_data && m_buf.empty()) {
+      UnmapViewOfFile(m_data);
+    }
+    if (m_mapping) {
+      CloseHandle(m_mapping);
+    }
+    if (m_file != INVALID_HANDLE_VALUE) {
+      CloseHandle(m_file);
+    }
+    m_file = INVALID_HANDLE_VALUE;
+    m_mapping = NULL;
+    m_data = NULL;
+    m_size = 0;
+    m_buf.clear();
+  }
 
-static inline bool parseReal(const char **token, real_t *out) {
-  (*token) += strspn((*token), " \t");
-  const char *end = (*token) + strcspn((*token), " \t\r");
-  double val;
-  bool ret = tryParseDouble((*token), end, &val);
-  if (ret) {
-    real_t f = static_cast<real_t>(val);
-    (*out) = f;
+  HANDLE m_file;
+  HANDLE m_mapping;
+#else
+  bool map(const char *filename) {
+    int fd = ::open(filename, O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat sb;
+    if ((fstat(fd, &sb) != 0) || !S_ISREG(sb.st_mode) || (sb.st_size <= 0)) {
+      ::close(fd);
+      return false;
+    }
+    void *p = mmap(NULL, static_cast<size_t>(sb.st_size), PROT_READ,
+                   MAP_PRIVATE, fd, 0);
+    ::close(fd);  // The mapping stays valid after close.
+    if (p == MAP_FAILED) {
+      return false;
+    }
+#if defined(MADV_SEQUENTIAL)
+    madvise(p, static_cast<size_t>(sb.st_size), MADV_SEQUENTIAL);
+#endif
+    m_data = static_cast<const char *>(p);
+    m_size = static_cast<size_t>(sb.st_size);
+    return true;
   }
-  (*token) = end;
-  return ret;
-}
 
-static inline void parseReal2(real_t *x, real_t *y, const char **token,
-                              const double default_x = 0.0,
-                              const double default_y = 0.0) {
-  (*x) = parseReal(token, default_x);
-  (*y) = parseReal(token, default_y);
-}
+  void close() {
+    if (m_data && m_buf.empty()) {
+      munmap(const_cast<char *>(m_data), m_size);
+    }
+    m_data = NULL;
+    m_size = 0;
+    m_buf.clear();
+  }
+#endif
 
-static inline void parseReal3(real_t *x, real_t *y, real_t *z,
-                              const char **token, const double default_x = 0.0,
-                              const double default_y = 0.0,
-                              const double default_z = 0.0) {
-  (*x) = parseReal(token, default_x);
-  (*y) = parseReal(token, default_y);
-  (*z) = parseReal(token, default_z);
-}
+  const char *m_data;
+  size_t m_size;
+  std::vector<char> m_buf;  // Used when the file could not be mapped.
+};
 
-static inline void parseV(real_t *x, real_t *y, real_t *z, real_t *w,
-                          const char **token, const double default_x = 0.0,
-                          const double default_y = 0.0,
-                          const double default_z = 0.0,
-                          const double default_w = 1.0) {
-  (*x) = parseReal(token, default_x);
-  (*y) = parseReal(token, default_y);
-  (*z) = parseReal(token, default_z);
-  (*w) = parseReal(token, default_w);
-}
+#ifdef TINYOBJLOADER_USE_READ_AHEAD
+// Pages a memory mapped file in on a background thread, so that parsing
+// overlaps with the disk reads instead of stalling on page faults.
+// The file is split into `num_regions` regions at the same offsets as
+// splitObjChunks() splits it, and the regions are paged in round-robin so
+// that every parse thread gets its first lines early.
+class MappedFileReadAhead : public ReadProgress {
+ public:
+  MappedFileReadAhead(const char *data, size_t size)
+      : m_data(data), m_size(size), m_pageSize(4096), m_stop(false) {}
+  ~MappedFileReadAhead() {
+    if (m_thread.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+      }
+      m_thread.join();
+    }
+  }
 
-// Extension: parse vertex with colors(6 items)
-static inline bool parseVertexWithColor(real_t *x, real_t *y, real_t *z,
-                                        real_t *r, real_t *g, real_t *b,
-                                        const char **token,
-                                        const double default_x = 0.0,
-                                        const double default_y = 0.0,
-                                        const double default_z = 0.0) {
-  (*x) = parseReal(token, default_x);
-  (*y) = parseReal(token, default_y);
-  (*z) = parseReal(token, default_z);
+  void start(size_t num_regions) {
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (page_size > 0) {
+      m_pageSize = static_cast<size_t>(page_size);
+    }
+    for (size_t r = 0; r < num_regions; r++) {
+      m_begin.push_back((m_size / num_regions) * r);
+    }
+    m_begin.push_back(m_size);
+    m_read.assign(m_begin.begin(), m_begin.end() - 1);
+    m_thread = std::thread(&MappedFileReadAhead::readLoop, this);
+  }
 
-  (*r) = parseReal(token, 1.0);
-  (*g) = parseReal(token, 1.0);
-  (*b) = parseReal(token, 1.0);
+  virtual const char *waitFor(const char *p, size_t min_len) const {
+    size_t offset = static_cast<size_t>(p - m_data);
+    size_t wanted = (min_len < m_size - offset) ? (offset + min_len) : m_size;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+      size_t read_end = readFrom(offset);
+      if (read_end >= wanted) {
+        return m_data + read_end;
+      }
+      m_readCond.wait(lock);
+    }
+  }
 
-  return true;
-}
+ private:
+  MappedFileReadAhead(const MappedFileReadAhead &);
+  MappedFileReadAhead &operator=(const MappedFileReadAhead &);
+
+  // First block of each region is small so that parsing starts early.
+  static const size_t kFirstBlockSize = 64 * 1024;
+  static const size_t kBlockSize = 1024 * 1024;
+
+  // End of the data read contiguously from `offset`. `m_mutex` must be held.
+  size_t readFrom(size_t offset) const {
+    size_t num_regions = m_read.size();
+    size_t r = static_cast<size_t>(
+        std::upper_bound(m_begin.begin(), m_begin.end() - 1, offset) -
+        m_begin.begin());
+    size_t end = offset;
+    for (r = (r > 0) ? (r - 1) : 0; r < num_regions; r++) {
+      if (m_read[r] > end) {
+        end = m_read[r];
+      }
+      if (m_read[r] < m_begin[r + 1]) {
+        break;
+      }
+    }
+    return end;
+  }
 
-static inline bool parseOnOff(const char **token, bool default_value = true) {
-  (*token) += strspn((*token), " \t");
-  const char *end = (*token) + strcspn((*token), " \t\r");
+  // Reads [begin, end) of the file into the mapping.
+  void pageIn(size_t begin, size_t end) const {
+    size_t page_begin = begin - (begin % m_pageSize);
+#if defined(MADV_WILLNEED)
+    // Lets the kernel read the whole block with large requests.
+    madvise(const_cast<char *>(m_data) + page_begin, end - page_begin,
+            MADV_WILLNEED);
+#endif
+    const volatile char *p = m_data;
+    for (size_t i = page_begin; i < end; i += m_pageSize) {
+      (void)p[(i < begin) ? begin : i];
+    }
+  }
 
-  bool ret = default_value;
-  if ((0 == strncmp((*token), "on", 2))) {
-    ret = true;
-  } else if ((0 == strncmp((*token), "off", 3))) {
-    ret = false;
+  void readLoop() {
+    size_t num_regions = m_read.size();
+    std::vector<size_t> pos(m_read);
+    bool reading = true;
+    while (reading) {
+      reading = false;
+      for (size_t r = 0; r < num_regions; r++) {
+        size_t region_end = m_begin[r + 1];
+        if (pos[r] >= region_end) {
+          continue;
+        }
+        size_t block = (pos[r] == m_begin[r]) ? kFirstBlockSize : kBlockSize;
+        if (block > region_end - pos[r]) {
+          block = region_end - pos[r];
+        }
+        pageIn(pos[r], pos[r] + block);
+        pos[r] += block;
+        reading = reading || (pos[r] < region_end);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stop) {
+          return;
+        }
+        m_read[r] = pos[r];
+        m_readCond.notify_all();
+      }
+    }
   }
 
-  (*token) = end;
-  return ret;
+  const char *m_data;
+  size_t m_size;
+  size_t m_pageSize;
+  std::vector<size_t> m_begin;  // Region offsets, followed by `m_size`.
+  std::vector<size_t> m_read;   // End of the data read in each region.
+  mutable std::mutex m_mutex;
+  mutable std::condition_variable m_readCond;
+  bool m_stop;
+  std::thread m_thread;
+};
+#endif  // TINYOBJLOADER_USE_READ_AHEAD
+
+#ifdef TINYOBJLOADER_USE_ZLIB
+static bool isGzip(const char *data, size_t len) {
+  // 18: Smallest gzip file(10 bytes header and 8 bytes trailer).
+  return (len >= 18) && (static_cast<unsigned char>(data[0]) == 0x1f) &&
+         (static_cast<unsigned char>(data[1]) == 0x8b);
 }
 
-static inline texture_type_t parseTextureType(
-    const char **token, texture_type_t default_value = TEXTURE_TYPE_NONE) {
-  (*token) += strspn((*token), " \t");
-  const char *end = (*token) + strcspn((*token), " \t\r");
-  texture_type_t ty = default_value;
+// Inflated size stored in the gzip trailer. Only a hint: it is modulo 2^32,
+// covers the last member of a multi-member file only and is garbage for a
+// truncated file. Returns 0 for sizes deflate cannot reach.
+static size_t gzipSizeHint(const char *data, size_t len) {
+  // Deflate compresses at most about 1032:1.
+  static const size_t kMaxRatio = 1032;
+
+  const unsigned char *p =
+      reinterpret_cast<const unsigned char *>(data + len - 4);
+  size_t size = static_cast<size_t>(p[0]) | (static_cast<size_t>(p[1]) << 8) |
+                (static_cast<size_t>(p[2]) << 16) |
+                (static_cast<size_t>(p[3]) << 24);
+  return (size / kMaxRatio <= len) ? size : 0;
+}
 
-  if ((0 == strncmp((*token), "cube_top", strlen("cube_top")))) {
-    ty = TEXTURE_TYPE_CUBE_TOP;
-  } else if ((0 == strncmp((*token), "cube_bottom", strlen("cube_bottom")))) {
-    ty = TEXTURE_TYPE_CUBE_BOTTOM;
-  } else if ((0 == strncmp((*token), "cube_left", strlen("cube_left")))) {
-    ty = TEXTURE_TYPE_CUBE_LEFT;
-  } else if ((0 == strncmp((*token), "cube_right", strlen("cube_right")))) {
-    ty = TEXTURE_TYPE_CUBE_RIGHT;
-  } else if ((0 == strncmp((*token), "cube_front", strlen("cube_front")))) {
-    ty = TEXTURE_TYPE_CUBE_FRONT;
-  } else if ((0 == strncmp((*token), "cube_back", strlen("cube_back")))) {
-    ty = TEXTURE_TYPE_CUBE_BACK;
-  } else if ((0 == strncmp((*token), "sphere", strlen("sphere")))) {
-    ty = TEXTURE_TYPE_SPHERE;
+// Inflates gzip data piecewise. Concatenated members(`cat a.gz b.gz`) are
+// inflated as one.
+class GzipInflater {
+ public:
+  GzipInflater(const char *data, size_t len)
+      : m_in(reinterpret_cast<const unsigned char *>(data)),
+        m_inLeft(len),
+        m_done(false),
+        m_failed(false) {
+    memset(&m_stream, 0, sizeof(m_stream));
+    // 15 + 16: Largest window, gzip header and trailer.
+    m_failed = (inflateInit2(&m_stream, 15 + 16) != Z_OK);
+  }
+  ~GzipInflater() { inflateEnd(&m_stream); }
+
+  // Inflates up to `len` bytes to `out` and returns the # of bytes written.
+  // Less than `len` means the end of the data or an error.
+  size_t read(char *out, size_t len) {
+    size_t written = 0;
+    while ((written < len) && !m_done && !m_failed) {
+      if ((m_stream.avail_in == 0) && (m_inLeft > 0)) {
+        uInt n = (m_inLeft < kMaxAvail) ? static_cast<uInt>(m_inLeft)
+                                        : static_cast<uInt>(kMaxAvail);
+        m_stream.next_in = const_cast<Bytef *>(m_in);
+        m_stream.avail_in = n;
+        m_in += n;
+        m_inLeft -= n;
+      }
+      uInt avail = (len - written < kMaxAvail)
+                       ? static_cast<uInt>(len - written)
+                       : static_cast<uInt>(kMaxAvail);
+      m_stream.next_out = reinterpret_cast<Bytef *>(out + written);
+      m_stream.avail_out = avail;
+      int ret = inflate(&m_stream, Z_NO_FLUSH);
+      written += avail - m_stream.avail_out;
+      if (ret == Z_STREAM_END) {
+        const unsigned char *next =
+            (m_stream.avail_in > 0) ? m_stream.next_in
+                                    : ((m_inLeft > 0) ? m_in : NULL);
+        if (next && (next[0] == 0x1f)) {
+          m_failed = (inflateReset(&m_stream) != Z_OK);
+        } else {
+          m_done = true;  // Trailing garbage is ignored like gzip does.
+        }
+      } else if ((ret != Z_OK) && (ret != Z_BUF_ERROR)) {
+        m_failed = true;
+      } else if ((ret == Z_BUF_ERROR) && (m_stream.avail_out > 0)) {
+        m_failed = true;  // No more input: truncated.
+      }
+    }
+    return written;
   }
 
-  (*token) = end;
-  return ty;
+  bool done() const { return m_done; }
+  bool failed() const { return m_failed; }
+
+ private:
+  GzipInflater(const GzipInflater &);
+  GzipInflater &operator=(const GzipInflater &);
+
+  // z_stream counts bytes in uInt.
+  static const size_t kMaxAvail = 1024 * 1024 * 1024;
+
+  z_stream m_stream;
+  const unsigned char *m_in;  // Input not yet passed to `m_stream`.
+  size_t m_inLeft;
+  bool m_done;
+  bool m_failed;
+};
+
+// Inflates the whole gzip data to `out`.
+static bool inflateGzip(const char *data, size_t len, std::vector<char> *out) {
+  GzipInflater inflater(data, len);
+  // One more byte than the hint, so that a right hint needs no resize.
+  out->resize(gzipSizeHint(data, len) + 1);
+  size_t size = 0;
+  for (;;) {
+    size += inflater.read(&out->at(size), out->size() - size);
+    if (inflater.done() || inflater.failed()) {
+      break;
+    }
+    out->resize(out->size() * 2);
+  }
+  out->resize(size);
+  return !inflater.failed();
 }
 
-static tag_sizes parseTagTriple(const char **token) {
-  tag_sizes ts;
+// Reads `filename` to `gz` when it is a gzip file.
+static bool readGzipFile(const std::string &filename, std::vector<char> *gz) {
+  std::ifstream ifs(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!ifs) {
+    return false;
+  }
+  ReadStreamToBuffer(ifs, gz);
+  return !gz->empty() && isGzip(&gz->at(0), gz->size());
+}
 
-  (*token) += strspn((*token), " \t");
-  ts.num_ints = atoi((*token));
-  (*token) += strcspn((*token), "/ \t\r");
-  if ((*token)[0] != '/') {
-    return ts;
+#ifdef TINYOBJLOADER_USE_THREADS
+// Inflates gzip data on a background thread, so that parsing overlaps with
+// inflating. The output is sized by gzipSizeHint(), and complete() tells
+// whether the inflated data matched it.
+class GzipReadAhead : public ReadProgress {
+ public:
+  GzipReadAhead(const char *data, size_t len)
+      : m_inflater(data, len),
+        m_buf(gzipSizeHint(data, len)),
+        m_read(0),
+        m_complete(false),
+        m_stop(false) {}
+  ~GzipReadAhead() {
+    if (m_thread.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+      }
+      m_thread.join();
+    }
   }
 
-  (*token)++;  // Skip '/'
+  void start() { m_thread = std::thread(&GzipReadAhead::inflateLoop, this); }
 
-  (*token) += strspn((*token), " \t");
-  ts.num_reals = atoi((*token));
-  (*token) += strcspn((*token), "/ \t\r");
-  if ((*token)[0] != '/') {
-    return ts;
+  const char *data() const { return m_buf.empty() ? NULL : &m_buf.at(0); }
+  size_t size() const { return m_buf.size(); }
+
+  // Waits for the end of the data. False when the data is corrupt or its
+  // inflated size is not the hinted one.
+  bool complete() const {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_read < m_buf.size()) {
+      m_readCond.wait(lock);
+    }
+    return m_complete;
   }
-  (*token)++;  // Skip '/'
 
-  ts.num_strings = parseInt(token);
+  virtual const char *waitFor(const char *p, size_t min_len) const {
+    size_t offset = static_cast<size_t>(p - data());
+    size_t wanted =
+        (min_len < m_buf.size() - offset) ? (offset + min_len) : m_buf.size();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_read < wanted) {
+      m_readCond.wait(lock);
+    }
+    return data() + m_read;
+  }
 
-  return ts;
+ private:
+  GzipReadAhead(const GzipReadAhead &);
+  GzipReadAhead &operator=(const GzipReadAhead &);
+
+  // First block is small so that parsing starts early.
+  static const size_t kFirstBlockSize = 64 * 1024;
+  static const size_t kBlockSize = 1024 * 1024;
+
+  void inflateLoop() {
+    size_t pos = 0;
+    size_t block = kFirstBlockSize;
+    while (pos < m_buf.size()) {
+      size_t n = (block < m_buf.size() - pos) ? block : (m_buf.size() - pos);
+      size_t written = m_inflater.read(&m_buf.at(pos), n);
+      pos += written;
+      if (written < n) {
+        break;  // Shorter than the hint(or corrupt). The rest reads as '\0'.
+      }
+      block = kBlockSize;
+
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_stop) {
+        return;
+      }
+      m_read = pos;
+      m_readCond.notify_all();
+    }
+
+    char extra;
+    bool complete = (pos == m_buf.size()) && (m_inflater.read(&extra, 1) == 0) &&
+                    !m_inflater.failed();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_read = m_buf.size();
+    m_complete = complete;
+    m_readCond.notify_all();
+  }
+
+  GzipInflater m_inflater;
+  std::vector<char> m_buf;
+  size_t m_read;  // # of bytes inflated to `m_buf`.
+  mutable std::mutex m_mutex;
+  mutable std::condition_variable m_readCond;
+  bool m_complete;
+  bool m_stop;
+  std::thread m_thread;
+};
+#endif  // TINYOBJLOADER_USE_THREADS
+#endif  // TINYOBJLOADER_USE_ZLIB
+
+#define IS_SPACE(x) (((x) == ' ') || ((x) == '\t'))
+#define IS_DIGIT(x) \
+  (static_cast<unsigned int>((x) - '0') < static_cast<unsigned int>(10))
+#define IS_NEW_LINE(x) (((x) == '\r') || ((x) == '\n') || ((x) == '\0'))
+
+// Token scanners. `p` must be followed by a terminator and kScanPadding
+// readable bytes(see LineReader).
+
+// strspn(p, " \t")
+static inline const char *skipSpace(const char *p) {
+  if (!IS_SPACE(*p)) {
+    return p;
+  }
+#ifdef TINYOBJLOADER_USE_SSE2
+  const __m128i sp = _mm_set1_epi8(' ');
+  const __m128i tab = _mm_set1_epi8('\t');
+  for (;;) {
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    int mask = _mm_movemask_epi8(
+                   _mm_or_si128(_mm_cmpeq_epi8(c, sp), _mm_cmpeq_epi8(c, tab))) ^
+               0xFFFF;
+    if (mask) {
+      return p + countTrailingZeros(static_cast<unsigned int>(mask));
+    }
+    p += 16;
+  }
+#else
+  while (IS_SPACE(*p)) {
+    p++;
+  }
+  return p;
+#endif
 }
 
-// Parse triples with index offsets: i, i/j/k, i//k, i/j
-static bool parseTriple(const char **token, int vsize, int vnsize, int vtsize,
-                        vertex_index_t *ret) {
-  if (!ret) {
-    return false;
+// strspn(p, " \t\r")
+static inline const char *skipSeparator(const char *p) {
+  while (IS_SPACE(*p) || ((*p) == '\r')) {
+    p++;
   }
+  return p;
+}
 
-  vertex_index_t vi(-1);
+#ifdef TINYOBJLOADER_USE_SSE2
+// Mask of " \t\r\n\0" in 16 bytes at `p`.
+static inline int tokenEndMask(const char *p, __m128i *c) {
+  (*c) = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+  __m128i m = _mm_or_si128(_mm_cmpeq_epi8(*c, _mm_set1_epi8(' ')),
+                           _mm_cmpeq_epi8(*c, _mm_set1_epi8('\t')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(*c, _mm_set1_epi8('\r')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(*c, _mm_set1_epi8('\n')));
+  m = _mm_or_si128(m, _mm_cmpeq_epi8(*c, _mm_setzero_si128()));
+  return _mm_movemask_epi8(m);
+}
+#endif
 
-  if (!fixIndex(atoi((*token)), vsize, &(vi.v_idx))) {
-    return false;
+// p + strcspn(p, " \t\r\n")
+static inline const char *findTokenEnd(const char *p) {
+#ifdef TINYOBJLOADER_USE_SSE2
+  for (;;) {
+    __m128i c;
+    int mask = tokenEndMask(p, &c);
+    if (mask) {
+      return p + countTrailingZeros(static_cast<unsigned int>(mask));
+    }
+    p += 16;
   }
+#else
+  while (!IS_SPACE(*p) && !IS_NEW_LINE(*p)) {
+    p++;
+  }
+  return p;
+#endif
+}
 
-  (*token) += strcspn((*token), "/ \t\r");
-  if ((*token)[0] != '/') {
-    (*ret) = vi;
-    return true;
+// p + strcspn(p, "/ \t\r\n")
+static inline const char *findIndexEnd(const char *p) {
+#ifdef TINYOBJLOADER_USE_SSE2
+  for (;;) {
+    __m128i c;
+    int mask = tokenEndMask(p, &c) |
+               _mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8('/')));
+    if (mask) {
+      return p + countTrailingZeros(static_cast<unsigned int>(mask));
+    }
+    p += 16;
+  }
+#else
+  while (!IS_SPACE(*p) && !IS_NEW_LINE(*p) && ((*p) != '/')) {
+    p++;
   }
-  (*token)++;
+  return p;
+#endif
+}
 
-  // i//k
-  if ((*token)[0] == '/') {
-    (*token)++;
-    if (!fixIndex(atoi((*token)), vnsize, &(vi.vn_idx))) {
-      return false;
+static inline std::string parseString(const char **token) {
+  std::string s;
+  (*token) = skipSpace(*token);
+  const char *e = findTokenEnd(*token);
+  s = std::string((*token), e);
+  (*token) = e;
+  return s;
+}
+
+static inline int parseInt(const char **token) {
+  (*token) = skipSpace(*token);
+  int i = atoi((*token));
+  (*token) = findTokenEnd(*token);
+  return i;
+}
+
+// 64-bit unsigned integer used by the float parser.
+typedef unsigned long long fp_u64_t;
+
+// 128-bit approximations of 5^q for q in [-342, 308], stored as pairs of
+// (high, low) 64-bit words and normalized so that the top bit is set.
+// Used by the Eisel-Lemire algorithm in computeDouble().
+static const int kSmallestPowerOfFive = -342;
+static const int kLargestPowerOfFive = 308;
+static const fp_u64_t kPowerOfFive128[] = {
+    0xeef453d6923bd65aULL, 0x113faa2906a13b3fULL,
+    0x9558b4661b6565f8ULL, 0x4ac7ca59a424c507ULL,
+    0xbaaee17fa23ebf76ULL, 0x5d79bcf00d2df649ULL,
+    0xe95a99df8ace6f53ULL, 0xf4d82c2c107973dcULL,
+    0x91d8a02bb6c10594ULL, 0x79071b9b8a4be869ULL,
+    0xb64ec836a47146f9ULL, 0x9748e2826cdee284ULL,
+    0xe3e27a444d8d98b7ULL, 0xfd1b1b2308169b25ULL,
+    0x8e6d8c6ab0787f72ULL, 0xfe30f0f5e50e20f7ULL,
+    0xb208ef855c969f4fULL, 0xbdbd2d335e51a935ULL,
+    0xde8b2b66b3bc4723ULL, 0xad2c788035e61382ULL,
+    0x8b16fb203055ac76ULL, 0x4c3bcb5021afcc31ULL,
+    0xaddcb9e83c6b1793ULL, 0xdf4abe242a1bbf3dULL,
+    0xd953e8624b85dd78ULL, 0xd71d6dad34a2af0dULL,
+    0x87d4713d6f33aa6bULL, 0x8672648c40e5ad68ULL,
+    0xa9c98d8ccb009506ULL, 0x680efdaf511f18c2ULL,
+    0xd43bf0effdc0ba48ULL, 0x0212bd1b2566def2ULL,
+    0x84a57695fe98746dULL, 0x014bb630f7604b57ULL,
+    0xa5ced43b7e3e9188ULL, 0x419ea3bd35385e2dULL,
+    0xcf42894a5dce35eaULL, 0x52064cac828675b9ULL,
+    0x818995ce7aa0e1b2ULL, 0x7343efebd1940993ULL,
+    0xa1ebfb4219491a1fULL, 0x1014ebe6c5f90bf8ULL,
+    0xca66fa129f9b60a6ULL, 0xd41a26e077774ef6ULL,
+    0xfd00b897478238d0ULL, 0x8920b098955522b4ULL,
+    0x9e20735e8cb16382ULL, 0x55b46e5f5d5535b0ULL,
+    0xc5a890362fddbc62ULL, 0xeb2189f734aa831dULL,
+    0xf712b443bbd52b7bULL, 0xa5e9ec7501d523e4ULL,
+    0x9a6bb0aa55653b2dULL, 0x47b233c92125366eULL,
+    0xc1069cd4eabe89f8ULL, 0x999ec0bb696e840aULL,
+    0xf148440a256e2c76ULL, 0xc00670ea43ca250dULL,
+    0x96cd2a865764dbcaULL, 0x380406926a5e5728ULL,
+    0xbc807527ed3e12bcULL, 0xc605083704f5ecf2ULL,
+    0xeba09271e88d976bULL, 0xf7864a44c633682eULL,
+    0x93445b8731587ea3ULL, 0x7ab3ee6afbe0211dULL,
+    0xb8157268fdae9e4cULL, 0x5960ea05bad82964ULL,
+    0xe61acf033d1a45dfULL, 0x6fb92487298e33bdULL,
+    0x8fd0c16206306babULL, 0xa5d3b6d479f8e056ULL,
+    0xb3c4f1ba87bc8696ULL, 0x8f48a4899877186cULL,
+    0xe0b62e2929aba83cULL, 0x331acdabfe94de87ULL,
+    0x8c71dcd9ba0b4925ULL, 0x9ff0c08b7f1d0b14ULL,
+    0xaf8e5410288e1b6fULL, 0x07ecf0ae5ee44dd9ULL,
+    0xdb71e91432b1a24aULL, 0xc9e82cd9f69d6150ULL,
+    0x892731ac9faf056eULL, 0xbe311c083a225cd2ULL,
+    0xab70fe17c79ac6caULL, 0x6dbd630a48aaf406ULL,
+    0xd64d3d9db981787dULL, 0x092cbbccdad5b108ULL,
+    0x85f0468293f0eb4eULL, 0x25bbf56008c58ea5ULL,
+    0xa76c582338ed2621ULL, 0xaf2af2b80af6f24eULL,
+    0xd1476e2c07286faaULL, 0x1af5af660db4aee1ULL,
+    0x82cca4db847945caULL, 0x50d98d9fc890ed4dULL,
+    0xa37fce126597973cULL, 0xe50ff107bab528a0ULL,
+    0xcc5fc196fefd7d0cULL, 0x1e53ed49a96272c8ULL,
+    0xff77b1fcbebcdc4fULL, 0x25e8e89c13bb0f7aULL,
+    0x9faacf3df73609b1ULL, 0x77b191618c54e9acULL,
+    0xc795830d75038c1dULL, 0xd59df5b9ef6a2417ULL,
+    0xf97ae3d0d2446f25ULL, 0x4b0573286b44ad1dULL,
+    0x9becce62836ac577ULL, 0x4ee367f9430aec32ULL,
+    0xc2e801fb244576d5ULL, 0x229c41f793cda73fULL,
+    0xf3a20279ed56d48aULL, 0x6b43527578c1110fULL,
+    0x9845418c345644d6ULL, 0x830a13896b78aaa9ULL,
+    0xbe5691ef416bd60cULL, 0x23cc986bc656d553ULL,
+    0xedec366b11c6cb8fULL, 0x2cbfbe86b7ec8aa8ULL,
+    0x94b3a202eb1c3f39ULL, 0x7bf7d71432f3d6a9ULL,
+    0xb9e08a83a5e34f07ULL, 0xdaf5ccd93fb0cc53ULL,
+    0xe858ad248f5c22c9ULL, 0xd1b3400f8f9cff68ULL,
+    0x91376c36d99995beULL, 0x23100809b9c21fa1ULL,
+    0xb58547448ffffb2dULL, 0xabd40a0c2832a78aULL,
+    0xe2e69915b3fff9f9ULL, 0x16c90c8f323f516cULL,
+    0x8dd01fad907ffc3bULL, 0xae3da7d97f6792e3ULL,
+    0xb1442798f49ffb4aULL, 0x99cd11cfdf41779cULL,
+    0xdd95317f31c7fa1dULL, 0x40405643d711d583ULL,
+    0x8a7d3eef7f1cfc52ULL, 0x482835ea666b2572ULL,
+    0xad1c8eab5ee43b66ULL, 0xda3243650005eecfULL,
+    0xd863b256369d4a40ULL, 0x90bed43e40076a82ULL,
+    0x873e4f75e2224e68ULL, 0x5a7744a6e804a291ULL,
+    0xa90de3535aaae202ULL, 0x711515d0a205cb36ULL,
+    0xd3515c2831559a83ULL, 0x0d5a5b44ca873e03ULL,
+    0x8412d9991ed58091ULL, 0xe858790afe9486c2ULL,
+    0xa5178fff668ae0b6ULL, 0x626e974dbe39a872ULL,
+    0xce5d73ff402d98e3ULL, 0xfb0a3d212dc8128fULL,
+    0x80fa687f881c7f8eULL, 0x7ce66634bc9d0b99ULL,
+    0xa139029f6a239f72ULL, 0x1c1fffc1ebc44e80ULL,
+    0xc987434744ac874eULL, 0xa327ffb266b56220ULL,
+    0xfbe9141915d7a922ULL, 0x4bf1ff9f0062baa8ULL,
+    0x9d71ac8fada6c9b5ULL, 0x6f773fc3603db4a9ULL,
+    0xc4ce17b399107c22ULL, 0xcb550fb4384d21d3ULL,
+    0xf6019da07f549b2bULL, 0x7e2a53a146606a48ULL,
+    0x99c102844f94e0fbULL, 0x2eda7444cbfc426dULL,
+    0xc0314325637a1939ULL, 0xfa911155fefb5308ULL,
+    0xf03d93eebc589f88ULL, 0x793555ab7eba27caULL,
+    0x96267c7535b763b5ULL, 0x4bc1558b2f3458deULL,
+    0xbbb01b9283253ca2ULL, 0x9eb1aaedfb016f16ULL,
+    0xea9c227723ee8bcbULL, 0x465e15a979c1cadcULL,
+    0x92a1958a7675175fULL, 0x0bfacd89ec191ec9ULL,
+    0xb749faed14125d36ULL, 0xcef980ec671f667bULL,
+    0xe51c79a85916f484ULL, 0x82b7e12780e7401aULL,
+    0x8f31cc0937ae58d2ULL, 0xd1b2ecb8b0908810ULL,
+    0xb2fe3f0b8599ef07ULL, 0x861fa7e6dcb4aa15ULL,
+    0xdfbdcece67006ac9ULL, 0x67a791e093e1d49aULL,
+    0x8bd6a141006042bdULL, 0xe0c8bb2c5c6d24e0ULL,
+    0xaecc49914078536dULL, 0x58fae9f773886e18ULL,
+    0xda7f5bf590966848ULL, 0xaf39a475506a899eULL,
+    0x888f99797a5e012dULL, 0x6d8406c952429603ULL,
+    0xaab37fd7d8f58178ULL, 0xc8e5087ba6d33b83ULL,
+    0xd5605fcdcf32e1d6ULL, 0xfb1e4a9a90880a64ULL,
+    0x855c3be0a17fcd26ULL, 0x5cf2eea09a55067fULL,
+    0xa6b34ad8c9dfc06fULL, 0xf42faa48c0ea481eULL,
+    0xd0601d8efc57b08bULL, 0xf13b94daf124da26ULL,
+    0x823c12795db6ce57ULL, 0x76c53d08d6b70858ULL,
+    0xa2cb1717b52481edULL, 0x54768c4b0c64ca6eULL,
+    0xcb7ddcdda26da268ULL, 0xa9942f5dcf7dfd09ULL,
+    0xfe5d54150b090b02ULL, 0xd3f93b35435d7c4cULL,
+    0x9efa548d26e5a6e1ULL, 0xc47bc5014a1a6dafULL,
+    0xc6b8e9b0709f109aULL, 0x359ab6419ca1091bULL,
+    0xf867241c8cc6d4c0ULL, 0xc30163d203c94b62ULL,
+    0x9b407691d7fc44f8ULL, 0x79e0de63425dcf1dULL,
+    0xc21094364dfb5636ULL, 0x985915fc12f542e4ULL,
+    0xf294b943e17a2bc4ULL, 0x3e6f5b7b17b2939dULL,
+    0x979cf3ca6cec5b5aULL, 0xa705992ceecf9c42ULL,
+    0xbd8430bd08277231ULL, 0x50c6ff782a838353ULL,
+    0xece53cec4a314ebdULL, 0xa4f8bf5635246428ULL,
+    0x940f4613ae5ed136ULL, 0x871b7795e136be99ULL,
+    0xb913179899f68584ULL, 0x28e2557b59846e3fULL,
+    0xe757dd7ec07426e5ULL, 0x331aeada2fe589cfULL,
+    0x9096ea6f3848984fULL, 0x3ff0d2c85def7621ULL,
+    0xb4bca50b065abe63ULL, 0x0fed077a756b53a9ULL,
+    0xe1ebce4dc7f16dfbULL, 0xd3e8495912c62894ULL,
+    0x8d3360f09cf6e4bdULL, 0x64712dd7abbbd95cULL,
+    0xb080392cc4349decULL, 0xbd8d794d96aacfb3ULL,
+    0xdca04777f541c567ULL, 0xecf0d7a0fc5583a0ULL,
+    0x89e42caaf9491b60ULL, 0xf41686c49db57244ULL,
+    0xac5d37d5b79b6239ULL, 0x311c2875c522ced5ULL,
+    0xd77485cb25823ac7ULL, 0x7d633293366b828bULL,
+    0x86a8d39ef77164bcULL, 0xae5dff9c02033197ULL,
+    0xa8530886b54dbdebULL, 0xd9f57f830283fdfcULL,
+    0xd267caa862a12d66ULL, 0xd072df63c324fd7bULL,
+    0x8380dea93da4bc60ULL, 0x4247cb9e59f71e6dULL,
+    0xa46116538d0deb78ULL, 0x52d9be85f074e608ULL,
+    0xcd795be870516656ULL, 0x67902e276c921f8bULL,
+    0x806bd9714632dff6ULL, 0x00ba1cd8a3db53b6ULL,
+    0xa086cfcd97bf97f3ULL, 0x80e8a40eccd228a4ULL,
+    0xc8a883c0fdaf7df0ULL, 0x6122cd128006b2cdULL,
+    0xfad2a4b13d1b5d6cULL, 0x796b805720085f81ULL,
+    0x9cc3a6eec6311a63ULL, 0xcbe3303674053bb0ULL,
+    0xc3f490aa77bd60fcULL, 0xbedbfc4411068a9cULL,
+    0xf4f1b4d515acb93bULL, 0xee92fb5515482d44ULL,
+    0x991711052d8bf3c5ULL, 0x751bdd152d4d1c4aULL,
+    0xbf5cd54678eef0b6ULL, 0xd262d45a78a0635dULL,
+    0xef340a98172aace4ULL, 0x86fb897116c87c34ULL,
+    0x9580869f0e7aac0eULL, 0xd45d35e6ae3d4da0ULL,
+    0xbae0a846d2195712ULL, 0x8974836059cca109ULL,
+    0xe998d258869facd7ULL, 0x2bd1a438703fc94bULL,
+    0x91ff83775423cc06ULL, 0x7b6306a34627ddcfULL,
+    0xb67f6455292cbf08ULL, 0x1a3bc84c17b1d542ULL,
+    0xe41f3d6a7377eecaULL, 0x20caba5f1d9e4a93ULL,
+    0x8e938662882af53eULL, 0x547eb47b7282ee9cULL,
+    0xb23867fb2a35b28dULL, 0xe99e619a4f23aa43ULL,
+    0xdec681f9f4c31f31ULL, 0x6405fa00e2ec94d4ULL,
+    0x8b3c113c38f9f37eULL, 0xde83bc408dd3dd04ULL,
+    0xae0b158b4738705eULL, 0x9624ab50b148d445ULL,
+    0xd98ddaee19068c76ULL, 0x3badd624dd9b0957ULL,
+    0x87f8a8d4cfa417c9ULL, 0xe54ca5d70a80e5d6ULL,
+    0xa9f6d30a038d1dbcULL, 0x5e9fcf4ccd211f4cULL,
+    0xd47487cc8470652bULL, 0x7647c3200069671fULL,
+    0x84c8d4dfd2c63f3bULL, 0x29ecd9f40041e073ULL,
+    0xa5fb0a17c777cf09ULL, 0xf468107100525890ULL,
+    0xcf79cc9db955c2ccULL, 0x7182148d4066eeb4ULL,
+    0x81ac1fe293d599bfULL, 0xc6f14cd848405530ULL,
+    0xa21727db38cb002fULL, 0xb8ada00e5a506a7cULL,
+    0xca9cf1d206fdc03bULL, 0xa6d90811f0e4851cULL,
+    0xfd442e4688bd304aULL, 0x908f4a166d1da663ULL,
+    0x9e4a9cec15763e2eULL, 0x9a598e4e043287feULL,
+    0xc5dd44271ad3cdbaULL, 0x40eff1e1853f29fdULL,
+    0xf7549530e188c128ULL, 0xd12bee59e68ef47cULL,
+    0x9a94dd3e8cf578b9ULL, 0x82bb74f8301958ceULL,
+    0xc13a148e3032d6e7ULL, 0xe36a52363c1faf01ULL,
+    0xf18899b1bc3f8ca1ULL, 0xdc44e6c3cb279ac1ULL,
+    0x96f5600f15a7b7e5ULL, 0x29ab103a5ef8c0b9ULL,
+    0xbcb2b812db11a5deULL, 0x7415d448f6b6f0e7ULL,
+    0xebdf661791d60f56ULL, 0x111b495b3464ad21ULL,
+    0x936b9fcebb25c995ULL, 0xcab10dd900beec34ULL,
+    0xb84687c269ef3bfbULL, 0x3d5d514f40eea742ULL,
+    0xe65829b3046b0afaULL, 0x0cb4a5a3112a5112ULL,
+    0x8ff71a0fe2c2e6dcULL, 0x47f0e785eaba72abULL,
+    0xb3f4e093db73a093ULL, 0x59ed216765690f56ULL,
+    0xe0f218b8d25088b8ULL, 0x306869c13ec3532cULL,
+    0x8c974f7383725573ULL, 0x1e414218c73a13fbULL,
+    0xafbd2350644eeacfULL, 0xe5d1929ef90898faULL,
+    0xdbac6c247d62a583ULL, 0xdf45f746b74abf39ULL,
+    0x894bc396ce5da772ULL, 0x6b8bba8c328eb783ULL,
+    0xab9eb47c81f5114fULL, 0x066ea92f3f326564ULL,
+    0xd686619ba27255a2ULL, 0xc80a537b0efefebdULL,
+    0x8613fd0145877585ULL, 0xbd06742ce95f5f36ULL,
+    0xa798fc4196e952e7ULL, 0x2c48113823b73704ULL,
+    0xd17f3b51fca3a7a0ULL, 0xf75a15862ca504c5ULL,
+    0x82ef85133de648c4ULL, 0x9a984d73dbe722fbULL,
+    0xa3ab66580d5fdaf5ULL, 0xc13e60d0d2e0ebbaULL,
+    0xcc963fee10b7d1b3ULL, 0x318df905079926a8ULL,
+    0xffbbcfe994e5c61fULL, 0xfdf17746497f7052ULL,
+    0x9fd561f1fd0f9bd3ULL, 0xfeb6ea8bedefa633ULL,
+    0xc7caba6e7c5382c8ULL, 0xfe64a52ee96b8fc0ULL,
+    0xf9bd690a1b68637bULL, 0x3dfdce7aa3c673b0ULL,
+    0x9c1661a651213e2dULL, 0x06bea10ca65c084eULL,
+    0xc31bfa0fe5698db8ULL, 0x486e494fcff30a62ULL,
+    0xf3e2f893dec3f126ULL, 0x5a89dba3c3efccfaULL,
+    0x986ddb5c6b3a76b7ULL, 0xf89629465a75e01cULL,
+    0xbe89523386091465ULL, 0xf6bbb397f1135823ULL,
+    0xee2ba6c0678b597fULL, 0x746aa07ded582e2cULL,
+    0x94db483840b717efULL, 0xa8c2a44eb4571cdcULL,
+    0xba121a4650e4ddebULL, 0x92f34d62616ce413ULL,
+    0xe896a0d7e51e1566ULL, 0x77b020baf9c81d17ULL,
+    0x915e2486ef32cd60ULL, 0x0ace1474dc1d122eULL,
+    0xb5b5ada8aaff80b8ULL, 0x0d819992132456baULL,
+    0xe3231912d5bf60e6ULL, 0x10e1fff697ed6c69ULL,
+    0x8df5efabc5979c8fULL, 0xca8d3ffa1ef463c1ULL,
+    0xb1736b96b6fd83b3ULL, 0xbd308ff8a6b17cb2ULL,
+    0xddd0467c64bce4a0ULL, 0xac7cb3f6d05ddbdeULL,
+    0x8aa22c0dbef60ee4ULL, 0x6bcdf07a423aa96bULL,
+    0xad4ab7112eb3929dULL, 0x86c16c98d2c953c6ULL,
+    0xd89d64d57a607744ULL, 0xe871c7bf077ba8b7ULL,
+    0x87625f056c7c4a8bULL, 0x11471cd764ad4972ULL,
+    0xa93af6c6c79b5d2dULL, 0xd598e40d3dd89bcfULL,
+    0xd389b47879823479ULL, 0x4aff1d108d4ec2c3ULL,
+    0x843610cb4bf160cbULL, 0xcedf722a585139baULL,
+    0xa54394fe1eedb8feULL, 0xc2974eb4ee658828ULL,
+    0xce947a3da6a9273eULL, 0x733d226229feea32ULL,
+    0x811ccc668829b887ULL, 0x0806357d5a3f525fULL,
+    0xa163ff802a3426a8ULL, 0xca07c2dcb0cf26f7ULL,
+    0xc9bcff6034c13052ULL, 0xfc89b393dd02f0b5ULL,
+    0xfc2c3f3841f17c67ULL, 0xbbac2078d443ace2ULL,
+    0x9d9ba7832936edc0ULL, 0xd54b944b84aa4c0dULL,
+    0xc5029163f384a931ULL, 0x0a9e795e65d4df11ULL,
+    0xf64335bcf065d37dULL, 0x4d4617b5ff4a16d5ULL,
+    0x99ea0196163fa42eULL, 0x504bced1bf8e4e45ULL,
+    0xc06481fb9bcf8d39ULL, 0xe45ec2862f71e1d6ULL,
+    0xf07da27a82c37088ULL, 0x5d767327bb4e5a4cULL,
+    0x964e858c91ba2655ULL, 0x3a6a07f8d510f86fULL,
+    0xbbe226efb628afeaULL, 0x890489f70a55368bULL,
+    0xeadab0aba3b2dbe5ULL, 0x2b45ac74ccea842eULL,
+    0x92c8ae6b464fc96fULL, 0x3b0b8bc90012929dULL,
+    0xb77ada0617e3bbcbULL, 0x09ce6ebb40173744ULL,
+    0xe55990879ddcaabdULL, 0xcc420a6a101d0515ULL,
+    0x8f57fa54c2a9eab6ULL, 0x9fa946824a12232dULL,
+    0xb32df8e9f3546564ULL, 0x47939822dc96abf9ULL,
+    0xdff9772470297ebdULL, 0x59787e2b93bc56f7ULL,
+    0x8bfbea76c619ef36ULL, 0x57eb4edb3c55b65aULL,
+    0xaefae51477a06b03ULL, 0xede622920b6b23f1ULL,
+    0xdab99e59958885c4ULL, 0xe95fab368e45ecedULL,
+    0x88b402f7fd75539bULL, 0x11dbcb0218ebb414ULL,
+    0xaae103b5fcd2a881ULL, 0xd652bdc29f26a119ULL,
+    0xd59944a37c0752a2ULL, 0x4be76d3346f0495fULL,
+    0x857fcae62d8493a5ULL, 0x6f70a4400c562ddbULL,
+    0xa6dfbd9fb8e5b88eULL, 0xcb4ccd500f6bb952ULL,
+    0xd097ad07a71f26b2ULL, 0x7e2000a41346a7a7ULL,
+    0x825ecc24c873782fULL, 0x8ed400668c0c28c8ULL,
+    0xa2f67f2dfa90563bULL, 0x728900802f0f32faULL,
+    0xcbb41ef979346bcaULL, 0x4f2b40a03ad2ffb9ULL,
+    0xfea126b7d78186bcULL, 0xe2f610c84987bfa8ULL,
+    0x9f24b832e6b0f436ULL, 0x0dd9ca7d2df4d7c9ULL,
+    0xc6ede63fa05d3143ULL, 0x91503d1c79720dbbULL,
+    0xf8a95fcf88747d94ULL, 0x75a44c6397ce912aULL,
+    0x9b69dbe1b548ce7cULL, 0xc986afbe3ee11abaULL,
+    0xc24452da229b021bULL, 0xfbe85badce996168ULL,
+    0xf2d56790ab41c2a2ULL, 0xfae27299423fb9c3ULL,
+    0x97c560ba6b0919a5ULL, 0xdccd879fc967d41aULL,
+    0xbdb6b8e905cb600fULL, 0x5400e987bbc1c920ULL,
+    0xed246723473e3813ULL, 0x290123e9aab23b68ULL,
+    0x9436c0760c86e30bULL, 0xf9a0b6720aaf6521ULL,
+    0xb94470938fa89bceULL, 0xf808e40e8d5b3e69ULL,
+    0xe7958cb87392c2c2ULL, 0xb60b1d1230b20e04ULL,
+    0x90bd77f3483bb9b9ULL, 0xb1c6f22b5e6f48c2ULL,
+    0xb4ecd5f01a4aa828ULL, 0x1e38aeb6360b1af3ULL,
+    0xe2280b6c20dd5232ULL, 0x25c6da63c38de1b0ULL,
+    0x8d590723948a535fULL, 0x579c487e5a38ad0eULL,
+    0xb0af48ec79ace837ULL, 0x2d835a9df0c6d851ULL,
+    0xdcdb1b2798182244ULL, 0xf8e431456cf88e65ULL,
+    0x8a08f0f8bf0f156bULL, 0x1b8e9ecb641b58ffULL,
+    0xac8b2d36eed2dac5ULL, 0xe272467e3d222f3fULL,
+    0xd7adf884aa879177ULL, 0x5b0ed81dcc6abb0fULL,
+    0x86ccbb52ea94baeaULL, 0x98e947129fc2b4e9ULL,
+    0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL,
+    0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL,
+    0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL,
+    0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL,
+    0xcdb02555653131b6ULL, 0x3792f412cb06794dULL,
+    0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL,
+    0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL,
+    0xc8de047564d20a8bULL, 0xf245825a5a445275ULL,
+    0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL,
+    0x9ced737bb6c4183dULL, 0x55464dd69685606bULL,
+    0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL,
+    0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL,
+    0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL,
+    0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL,
+    0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL,
+    0x95a8637627989aadULL, 0xdde7001379a44aa8ULL,
+    0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL,
+    0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL,
+    0x9226712162ab070dULL, 0xcab3961304ca70e8ULL,
+    0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL,
+    0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL,
+    0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL,
+    0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL,
+    0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL,
+    0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL,
+    0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL,
+    0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL,
+    0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL,
+    0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL,
+    0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL,
+    0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL,
+    0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL,
+    0xcfb11ead453994baULL, 0x67de18eda5814af2ULL,
+    0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL,
+    0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL,
+    0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL,
+    0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL,
+    0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL,
+    0xc612062576589ddaULL, 0x95364afe032a819eULL,
+    0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL,
+    0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL,
+    0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL,
+    0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL,
+    0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL,
+    0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL,
+    0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL,
+    0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL,
+    0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL,
+    0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL,
+    0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL,
+    0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL,
+    0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL,
+    0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL,
+    0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL,
+    0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL,
+    0x89705f4136b4a597ULL, 0x31680a88f8953031ULL,
+    0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL,
+    0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL,
+    0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL,
+    0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL,
+    0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL,
+    0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL,
+    0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL,
+    0xccccccccccccccccULL, 0xcccccccccccccccdULL,
+    0x8000000000000000ULL, 0x0000000000000000ULL,
+    0xa000000000000000ULL, 0x0000000000000000ULL,
+    0xc800000000000000ULL, 0x0000000000000000ULL,
+    0xfa00000000000000ULL, 0x0000000000000000ULL,
+    0x9c40000000000000ULL, 0x0000000000000000ULL,
+    0xc350000000000000ULL, 0x0000000000000000ULL,
+    0xf424000000000000ULL, 0x0000000000000000ULL,
+    0x9896800000000000ULL, 0x0000000000000000ULL,
+    0xbebc200000000000ULL, 0x0000000000000000ULL,
+    0xee6b280000000000ULL, 0x0000000000000000ULL,
+    0x9502f90000000000ULL, 0x0000000000000000ULL,
+    0xba43b74000000000ULL, 0x0000000000000000ULL,
+    0xe8d4a51000000000ULL, 0x0000000000000000ULL,
+    0x9184e72a00000000ULL, 0x0000000000000000ULL,
+    0xb5e620f480000000ULL, 0x0000000000000000ULL,
+    0xe35fa931a0000000ULL, 0x0000000000000000ULL,
+    0x8e1bc9bf04000000ULL, 0x0000000000000000ULL,
+    0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL,
+    0xde0b6b3a76400000ULL, 0x0000000000000000ULL,
+    0x8ac7230489e80000ULL, 0x0000000000000000ULL,
+    0xad78ebc5ac620000ULL, 0x0000000000000000ULL,
+    0xd8d726b7177a8000ULL, 0x0000000000000000ULL,
+    0x878678326eac9000ULL, 0x0000000000000000ULL,
+    0xa968163f0a57b400ULL, 0x0000000000000000ULL,
+    0xd3c21bcecceda100ULL, 0x0000000000000000ULL,
+    0x84595161401484a0ULL, 0x0000000000000000ULL,
+    0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL,
+    0xcecb8f27f4200f3aULL, 0x0000000000000000ULL,
+    0x813f3978f8940984ULL, 0x4000000000000000ULL,
+    0xa18f07d736b90be5ULL, 0x5000000000000000ULL,
+    0xc9f2c9cd04674edeULL, 0xa400000000000000ULL,
+    0xfc6f7c4045812296ULL, 0x4d00000000000000ULL,
+    0x9dc5ada82b70b59dULL, 0xf020000000000000ULL,
+    0xc5371912364ce305ULL, 0x6c28000000000000ULL,
+    0xf684df56c3e01bc6ULL, 0xc732000000000000ULL,
+    0x9a130b963a6c115cULL, 0x3c7f400000000000ULL,
+    0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL,
+    0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL,
+    0x96769950b50d88f4ULL, 0x1314448000000000ULL,
+    0xbc143fa4e250eb31ULL, 0x17d955a000000000ULL,
+    0xeb194f8e1ae525fdULL, 0x5dcfab0800000000ULL,
+    0x92efd1b8d0cf37beULL, 0x5aa1cae500000000ULL,
+    0xb7abc627050305adULL, 0xf14a3d9e40000000ULL,
+    0xe596b7b0c643c719ULL, 0x6d9ccd05d0000000ULL,
+    0x8f7e32ce7bea5c6fULL, 0xe4820023a2000000ULL,
+    0xb35dbf821ae4f38bULL, 0xdda2802c8a800000ULL,
+    0xe0352f62a19e306eULL, 0xd50b2037ad200000ULL,
+    0x8c213d9da502de45ULL, 0x4526f422cc340000ULL,
+    0xaf298d050e4395d6ULL, 0x9670b12b7f410000ULL,
+    0xdaf3f04651d47b4cULL, 0x3c0cdd765f114000ULL,
+    0x88d8762bf324cd0fULL, 0xa5880a69fb6ac800ULL,
+    0xab0e93b6efee0053ULL, 0x8eea0d047a457a00ULL,
+    0xd5d238a4abe98068ULL, 0x72a4904598d6d880ULL,
+    0x85a36366eb71f041ULL, 0x47a6da2b7f864750ULL,
+    0xa70c3c40a64e6c51ULL, 0x999090b65f67d924ULL,
+    0xd0cf4b50cfe20765ULL, 0xfff4b4e3f741cf6dULL,
+    0x82818f1281ed449fULL, 0xbff8f10e7a8921a4ULL,
+    0xa321f2d7226895c7ULL, 0xaff72d52192b6a0dULL,
+    0xcbea6f8ceb02bb39ULL, 0x9bf4f8a69f764490ULL,
+    0xfee50b7025c36a08ULL, 0x02f236d04753d5b4ULL,
+    0x9f4f2726179a2245ULL, 0x01d762422c946590ULL,
+    0xc722f0ef9d80aad6ULL, 0x424d3ad2b7b97ef5ULL,
+    0xf8ebad2b84e0d58bULL, 0xd2e0898765a7deb2ULL,
+    0x9b934c3b330c8577ULL, 0x63cc55f49f88eb2fULL,
+    0xc2781f49ffcfa6d5ULL, 0x3cbf6b71c76b25fbULL,
+    0xf316271c7fc3908aULL, 0x8bef464e3945ef7aULL,
+    0x97edd871cfda3a56ULL, 0x97758bf0e3cbb5acULL,
+    0xbde94e8e43d0c8ecULL, 0x3d52eeed1cbea317ULL,
+    0xed63a231d4c4fb27ULL, 0x4ca7aaa863ee4bddULL,
+    0x945e455f24fb1cf8ULL, 0x8fe8caa93e74ef6aULL,
+    0xb975d6b6ee39e436ULL, 0xb3e2fd538e122b44ULL,
+    0xe7d34c64a9c85d44ULL, 0x60dbbca87196b616ULL,
+    0x90e40fbeea1d3a4aULL, 0xbc8955e946fe31cdULL,
+    0xb51d13aea4a488ddULL, 0x6babab6398bdbe41ULL,
+    0xe264589a4dcdab14ULL, 0xc696963c7eed2dd1ULL,
+    0x8d7eb76070a08aecULL, 0xfc1e1de5cf543ca2ULL,
+    0xb0de65388cc8ada8ULL, 0x3b25a55f43294bcbULL,
+    0xdd15fe86affad912ULL, 0x49ef0eb713f39ebeULL,
+    0x8a2dbf142dfcc7abULL, 0x6e3569326c784337ULL,
+    0xacb92ed9397bf996ULL, 0x49c2c37f07965404ULL,
+    0xd7e77a8f87daf7fbULL, 0xdc33745ec97be906ULL,
+    0x86f0ac99b4e8dafdULL, 0x69a028bb3ded71a3ULL,
+    0xa8acd7c0222311bcULL, 0xc40832ea0d68ce0cULL,
+    0xd2d80db02aabd62bULL, 0xf50a3fa490c30190ULL,
+    0x83c7088e1aab65dbULL, 0x792667c6da79e0faULL,
+    0xa4b8cab1a1563f52ULL, 0x577001b891185938ULL,
+    0xcde6fd5e09abcf26ULL, 0xed4c0226b55e6f86ULL,
+    0x80b05e5ac60b6178ULL, 0x544f8158315b05b4ULL,
+    0xa0dc75f1778e39d6ULL, 0x696361ae3db1c721ULL,
+    0xc913936dd571c84cULL, 0x03bc3a19cd1e38e9ULL,
+    0xfb5878494ace3a5fULL, 0x04ab48a04065c723ULL,
+    0x9d174b2dcec0e47bULL, 0x62eb0d64283f9c76ULL,
+    0xc45d1df942711d9aULL, 0x3ba5d0bd324f8394ULL,
+    0xf5746577930d6500ULL, 0xca8f44ec7ee36479ULL,
+    0x9968bf6abbe85f20ULL, 0x7e998b13cf4e1ecbULL,
+    0xbfc2ef456ae276e8ULL, 0x9e3fedd8c321a67eULL,
+    0xefb3ab16c59b14a2ULL, 0xc5cfe94ef3ea101eULL,
+    0x95d04aee3b80ece5ULL, 0xbba1f1d158724a12ULL,
+    0xbb445da9ca61281fULL, 0x2a8a6e45ae8edc97ULL,
+    0xea1575143cf97226ULL, 0xf52d09d71a3293bdULL,
+    0x924d692ca61be758ULL, 0x593c2626705f9c56ULL,
+    0xb6e0c377cfa2e12eULL, 0x6f8b2fb00c77836cULL,
+    0xe498f455c38b997aULL, 0x0b6dfb9c0f956447ULL,
+    0x8edf98b59a373fecULL, 0x4724bd4189bd5eacULL,
+    0xb2977ee300c50fe7ULL, 0x58edec91ec2cb657ULL,
+    0xdf3d5e9bc0f653e1ULL, 0x2f2967b66737e3edULL,
+    0x8b865b215899f46cULL, 0xbd79e0d20082ee74ULL,
+    0xae67f1e9aec07187ULL, 0xecd8590680a3aa11ULL,
+    0xda01ee641a708de9ULL, 0xe80e6f4820cc9495ULL,
+    0x884134fe908658b2ULL, 0x3109058d147fdcddULL,
+    0xaa51823e34a7eedeULL, 0xbd4b46f0599fd415ULL,
+    0xd4e5e2cdc1d1ea96ULL, 0x6c9e18ac7007c91aULL,
+    0x850fadc09923329eULL, 0x03e2cf6bc604ddb0ULL,
+    0xa6539930bf6bff45ULL, 0x84db8346b786151cULL,
+    0xcfe87f7cef46ff16ULL, 0xe612641865679a63ULL,
+    0x81f14fae158c5f6eULL, 0x4fcb7e8f3f60c07eULL,
+    0xa26da3999aef7749ULL, 0xe3be5e330f38f09dULL,
+    0xcb090c8001ab551cULL, 0x5cadf5bfd3072cc5ULL,
+    0xfdcb4fa002162a63ULL, 0x73d9732fc7c8f7f6ULL,
+    0x9e9f11c4014dda7eULL, 0x2867e7fddcdd9afaULL,
+    0xc646d63501a1511dULL, 0xb281e1fd541501b8ULL,
+    0xf7d88bc24209a565ULL, 0x1f225a7ca91a4226ULL,
+    0x9ae757596946075fULL, 0x3375788de9b06958ULL,
+    0xc1a12d2fc3978937ULL, 0x0052d6b1641c83aeULL,
+    0xf209787bb47d6b84ULL, 0xc0678c5dbd23a49aULL,
+    0x9745eb4d50ce6332ULL, 0xf840b7ba963646e0ULL,
+    0xbd176620a501fbffULL, 0xb650e5a93bc3d898ULL,
+    0xec5d3fa8ce427affULL, 0xa3e51f138ab4cebeULL,
+    0x93ba47c980e98cdfULL, 0xc66f336c36b10137ULL,
+    0xb8a8d9bbe123f017ULL, 0xb80b0047445d4184ULL,
+    0xe6d3102ad96cec1dULL, 0xa60dc059157491e5ULL,
+    0x9043ea1ac7e41392ULL, 0x87c89837ad68db2fULL,
+    0xb454e4a179dd1877ULL, 0x29babe4598c311fbULL,
+    0xe16a1dc9d8545e94ULL, 0xf4296dd6fef3d67aULL,
+    0x8ce2529e2734bb1dULL, 0x1899e4a65f58660cULL,
+    0xb01ae745b101e9e4ULL, 0x5ec05dcff72e7f8fULL,
+    0xdc21a1171d42645dULL, 0x76707543f4fa1f73ULL,
+    0x899504ae72497ebaULL, 0x6a06494a791c53a8ULL,
+    0xabfa45da0edbde69ULL, 0x0487db9d17636892ULL,
+    0xd6f8d7509292d603ULL, 0x45a9d2845d3c42b6ULL,
+    0x865b86925b9bc5c2ULL, 0x0b8a2392ba45a9b2ULL,
+    0xa7f26836f282b732ULL, 0x8e6cac7768d7141eULL,
+    0xd1ef0244af2364ffULL, 0x3207d795430cd926ULL,
+    0x8335616aed761f1fULL, 0x7f44e6bd49e807b8ULL,
+    0xa402b9c5a8d3a6e7ULL, 0x5f16206c9c6209a6ULL,
+    0xcd036837130890a1ULL, 0x36dba887c37a8c0fULL,
+    0x802221226be55a64ULL, 0xc2494954da2c9789ULL,
+    0xa02aa96b06deb0fdULL, 0xf2db9baa10b7bd6cULL,
+    0xc83553c5c8965d3dULL, 0x6f92829494e5acc7ULL,
+    0xfa42a8b73abbf48cULL, 0xcb772339ba1f17f9ULL,
+    0x9c69a97284b578d7ULL, 0xff2a760414536efbULL,
+    0xc38413cf25e2d70dULL, 0xfef5138519684abaULL,
+    0xf46518c2ef5b8cd1ULL, 0x7eb258665fc25d69ULL,
+    0x98bf2f79d5993802ULL, 0xef2f773ffbd97a61ULL,
+    0xbeeefb584aff8603ULL, 0xaafb550ffacfd8faULL,
+    0xeeaaba2e5dbf6784ULL, 0x95ba2a53f983cf38ULL,
+    0x952ab45cfa97a0b2ULL, 0xdd945a747bf26183ULL,
+    0xba756174393d88dfULL, 0x94f971119aeef9e4ULL,
+    0xe912b9d1478ceb17ULL, 0x7a37cd5601aab85dULL,
+    0x91abb422ccb812eeULL, 0xac62e055c10ab33aULL,
+    0xb616a12b7fe617aaULL, 0x577b986b314d6009ULL,
+    0xe39c49765fdf9d94ULL, 0xed5a7e85fda0b80bULL,
+    0x8e41ade9fbebc27dULL, 0x14588f13be847307ULL,
+    0xb1d219647ae6b31cULL, 0x596eb2d8ae258fc8ULL,
+    0xde469fbd99a05fe3ULL, 0x6fca5f8ed9aef3bbULL,
+    0x8aec23d680043beeULL, 0x25de7bb9480d5854ULL,
+    0xada72ccc20054ae9ULL, 0xaf561aa79a10ae6aULL,
+    0xd910f7ff28069da4ULL, 0x1b2ba1518094da04ULL,
+    0x87aa9aff79042286ULL, 0x90fb44d2f05d0842ULL,
+    0xa99541bf57452b28ULL, 0x353a1607ac744a53ULL,
+    0xd3fa922f2d1675f2ULL, 0x42889b8997915ce8ULL,
+    0x847c9b5d7c2e09b7ULL, 0x69956135febada11ULL,
+    0xa59bc234db398c25ULL, 0x43fab9837e699095ULL,
+    0xcf02b2c21207ef2eULL, 0x94f967e45e03f4bbULL,
+    0x8161afb94b44f57dULL, 0x1d1be0eebac278f5ULL,
+    0xa1ba1ba79e1632dcULL, 0x6462d92a69731732ULL,
+    0xca28a291859bbf93ULL, 0x7d7b8f7503cfdcfeULL,
+    0xfcb2cb35e702af78ULL, 0x5cda735244c3d43eULL,
+    0x9defbf01b061adabULL, 0x3a0888136afa64a7ULL,
+    0xc56baec21c7a1916ULL, 0x088aaa1845b8fdd0ULL,
+    0xf6c69a72a3989f5bULL, 0x8aad549e57273d45ULL,
+    0x9a3c2087a63f6399ULL, 0x36ac54e2f678864bULL,
+    0xc0cb28a98fcf3c7fULL, 0x84576a1bb416a7ddULL,
+    0xf0fdf2d3f3c30b9fULL, 0x656d44a2a11c51d5ULL,
+    0x969eb7c47859e743ULL, 0x9f644ae5a4b1b325ULL,
+    0xbc4665b596706114ULL, 0x873d5d9f0dde1feeULL,
+    0xeb57ff22fc0c7959ULL, 0xa90cb506d155a7eaULL,
+    0x9316ff75dd87cbd8ULL, 0x09a7f12442d588f2ULL,
+    0xb7dcbf5354e9beceULL, 0x0c11ed6d538aeb2fULL,
+    0xe5d3ef282a242e81ULL, 0x8f1668c8a86da5faULL,
+    0x8fa475791a569d10ULL, 0xf96e017d694487bcULL,
+    0xb38d92d760ec4455ULL, 0x37c981dcc395a9acULL,
+    0xe070f78d3927556aULL, 0x85bbe253f47b1417ULL,
+    0x8c469ab843b89562ULL, 0x93956d7478ccec8eULL,
+    0xaf58416654a6babbULL, 0x387ac8d1970027b2ULL,
+    0xdb2e51bfe9d0696aULL, 0x06997b05fcc0319eULL,
+    0x88fcf317f22241e2ULL, 0x441fece3bdf81f03ULL,
+    0xab3c2fddeeaad25aULL, 0xd527e81cad7626c3ULL,
+    0xd60b3bd56a5586f1ULL, 0x8a71e223d8d3b074ULL,
+    0x85c7056562757456ULL, 0xf6872d5667844e49ULL,
+    0xa738c6bebb12d16cULL, 0xb428f8ac016561dbULL,
+    0xd106f86e69d785c7ULL, 0xe13336d701beba52ULL,
+    0x82a45b450226b39cULL, 0xecc0024661173473ULL,
+    0xa34d721642b06084ULL, 0x27f002d7f95d0190ULL,
+    0xcc20ce9bd35c78a5ULL, 0x31ec038df7b441f4ULL,
+    0xff290242c83396ceULL, 0x7e67047175a15271ULL,
+    0x9f79a169bd203e41ULL, 0x0f0062c6e984d386ULL,
+    0xc75809c42c684dd1ULL, 0x52c07b78a3e60868ULL,
+    0xf92e0c3537826145ULL, 0xa7709a56ccdf8a82ULL,
+    0x9bbcc7a142b17ccbULL, 0x88a66076400bb691ULL,
+    0xc2abf989935ddbfeULL, 0x6acff893d00ea435ULL,
+    0xf356f7ebf83552feULL, 0x0583f6b8c4124d43ULL,
+    0x98165af37b2153deULL, 0xc3727a337a8b704aULL,
+    0xbe1bf1b059e9a8d6ULL, 0x744f18c0592e4c5cULL,
+    0xeda2ee1c7064130cULL, 0x1162def06f79df73ULL,
+    0x9485d4d1c63e8be7ULL, 0x8addcb5645ac2ba8ULL,
+    0xb9a74a0637ce2ee1ULL, 0x6d953e2bd7173692ULL,
+    0xe8111c87c5c1ba99ULL, 0xc8fa8db6ccdd0437ULL,
+    0x910ab1d4db9914a0ULL, 0x1d9c9892400a22a2ULL,
+    0xb54d5e4a127f59c8ULL, 0x2503beb6d00cab4bULL,
+    0xe2a0b5dc971f303aULL, 0x2e44ae64840fd61dULL,
+    0x8da471a9de737e24ULL, 0x5ceaecfed289e5d2ULL,
+    0xb10d8e1456105dadULL, 0x7425a83e872c5f47ULL,
+    0xdd50f1996b947518ULL, 0xd12f124e28f77719ULL,
+    0x8a5296ffe33cc92fULL, 0x82bd6b70d99aaa6fULL,
+    0xace73cbfdc0bfb7bULL, 0x636cc64d1001550bULL,
+    0xd8210befd30efa5aULL, 0x3c47f7e05401aa4eULL,
+    0x8714a775e3e95c78ULL, 0x65acfaec34810a71ULL,
+    0xa8d9d1535ce3b396ULL, 0x7f1839a741a14d0dULL,
+    0xd31045a8341ca07cULL, 0x1ede48111209a050ULL,
+    0x83ea2b892091e44dULL, 0x934aed0aab460432ULL,
+    0xa4e4b66b68b65d60ULL, 0xf81da84d5617853fULL,
+    0xce1de40642e3f4b9ULL, 0x36251260ab9d668eULL,
+    0x80d2ae83e9ce78f3ULL, 0xc1d72b7c6b426019ULL,
+    0xa1075a24e4421730ULL, 0xb24cf65b8612f81fULL,
+    0xc94930ae1d529cfcULL, 0xdee033f26797b627ULL,
+    0xfb9b7cd9a4a7443cULL, 0x169840ef017da3b1ULL,
+    0x9d412e0806e88aa5ULL, 0x8e1f289560ee864eULL,
+    0xc491798a08a2ad4eULL, 0xf1a6f2bab92a27e2ULL,
+    0xf5b5d7ec8acb58a2ULL, 0xae10af696774b1dbULL,
+    0x9991a6f3d6bf1765ULL, 0xacca6da1e0a8ef29ULL,
+    0xbff610b0cc6edd3fULL, 0x17fd090a58d32af3ULL,
+    0xeff394dcff8a948eULL, 0xddfc4b4cef07f5b0ULL,
+    0x95f83d0a1fb69cd9ULL, 0x4abdaf101564f98eULL,
+    0xbb764c4ca7a4440fULL, 0x9d6d1ad41abe37f1ULL,
+    0xea53df5fd18d5513ULL, 0x84c86189216dc5edULL,
+    0x92746b9be2f8552cULL, 0x32fd3cf5b4e49bb4ULL,
+    0xb7118682dbb66a77ULL, 0x3fbc8c33221dc2a1ULL,
+    0xe4d5e82392a40515ULL, 0x0fabaf3feaa5334aULL,
+    0x8f05b1163ba6832dULL, 0x29cb4d87f2a7400eULL,
+    0xb2c71d5bca9023f8ULL, 0x743e20e9ef511012ULL,
+    0xdf78e4b2bd342cf6ULL, 0x914da9246b255416ULL,
+    0x8bab8eefb6409c1aULL, 0x1ad089b6c2f7548eULL,
+    0xae9672aba3d0c320ULL, 0xa184ac2473b529b1ULL,
+    0xda3c0f568cc4f3e8ULL, 0xc9e5d72d90a2741eULL,
+    0x8865899617fb1871ULL, 0x7e2fa67c7a658892ULL,
+    0xaa7eebfb9df9de8dULL, 0xddbb901b98feeab7ULL,
+    0xd51ea6fa85785631ULL, 0x552a74227f3ea565ULL,
+    0x8533285c936b35deULL, 0xd53a88958f87275fULL,
+    0xa67ff273b8460356ULL, 0x8a892abaf368f137ULL,
+    0xd01fef10a657842cULL, 0x2d2b7569b0432d85ULL,
+    0x8213f56a67f6b29bULL, 0x9c3b29620e29fc73ULL,
+    0xa298f2c501f45f42ULL, 0x8349f3ba91b47b8fULL,
+    0xcb3f2f7642717713ULL, 0x241c70a936219a73ULL,
+    0xfe0efb53d30dd4d7ULL, 0xed238cd383aa0110ULL,
+    0x9ec95d1463e8a506ULL, 0xf4363804324a40aaULL,
+    0xc67bb4597ce2ce48ULL, 0xb143c6053edcd0d5ULL,
+    0xf81aa16fdc1b81daULL, 0xdd94b7868e94050aULL,
+    0x9b10a4e5e9913128ULL, 0xca7cf2b4191c8326ULL,
+    0xc1d4ce1f63f57d72ULL, 0xfd1c2f611f63a3f0ULL,
+    0xf24a01a73cf2dccfULL, 0xbc633b39673c8cecULL,
+    0x976e41088617ca01ULL, 0xd5be0503e085d813ULL,
+    0xbd49d14aa79dbc82ULL, 0x4b2d8644d8a74e18ULL,
+    0xec9c459d51852ba2ULL, 0xddf8e7d60ed1219eULL,
+    0x93e1ab8252f33b45ULL, 0xcabb90e5c942b503ULL,
+    0xb8da1662e7b00a17ULL, 0x3d6a751f3b936243ULL,
+    0xe7109bfba19c0c9dULL, 0x0cc512670a783ad4ULL,
+    0x906a617d450187e2ULL, 0x27fb2b80668b24c5ULL,
+    0xb484f9dc9641e9daULL, 0xb1f9f660802dedf6ULL,
+    0xe1a63853bbd26451ULL, 0x5e7873f8a0396973ULL,
+    0x8d07e33455637eb2ULL, 0xdb0b487b6423e1e8ULL,
+    0xb049dc016abc5e5fULL, 0x91ce1a9a3d2cda62ULL,
+    0xdc5c5301c56b75f7ULL, 0x7641a140cc7810fbULL,
+    0x89b9b3e11b6329baULL, 0xa9e904c87fcb0a9dULL,
+    0xac2820d9623bf429ULL, 0x546345fa9fbdcd44ULL,
+    0xd732290fbacaf133ULL, 0xa97c177947ad4095ULL,
+    0x867f59a9d4bed6c0ULL, 0x49ed8eabcccc485dULL,
+    0xa81f301449ee8c70ULL, 0x5c68f256bfff5a74ULL,
+    0xd226fc195c6a2f8cULL, 0x73832eec6fff3111ULL,
+    0x83585d8fd9c25db7ULL, 0xc831fd53c5ff7eabULL,
+    0xa42e74f3d032f525ULL, 0xba3e7ca8b77f5e55ULL,
+    0xcd3a1230c43fb26fULL, 0x28ce1bd2e55f35ebULL,
+    0x80444b5e7aa7cf85ULL, 0x7980d163cf5b81b3ULL,
+    0xa0555e361951c366ULL, 0xd7e105bcc332621fULL,
+    0xc86ab5c39fa63440ULL, 0x8dd9472bf3fefaa7ULL,
+    0xfa856334878fc150ULL, 0xb14f98f6f0feb951ULL,
+    0x9c935e00d4b9d8d2ULL, 0x6ed1bf9a569f33d3ULL,
+    0xc3b8358109e84f07ULL, 0x0a862f80ec4700c8ULL,
+    0xf4a642e14c6262c8ULL, 0xcd27bb612758c0faULL,
+    0x98e7e9cccfbd7dbdULL, 0x8038d51cb897789cULL,
+    0xbf21e44003acdd2cULL, 0xe0470a63e6bd56c3ULL,
+    0xeeea5d5004981478ULL, 0x1858ccfce06cac74ULL,
+    0x95527a5202df0ccbULL, 0x0f37801e0c43ebc8ULL,
+    0xbaa718e68396cffdULL, 0xd30560258f54e6baULL,
+    0xe950df20247c83fdULL, 0x47c6b82ef32a2069ULL,
+    0x91d28b7416cdd27eULL, 0x4cdc331d57fa5441ULL,
+    0xb6472e511c81471dULL, 0xe0133fe4adf8e952ULL,
+    0xe3d8f9e563a198e5ULL, 0x58180fddd97723a6ULL,
+    0x8e679c2f5e44ff8fULL, 0x570f09eaa7ea7648ULL,
+};
+
+// Computes the full 128-bit product of a and b.
+static inline void multiply64(fp_u64_t a, fp_u64_t b, fp_u64_t *hi,
+                              fp_u64_t *lo) {
+#if defined(__SIZEOF_INT128__)
+  __extension__ typedef unsigned __int128 fp_u128_t;
+  fp_u128_t r = static_cast<fp_u128_t>(a) * b;
+  (*hi) = static_cast<fp_u64_t>(r >> 64);
+  (*lo) = static_cast<fp_u64_t>(r);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_AMD64))
+  (*lo) = _umul128(a, b, hi);
+#else
+  fp_u64_t a_lo = a & 0xffffffffULL, a_hi = a >> 32;
+  fp_u64_t b_lo = b & 0xffffffffULL, b_hi = b >> 32;
+  fp_u64_t lo_lo = a_lo * b_lo;
+  fp_u64_t hi_lo = a_hi * b_lo;
+  fp_u64_t lo_hi = a_lo * b_hi;
+  fp_u64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffffULL) + lo_hi;
+  (*hi) = a_hi * b_hi + (hi_lo >> 32) + (cross >> 32);
+  (*lo) = (cross << 32) | (lo_lo & 0xffffffffULL);
+#endif
+}
+
+// x must not be zero.
+static inline int countLeadingZeros64(fp_u64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_clzll(x);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_AMD64))
+  unsigned long i;
+  _BitScanReverse64(&i, x);
+  return 63 - static_cast<int>(i);
+#else
+  int n = 0;
+  while ((x & 0x8000000000000000ULL) == 0) {
+    x <<= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+// Parameters of an IEEE 754 binary format for computeBinary().
+typedef struct {
+  int mantissa_bits;  // Explicit mantissa bits.
+  int exponent_bias;
+  int infinite_power;  // Biased exponent of infinity.
+  // w * 10^q is rounded to zero below and to infinity above this range of q.
+  int smallest_power_of_ten;
+  int largest_power_of_ten;
+  // w * 10^q can only be exactly halfway between two values in this range.
+  int min_round_to_even;
+  int max_round_to_even;
+} binary_format_t;
+
+static const binary_format_t kBinary64 = {
+    52, 1023, 0x7ff, kSmallestPowerOfFive, kLargestPowerOfFive, -4, 23};
+static const binary_format_t kBinary32 = {23, 127, 0xff, -65, 38, -17, 10};
+
+// Converts w * 10^q to the nearest value of `format` with the Eisel-Lemire
+// algorithm. See "Number Parsing at a Gigabyte per Second"(D. Lemire, 2021).
+// Stores the biased exponent and mantissa bits(without the sign) to `bits`.
+// Returns false in the rare cases it cannot round correctly; the caller
+// then has to use an exact conversion.
+static bool computeBinary(int q, fp_u64_t w, const binary_format_t &format,
+                          fp_u64_t *bits) {
+  const int kMantissaBits = format.mantissa_bits;
+  fp_u64_t mantissa = 0;
+  int power2 = 0;
+
+  if ((w == 0) || (q < format.smallest_power_of_ten)) {
+    // zero
+  } else if (q > format.largest_power_of_ten) {
+    power2 = format.infinite_power;
+  } else {
+    int lz = countLeadingZeros64(w);
+    w <<= lz;
+
+    // Only the top mantissa + 3 bits of the product matter. The low word of
+    // 5^q is needed when the truncated high word could carry into them.
+    size_t index = 2 * static_cast<size_t>(q - kSmallestPowerOfFive);
+    fp_u64_t hi, lo;
+    multiply64(w, kPowerOfFive128[index], &hi, &lo);
+    const fp_u64_t kPrecisionMask =
+        0xffffffffffffffffULL >> (kMantissaBits + 3);
+    if ((hi & kPrecisionMask) == kPrecisionMask) {
+      fp_u64_t hi2, lo2;
+      multiply64(w, kPowerOfFive128[index + 1], &hi2, &lo2);
+      lo += hi2;
+      if (hi2 > lo) {
+        hi++;
+      }
+      if ((lo == 0xffffffffffffffffULL) && ((q < -27) || (q > 55))) {
+        return false;
+      }
+    }
+
+    int upperbit = static_cast<int>(hi >> 63);
+    int shift = upperbit + 64 - kMantissaBits - 3;
+    mantissa = hi >> shift;
+    // floor(log2(10^q)) + 63, then rebias.
+    power2 = (((152170 + 65536) * q) >> 16) + 63 + upperbit - lz +
+             format.exponent_bias;
+
+    if (power2 <= 0) {
+      // Subnormal or zero.
+      if (-power2 + 1 >= 64) {
+        mantissa = 0;
+        power2 = 0;
+      } else {
+        mantissa >>= -power2 + 1;
+        mantissa += (mantissa & 1);
+        mantissa >>= 1;
+        power2 = (mantissa < (1ULL << kMantissaBits)) ? 0 : 1;
+        mantissa &= ~(1ULL << kMantissaBits);
+      }
+    } else {
+      // Exactly halfway between two values: round to even.
+      if ((lo <= 1) && (q >= format.min_round_to_even) &&
+          (q <= format.max_round_to_even) && ((mantissa & 3) == 1) &&
+          ((mantissa << shift) == hi)) {
+        mantissa &= ~1ULL;
+      }
+      mantissa += (mantissa & 1);
+      mantissa >>= 1;
+      if (mantissa >= (2ULL << kMantissaBits)) {
+        mantissa = (1ULL << kMantissaBits);
+        power2++;
+      }
+      mantissa &= ~(1ULL << kMantissaBits);
+      if (power2 >= format.infinite_power) {
+        power2 = format.infinite_power;
+        mantissa = 0;
+      }
     }
-    (*token) += strcspn((*token), "/ \t\r");
-    (*ret) = vi;
-    return true;
   }
 
-  // i/j/k or i/j
-  if (!fixIndex(atoi((*token)), vtsize, &(vi.vt_idx))) {
+  (*bits) = mantissa | (static_cast<fp_u64_t>(power2) << kMantissaBits);
+  return true;
+}
+
+static inline bool computeDouble(int q, fp_u64_t w, bool negative,
+                                 double *result) {
+  fp_u64_t bits;
+  if (!computeBinary(q, w, kBinary64, &bits)) {
     return false;
   }
+  if (negative) {
+    bits |= 1ULL << 63;
+  }
+  memcpy(result, &bits, sizeof(double));
+  return true;
+}
 
-  (*token) += strcspn((*token), "/ \t\r");
-  if ((*token)[0] != '/') {
-    (*ret) = vi;
-    return true;
+static inline bool computeFloat(int q, fp_u64_t w, bool negative,
+                                float *result) {
+  fp_u64_t bits;
+  if (!computeBinary(q, w, kBinary32, &bits)) {
+    return false;
+  }
+  if (negative) {
+    bits |= 1ULL << 31;
   }
+  unsigned int bits32 = static_cast<unsigned int>(bits);
+  memcpy(result, &bits32, sizeof(float));
+  return true;
+}
 
-  // i/j/k
-  (*token)++;  // skip '/'
-  if (!fixIndex(atoi((*token)), vnsize, &(vi.vn_idx))) {
+// Exact(but slow) conversion of [s, s_end). Independent of the C locale.
+template <typename T>
+static bool parseExact(const char *s, const char *s_end, T *result) {
+  std::istringstream iss(std::string(s, s_end));
+  iss.imbue(std::locale::classic());
+  T val;
+  iss >> val;
+  if (iss.fail()) {
     return false;
   }
-  (*token) += strcspn((*token), "/ \t\r");
+  (*result) = val;
+  return true;
+}
 
-  (*ret) = vi;
+// A decimal number (-1)^negative * w * 10^q read by tryParseReal().
+typedef struct {
+  fp_u64_t w;
+  int q;
+  bool negative;
+  bool truncated;  // w holds the 19 leading digits of a longer mantissa.
+} decimal_t;
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(_M_AMD64) || \
+    defined(__aarch64__) || defined(_M_ARM64) || defined(__SSE2_MATH__)
+// Both w and 10^|q| are exact, so a single multiplication or division rounds
+// correctly(Clinger's fast path). Not used with x87 math, which rounds
+// intermediates to extended precision.
+#define TINYOBJLOADER_FP_FAST_PATH
+#endif
 
-  return true;
+#if defined(_MSC_VER) && !defined(__clang__)
+#define TINYOBJLOADER_NOINLINE __declspec(noinline)
+#elif defined(__GNUC__) || defined(__clang__)
+#define TINYOBJLOADER_NOINLINE __attribute__((noinline))
+#else
+#define TINYOBJLOADER_NOINLINE
+#endif
+
+// Exact powers of ten for the fast path.
+static const double kPowersOfTen[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// Signs are applied by a multiplication rather than a branch, as they are
+// random in typical data.
+static const double kSigns[] = {1.0, -1.0};
+
+#ifdef TINYOBJLOADER_FP_FAST_PATH
+// Clinger's fast path, for w <= 2^53 and |q| <= 22. w fits in a signed
+// integer, whose conversion needs no fix-up.
+static inline double fastDecimalToDouble(fp_u64_t w, int q, bool negative) {
+  double d = static_cast<double>(static_cast<long long>(w));
+  d = (q < 0) ? (d / kPowersOfTen[-q]) : (d * kPowersOfTen[q]);
+  return d * kSigns[negative ? 1 : 0];
 }
 
-// Parse raw triples: i, i/j/k, i//k, i/j
-static vertex_index_t parseRawTriple(const char **token) {
-  vertex_index_t vi(static_cast<int>(0));  // 0 is an invalid index in OBJ
+static inline bool fastDecimalToReal(fp_u64_t w, int q, bool negative,
+                                     double *result) {
+  (*result) = fastDecimalToDouble(w, q, negative);
+  return true;
+}
 
-  vi.v_idx = atoi((*token));
-  (*token) += strcspn((*token), "/ \t\r");
-  if ((*token)[0] != '/') {
-    return vi;
+// Narrowing the nearest double is off by one ulp when the double rounds onto
+// the midpoint of two floats, so false is returned in that case. Here the
+// double is zero or within the normal float range, where all midpoints of
+// floats are exact doubles.
+static inline bool fastDecimalToReal(fp_u64_t w, int q, bool negative,
+                                     float *result) {
+  const double d = fastDecimalToDouble(w, q, negative);
+  fp_u64_t bits;
+  memcpy(&bits, &d, sizeof(double));
+  const fp_u64_t kLowBits = (1ULL << 29) - 1;
+  if ((bits & kLowBits) == (1ULL << 28)) {
+    return false;
   }
-  (*token)++;
+  (*result) = static_cast<float>(d);
+  return true;
+}
+#endif
 
-  // i//k
-  if ((*token)[0] == '/') {
-    (*token)++;
-    vi.vn_idx = atoi((*token));
-    (*token) += strcspn((*token), "/ \t\r");
-    return vi;
+// Converts the number [s, num_end) scanned into `dec` to the nearest double.
+static inline bool decimalToReal(const decimal_t &dec, const char *s,
+                                 const char *num_end, double *result) {
+#ifdef TINYOBJLOADER_FP_FAST_PATH
+  if (!dec.truncated && (dec.w <= (1ULL << 53)) && (dec.q >= -22) &&
+      (dec.q <= 22)) {
+    return fastDecimalToReal(dec.w, dec.q, dec.negative, result);
   }
+#endif
 
-  // i/j/k or i/j
-  vi.vt_idx = atoi((*token));
-  (*token) += strcspn((*token), "/ \t\r");
-  if ((*token)[0] != '/') {
-    return vi;
+  // A truncated mantissa rounds correctly if both bounds round alike.
+  double d;
+  if (computeDouble(dec.q, dec.w, dec.negative, &d)) {
+    if (!dec.truncated) {
+      (*result) = d;
+      return true;
+    }
+    double d_up;
+    if (computeDouble(dec.q, dec.w + 1, dec.negative, &d_up) && (d == d_up)) {
+      (*result) = d;
+      return true;
+    }
   }
 
-  // i/j/k
-  (*token)++;  // skip '/'
-  vi.vn_idx = atoi((*token));
-  (*token) += strcspn((*token), "/ \t\r");
-  return vi;
+  return parseExact(s, num_end, result);
 }
 
-static bool ParseTextureNameAndOption(std::string *texname,
-                                      texture_option_t *texopt,
-                                      const char *linebuf, const bool is_bump) {
-  // @todo { write more robust lexer and parser. }
-  bool found_texname = false;
-  std::string texture_name;
+// Converts the number [s, num_end) scanned into `dec` to the nearest float.
+// The midpoint case of the fast path is converted directly.
+static inline bool decimalToReal(const decimal_t &dec, const char *s,
+                                 const char *num_end, float *result) {
+#ifdef TINYOBJLOADER_FP_FAST_PATH
+  if (!dec.truncated && (dec.w <= (1ULL << 53)) && (dec.q >= -22) &&
+      (dec.q <= 22) && fastDecimalToReal(dec.w, dec.q, dec.negative, result)) {
+    return true;
+  }
+#endif
+
+  float f;
+  if (computeFloat(dec.q, dec.w, dec.negative, &f)) {
+    if (!dec.truncated) {
+      (*result) = f;
+      return true;
+    }
+    float f_up;
+    if (computeFloat(dec.q, dec.w + 1, dec.negative, &f_up) && (f == f_up)) {
+      (*result) = f;
+      return true;
+    }
+  }
+
+  return parseExact(s, num_end, result);
+}
+
+// tryParseReal() of any number. Long mantissas, exponents and the cases the
+// fast path cannot round go through Eisel-Lemire or parseExact(), out of
+// line so that they do not slow down the common case.
+template <typename T>
+static TINYOBJLOADER_NOINLINE bool tryParseRealSlow(const char *s,
+                                                    const char *s_end,
+                                                    T *result) {
+  if (s >= s_end) {
+    return false;
+  }
+
+  const char *curr = s;
+  bool negative = false;
+
+  // Find out what sign we've got.
+  if (*curr == '+' || *curr == '-') {
+    negative = (*curr == '-');
+    curr++;
+  }
+  if ((curr == s_end) || !IS_DIGIT(*curr)) {
+    return false;
+  }
+
+  // Accumulate all digits into w. `q` is the decimal exponent of the last
+  // digit. w is only valid with at most 19 digits; longer mantissas are
+  // re-read below.
+  fp_u64_t w = 0;
+  int q = 0;
+  const char *digits_begin = curr;
+
+  // Read the integer part.
+  while ((curr != s_end) && IS_DIGIT(*curr)) {
+    w = w * 10 + static_cast<fp_u64_t>(*curr - '0');
+    curr++;
+  }
+  int num_digits = static_cast<int>(curr - digits_begin);
+
+  // Read the decimal part.
+  if ((curr != s_end) && (*curr == '.')) {
+    curr++;
+    const char *frac_begin = curr;
+    while ((curr != s_end) && IS_DIGIT(*curr)) {
+      w = w * 10 + static_cast<fp_u64_t>(*curr - '0');
+      curr++;
+    }
+    q = -static_cast<int>(curr - frac_begin);
+    num_digits -= q;
+  }
+  const char *digits_end = curr;
+
+  // Read the exponent part.
+  if ((curr != s_end) && (*curr == 'e' || *curr == 'E')) {
+    curr++;
+    bool exp_negative = false;
+    if ((curr != s_end) && (*curr == '+' || *curr == '-')) {
+      exp_negative = (*curr == '-');
+      curr++;
+    }
+    if ((curr == s_end) || !IS_DIGIT(*curr)) {
+      // Empty E is not allowed.
+      return false;
+    }
+    int exponent = 0;
+    while ((curr != s_end) && IS_DIGIT(*curr)) {
+      if (exponent < 100000) {
+        exponent = exponent * 10 + (*curr - '0');
+      }
+      curr++;
+    }
+    q += (exp_negative ? -exponent : exponent);
+  }
+
+  // Keep the 19 leading significant digits of a longer mantissa. The value
+  // then lies between w * 10^q and (w + 1) * 10^q.
+  const int kMaxDigits = 19;
+  bool truncated = false;
+  if (num_digits > kMaxDigits) {
+    const char *p = digits_begin;
+    while ((p != digits_end) && ((*p == '0') || (*p == '.'))) {
+      if (*p == '0') {
+        num_digits--;
+      }
+      p++;
+    }
+    if (num_digits > kMaxDigits) {
+      truncated = true;
+      q += num_digits - kMaxDigits;
+      w = 0;
+      for (int n = 0; n < kMaxDigits; p++) {
+        if (*p != '.') {
+          w = w * 10 + static_cast<fp_u64_t>(*p - '0');
+          n++;
+        }
+      }
+    }
+  }
+
+  decimal_t dec = {w, q, negative, truncated};
+  return decimalToReal(dec, s, curr, result);
+}
+
+// Tries to parse a floating point number located at s.
+//
+// s_end should be a location in the string where reading should absolutely
+// stop. For example at the end of the string, to prevent buffer overflows.
+//
+// Parses the following EBNF grammar:
+//   sign    = "+" | "-" ;
+//   END     = ? anything not in digit ?
+//   digit   = "0" | "1" | "2" | "3" | "4" | "5" | "6" | "7" | "8" | "9" ;
+//   integer = [sign] , digit , {digit} ;
+//   decimal = integer , ["." , integer] ;
+//   float   = ( decimal , END ) | ( decimal , ("E" | "e") , integer , END ) ;
+//
+//  Valid strings are for example:
+//   -0  +3.1417e+2  -0.0E-3  1.0324  -1.41   11e2
+//
+// If the parsing is a success, result is set to the nearest float or
+// double(T) and true is returned.
+//
+// The function is greedy and will parse until any of the following happens:
+//  - a non-conforming character is encountered.
+//  - s_end is reached.
+//
+// The following situations triggers a failure:
+//  - s >= s_end.
+//  - parse failure.
+//
+template <typename T>
+static inline bool tryParseReal(const char *s, const char *s_end, T *result) {
+  if (s >= s_end) {
+    return false;
+  }
+#ifdef TINYOBJLOADER_FP_FAST_PATH
+  // Short decimals without an exponent, such as most coordinates, are
+  // converted right here: up to 15 digits are exact in a double, so one
+  // division by a power of ten rounds correctly.
+  // Signs are random in typical data, so they are read without branches.
+  const char *curr = s;
+  const bool negative = (*curr == '-');
+  curr += (negative || (*curr == '+')) ? 1 : 0;
+  const char *digits_begin = curr;
+  fp_u64_t w = 0;
+  while ((curr != s_end) && IS_DIGIT(*curr)) {
+    w = w * 10 + static_cast<fp_u64_t>(*curr - '0');
+    curr++;
+  }
+  const char *int_end = curr;
+  int frac_digits = 0;
+  if ((curr != s_end) && (*curr == '.')) {
+    curr++;
+    const char *frac_begin = curr;
+    while ((curr != s_end) && IS_DIGIT(*curr)) {
+      w = w * 10 + static_cast<fp_u64_t>(*curr - '0');
+      curr++;
+    }
+    frac_digits = static_cast<int>(curr - frac_begin);
+  }
+  if ((int_end != digits_begin) &&
+      ((int_end - digits_begin) + frac_digits <= 15) &&
+      ((curr == s_end) || ((*curr != 'e') && (*curr != 'E'))) &&
+      fastDecimalToReal(w, -frac_digits, negative, result)) {
+    return true;
+  }
+#endif
+  return tryParseRealSlow(s, s_end, result);
+}
+
+static inline real_t parseReal(const char **token, double default_value = 0.0) {
+  (*token) = skipSpace(*token);
+  const char *end = findTokenEnd(*token);
+  real_t f = static_cast<real_t>(default_value);
+  tryParseReal((*token), end, &f);
+  (*token) = end;
+  return f;
+}
+
+static inline bool parseReal(const char **token, real_t *out) {
+  (*token) = skipSpace(*token);
+  const char *end = findTokenEnd(*token);
+  bool ret = tryParseReal((*token), end, out);
+  (*token) = end;
+  return ret;
+}
+
+static inline void parseReal2(real_t *x, real_t *y, const char **token,
+                              const double default_x = 0.0,
+                              const double default_y = 0.0) {
+  (*x) = parseReal(token, default_x);
+  (*y) = parseReal(token, default_y);
+}
+
+static inline void parseReal3(real_t *x, real_t *y, real_t *z,
+                              const char **token, const double default_x = 0.0,
+                              const double default_y = 0.0,
+                              const double default_z = 0.0) {
+  (*x) = parseReal(token, default_x);
+  (*y) = parseReal(token, default_y);
+  (*z) = parseReal(token, default_z);
+}
+
+static inline void parseV(real_t *x, real_t *y, real_t *z, real_t *w,
+                          const char **token, const double default_x = 0.0,
+                          const double default_y = 0.0,
+                          const double default_z = 0.0,
+                          const double default_w = 1.0) {
+  (*x) = parseReal(token, default_x);
+  (*y) = parseReal(token, default_y);
+  (*z) = parseReal(token, default_z);
+  (*w) = parseReal(token, default_w);
+}
+
+// Extension: parse vertex with colors(6 items)
+// Returns false(and white) when the line has no color.
+static inline bool parseVertexWithColor(real_t *x, real_t *y, real_t *z,
+                                        real_t *r, real_t *g, real_t *b,
+                                        const char **token,
+                                        const double default_x = 0.0,
+                                        const double default_y = 0.0,
+                                        const double default_z = 0.0) {
+  (*x) = parseReal(token, default_x);
+  (*y) = parseReal(token, default_y);
+  (*z) = parseReal(token, default_z);
+
+  if (parseReal(token, r) && parseReal(token, g) && parseReal(token, b)) {
+    return true;
+  }
+
+  (*r) = (*g) = (*b) = static_cast<real_t>(1.0);
+  return false;
+}
+
+static inline bool parseOnOff(const char **token, bool default_value = true) {
+  (*token) = skipSpace(*token);
+  const char *end = findTokenEnd(*token);
+
+  bool ret = default_value;
+  if ((0 == strncmp((*token), "on", 2))) {
+    ret = true;
+  } else if ((0 == strncmp((*token), "off", 3))) {
+    ret = false;
+  }
+
+  (*token) = end;
+  return ret;
+}
+
+static inline texture_type_t parseTextureType(
+    const char **token, texture_type_t default_value = TEXTURE_TYPE_NONE) {
+  (*token) = skipSpace(*token);
+  const char *end = findTokenEnd(*token);
+  texture_type_t ty = default_value;
+
+  if ((0 == strncmp((*token), "cube_top", strlen("cube_top")))) {
+    ty = TEXTURE_TYPE_CUBE_TOP;
+  } else if ((0 == strncmp((*token), "cube_bottom", strlen("cube_bottom")))) {
+    ty = TEXTURE_TYPE_CUBE_BOTTOM;
+  } else if ((0 == strncmp((*token), "cube_left", strlen("cube_left")))) {
+    ty = TEXTURE_TYPE_CUBE_LEFT;
+  } else if ((0 == strncmp((*token), "cube_right", strlen("cube_right")))) {
+    ty = TEXTURE_TYPE_CUBE_RIGHT;
+  } else if ((0 == strncmp((*token), "cube_front", strlen("cube_front")))) {
+    ty = TEXTURE_TYPE_CUBE_FRONT;
+  } else if ((0 == strncmp((*token), "cube_back", strlen("cube_back")))) {
+    ty = TEXTURE_TYPE_CUBE_BACK;
+  } else if ((0 == strncmp((*token), "sphere", strlen("sphere")))) {
+    ty = TEXTURE_TYPE_SPHERE;
+  }
+
+  (*token) = end;
+  return ty;
+}
+
+static tag_sizes parseTagTriple(const char **token) {
+  tag_sizes ts;
+
+  (*token) = skipSpace(*token);
+  ts.num_ints = atoi((*token));
+  (*token) = findIndexEnd(*token);
+  if ((*token)[0] != '/') {
+    return ts;
+  }
+
+  (*token)++;  // Skip '/'
+
+  (*token) = skipSpace(*token);
+  ts.num_reals = atoi((*token));
+  (*token) = findIndexEnd(*token);
+  if ((*token)[0] != '/') {
+    return ts;
+  }
+  (*token)++;  // Skip '/'
+
+  ts.num_strings = parseInt(token);
+
+  return ts;
+}
+
+// Parses a face index the way atoi() does and returns the end of the index
+// token(the next '/', blank or end of line) in the same pass.
+static inline const char *parseIndex(const char *p, int *idx) {
+  const char *s = p;
+  while (IS_SPACE(*s)) {
+    s++;
+  }
+
+  bool negative = false;
+  if ((*s == '-') || (*s == '+')) {
+    negative = (*s == '-');
+    s++;
+  }
+  unsigned int n = 0;
+  while (IS_DIGIT(*s)) {
+    n = n * 10 + static_cast<unsigned int>(*s - '0');
+    s++;
+  }
+  (*idx) = negative ? -static_cast<int>(n) : static_cast<int>(n);
+
+  if (IS_SPACE(*p)) {
+    return p;  // A leading blank ends the token.
+  }
+  if (!IS_SPACE(*s) && !IS_NEW_LINE(*s) && (*s != '/')) {
+    s = findIndexEnd(s);
+  }
+  return s;
+}
+
+// Parses a face index and makes it zero-base. Negative(relative) indices are
+// rebased against n.
+static inline bool parseFixedIndex(const char **token, int n, int *ret) {
+  int idx;
+  (*token) = parseIndex(*token, &idx);
+  if (idx > 0) {
+    (*ret) = idx - 1;
+    return true;
+  }
+  if (idx < 0) {
+    (*ret) = n + idx;  // negative value = relative
+    return true;
+  }
+  return false;  // zero is not allowed according to the spec.
+}
+
+// Parse triples with index offsets: i, i/j/k, i//k, i/j
+static bool parseTriple(const char **token, int vsize, int vnsize, int vtsize,
+                        vertex_index_t *ret) {
+  if (!ret) {
+    return false;
+  }
+
+  vertex_index_t vi(-1);
+  const char *p = (*token);
+
+  if (!parseFixedIndex(&p, vsize, &(vi.v_idx))) {
+    return false;
+  }
+
+  if (p[0] == '/') {
+    p++;
+    if (p[0] == '/') {
+      // i//k
+      p++;
+      if (!parseFixedIndex(&p, vnsize, &(vi.vn_idx))) {
+        return false;
+      }
+    } else {
+      // i/j/k or i/j
+      if (!parseFixedIndex(&p, vtsize, &(vi.vt_idx))) {
+        return false;
+      }
+      if (p[0] == '/') {
+        p++;  // skip '/'
+        if (!parseFixedIndex(&p, vnsize, &(vi.vn_idx))) {
+          return false;
+        }
+      }
+    }
+  }
+
+  (*token) = p;
+  (*ret) = vi;
+
+  return true;
+}
+
+// Parse raw triples: i, i/j/k, i//k, i/j
+static vertex_index_t parseRawTriple(const char **token) {
+  vertex_index_t vi(static_cast<int>(0));  // 0 is an invalid index in OBJ
+
+  const char *p = parseIndex(*token, &(vi.v_idx));
+  if (p[0] == '/') {
+    p++;
+    if (p[0] == '/') {
+      // i//k
+      p = parseIndex(p + 1, &(vi.vn_idx));
+    } else {
+      // i/j/k or i/j
+      p = parseIndex(p, &(vi.vt_idx));
+      if (p[0] == '/') {
+        p = parseIndex(p + 1, &(vi.vn_idx));  // skip '/'
+      }
+    }
+  }
+
+  (*token) = p;
+  return vi;
+}
+
+// Fills `texopt` with the default values.
+static void initTextureOption(texture_option_t *texopt, bool is_bump) {
+  if (is_bump) {
+    texopt->imfchan = 'l';
+  } else {
+    texopt->imfchan = 'm';
+  }
+  texopt->bump_multiplier = static_cast<real_t>(1.0);
+  texopt->clamp = false;
+  texopt->blendu = true;
+  texopt->blendv = true;
+  texopt->sharpness = static_cast<real_t>(1.0);
+  texopt->brightness = static_cast<real_t>(0.0);
+  texopt->contrast = static_cast<real_t>(1.0);
+  texopt->origin_offset[0] = static_cast<real_t>(0.0);
+  texopt->origin_offset[1] = static_cast<real_t>(0.0);
+  texopt->origin_offset[2] = static_cast<real_t>(0.0);
+  texopt->scale[0] = static_cast<real_t>(1.0);
+  texopt->scale[1] = static_cast<real_t>(1.0);
+  texopt->scale[2] = static_cast<real_t>(1.0);
+  texopt->turbulence[0] = static_cast<real_t>(0.0);
+  texopt->turbulence[1] = static_cast<real_t>(0.0);
+  texopt->turbulence[2] = static_cast<real_t>(0.0);
+  texopt->type = TEXTURE_TYPE_NONE;
+}
+
+static bool ParseTextureNameAndOption(std::string *texname,
+                                      texture_option_t *texopt,
+                                      const char *linebuf, const bool is_bump) {
+  // @todo { write more robust lexer and parser. }
+  bool found_texname = false;
+  std::string texture_name;
+
+  initTextureOption(texopt, is_bump);
+
+  const char *token = linebuf;  // Assume line ends with NULL
+
+  while (!IS_NEW_LINE((*token))) {
+    token = skipSpace(token);  // skip space
+    if ((0 == strncmp(token, "-blendu", 7)) && IS_SPACE((token[7]))) {
+      token += 8;
+      texopt->blendu = parseOnOff(&token, /* default */ true);
+    } else if ((0 == strncmp(token, "-blendv", 7)) && IS_SPACE((token[7]))) {
+      token += 8;
+      texopt->blendv = parseOnOff(&token, /* default */ true);
+    } else if ((0 == strncmp(token, "-clamp", 6)) && IS_SPACE((token[6]))) {
+      token += 7;
+      texopt->clamp = parseOnOff(&token, /* default */ true);
+    } else if ((0 == strncmp(token, "-boost", 6)) && IS_SPACE((token[6]))) {
+      token += 7;
+      texopt->sharpness = parseReal(&token, 1.0);
+    } else if ((0 == strncmp(token, "-bm", 3)) && IS_SPACE((token[3]))) {
+      token += 4;
+      texopt->bump_multiplier = parseReal(&token, 1.0);
+    } else if ((0 == strncmp(token, "-o", 2)) && IS_SPACE((token[2]))) {
+      token += 3;
+      parseReal3(&(texopt->origin_offset[0]), &(texopt->origin_offset[1]),
+                 &(texopt->origin_offset[2]), &token);
+    } else if ((0 == strncmp(token, "-s", 2)) && IS_SPACE((token[2]))) {
+      token += 3;
+      parseReal3(&(texopt->scale[0]), &(texopt->scale[1]), &(texopt->scale[2]),
+                 &token, 1.0, 1.0, 1.0);
+    } else if ((0 == strncmp(token, "-t", 2)) && IS_SPACE((token[2]))) {
+      token += 3;
+      parseReal3(&(texopt->turbulence[0]), &(texopt->turbulence[1]),
+                 &(texopt->turbulence[2]), &token);
+    } else if ((0 == strncmp(token, "-type", 5)) && IS_SPACE((token[5]))) {
+      token += 5;
+      texopt->type = parseTextureType((&token), TEXTURE_TYPE_NONE);
+    } else if ((0 == strncmp(token, "-imfchan", 8)) && IS_SPACE((token[8]))) {
+      token += 9;
+      token = skipSpace(token);
+      const char *end = findTokenEnd(token);
+      if ((end - token) == 1) {  // Assume one char for -imfchan
+        texopt->imfchan = (*token);
+      }
+      token = end;
+    } else if ((0 == strncmp(token, "-mm", 3)) && IS_SPACE((token[3]))) {
+      token += 4;
+      parseReal2(&(texopt->brightness), &(texopt->contrast), &token, 0.0, 1.0);
+    } else {
+    // Assume texture filename
+#if 0
+      size_t len = strcspn(token, " \t\r");  // untile next space
+      texture_name = std::string(token, token + len);
+      token += len;
+
+      token += strspn(token, " \t");  // skip space
+#else
+      // Read filename until line end to parse filename containing whitespace
+      // TODO(syoyo): Support parsing texture option flag after the filename.
+      texture_name = std::string(token);
+      token += texture_name.length();
+#endif
+
+      found_texname = true;
+    }
+  }
+
+  if (found_texname) {
+    (*texname) = texture_name;
+    return true;
+  } else {
+    return false;
+  }
+}
+
+static void InitMaterial(material_t *material) {
+  material->name = "";
+  material->ambient_texname = "";
+  material->diffuse_texname = "";
+  material->specular_texname = "";
+  material->specular_highlight_texname = "";
+  material->bump_texname = "";
+  material->displacement_texname = "";
+  material->reflection_texname = "";
+  material->alpha_texname = "";
+  for (int i = 0; i < 3; i++) {
+    material->ambient[i] = static_cast<real_t>(0.0);
+    material->diffuse[i] = static_cast<real_t>(0.0);
+    material->specular[i] = static_cast<real_t>(0.0);
+    material->transmittance[i] = static_cast<real_t>(0.0);
+    material->emission[i] = static_cast<real_t>(0.0);
+  }
+  material->illum = 0;
+  material->dissolve = static_cast<real_t>(1.0);
+  material->shininess = static_cast<real_t>(1.0);
+  material->ior = static_cast<real_t>(1.0);
+
+  material->roughness = static_cast<real_t>(0.0);
+  material->metallic = static_cast<real_t>(0.0);
+  material->sheen = static_cast<real_t>(0.0);
+  material->clearcoat_thickness = static_cast<real_t>(0.0);
+  material->clearcoat_roughness = static_cast<real_t>(0.0);
+  material->anisotropy_rotation = static_cast<real_t>(0.0);
+  material->anisotropy = static_cast<real_t>(0.0);
+  material->roughness_texname = "";
+  material->metallic_texname = "";
+  material->sheen_texname = "";
+  material->emissive_texname = "";
+  material->normal_texname = "";
+
+  material->unknown_parameter.clear();
+}
+
+// How a face is triangulated.
+enum face_class_t {
+  FACE_TRIANGLE,
+  FACE_CONVEX,  // Fanned from its first corner. Also degenerate(zero area)
+                // faces, which ear clipping would fan as well.
+  FACE_CONCAVE  // Ear clipped, as are self-intersecting faces.
+};
+
+// Normal of a polygon by Newell's method.
+static void polygonNormal(const vertex_index_t *vertex_indices, size_t n,
+                          const std::vector<real_t> &v, real_t normal[3]) {
+  normal[0] = normal[1] = normal[2] = static_cast<real_t>(0);
+  for (size_t k = 0, j = n - 1; k < n; j = k++) {
+    const real_t *p = &v[size_t(vertex_indices[j].v_idx) * 3];
+    const real_t *q = &v[size_t(vertex_indices[k].v_idx) * 3];
+    normal[0] += (p[1] - q[1]) * (p[2] + q[2]);
+    normal[1] += (p[2] - q[2]) * (p[0] + q[0]);
+    normal[2] += (p[0] - q[0]) * (p[1] + q[1]);
+  }
+}
+
+// Selects the plane a polygon is projected to, the one where its normal is
+// largest. The normal component along the dropped axis is twice the signed
+// area of the projection(`orientation`).
+static void selectPolygonPlane(const real_t normal[3], size_t axes[2],
+                               real_t *orientation) {
+  const real_t nx = std::fabs(normal[0]);
+  const real_t ny = std::fabs(normal[1]);
+  const real_t nz = std::fabs(normal[2]);
+  axes[0] = 1;
+  axes[1] = 2;
+  *orientation = normal[0];
+  if ((nx <= ny) || (nx <= nz)) {
+    axes[0] = 0;
+    if ((nz > nx) && (nz > ny)) {
+      axes[1] = 1;
+      *orientation = normal[2];
+    } else {
+      *orientation = -normal[1];
+    }
+  }
+}
+
+// Counts how often the sign of `d` changes around the polygon, skipping
+// zeros.
+static void countFlip(real_t d, int *first, int *last, int *flips) {
+  const int sign = (d > 0) ? 1 : ((d < 0) ? -1 : 0);
+  if (sign == 0) {
+    return;
+  }
+  if ((*last != 0) && (sign != *last)) {
+    (*flips)++;
+  }
+  if (*first == 0) {
+    *first = sign;
+  }
+  *last = sign;
+}
+
+// A polygon is convex when no corner is reflex and its edges go around once
+// (which rules out self-intersecting polygons such as a pentagram).
+static face_class_t classifyFace(const vertex_index_t *vertex_indices,
+                                 size_t n, const std::vector<real_t> &v) {
+  if (n == 3) {
+    return FACE_TRIANGLE;
+  }
+
+  real_t normal[3];
+  size_t axes[2];
+  real_t orientation;
+  polygonNormal(vertex_indices, n, v, normal);
+  selectPolygonPlane(normal, axes, &orientation);
+
+  int first_x = 0, last_x = 0, flips_x = 0;
+  int first_y = 0, last_y = 0, flips_y = 0;
+  const real_t *a = &v[size_t(vertex_indices[n - 1].v_idx) * 3];
+  const real_t *b = &v[size_t(vertex_indices[0].v_idx) * 3];
+  for (size_t k = 0; k < n; k++) {
+    const size_t next = (k + 1 == n) ? 0 : k + 1;
+    const real_t *c = &v[size_t(vertex_indices[next].v_idx) * 3];
+    const real_t e0x = b[axes[0]] - a[axes[0]];
+    const real_t e0y = b[axes[1]] - a[axes[1]];
+    const real_t e1x = c[axes[0]] - b[axes[0]];
+    const real_t e1y = c[axes[1]] - b[axes[1]];
+    if ((e0x * e1y - e0y * e1x) * orientation < 0) {
+      return FACE_CONCAVE;
+    }
+    countFlip(e1x, &first_x, &last_x, &flips_x);
+    countFlip(e1y, &first_y, &last_y, &flips_y);
+    a = b;
+    b = c;
+  }
+  flips_x += ((first_x != 0) && (first_x != last_x)) ? 1 : 0;
+  flips_y += ((first_y != 0) && (first_y != last_y)) ? 1 : 0;
+  const bool degenerate = !((orientation < 0) || (orientation > 0));
+  if ((flips_x > 2 || flips_y > 2) && !degenerate) {
+    return FACE_CONCAVE;
+  }
+  return FACE_CONVEX;
+}
+
+#if defined(TINYOBJLOADER_USE_SSE2) && !defined(TINYOBJLOADER_USE_DOUBLE)
+static inline __m128 selectPs(__m128 mask, __m128 a, __m128 b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128i selectEpi32(__m128i mask, __m128i a, __m128i b) {
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// countFlip() of 4 lanes.
+static inline void countFlips4(__m128 d, __m128i *first, __m128i *last,
+                               __m128i *flips) {
+  const __m128 zero = _mm_setzero_ps();
+  const __m128i zeroi = _mm_setzero_si128();
+  const __m128i sign =
+      _mm_sub_epi32(_mm_castps_si128(_mm_cmplt_ps(d, zero)),
+                    _mm_castps_si128(_mm_cmpgt_ps(d, zero)));
+  const __m128i nonzero =
+      _mm_xor_si128(_mm_cmpeq_epi32(sign, zeroi), _mm_set1_epi32(-1));
+  const __m128i changed = _mm_andnot_si128(
+      _mm_or_si128(_mm_cmpeq_epi32(*last, zeroi), _mm_cmpeq_epi32(sign, *last)),
+      nonzero);
+  *flips = _mm_sub_epi32(*flips, changed);
+  *first = selectEpi32(_mm_cmpeq_epi32(*first, zeroi), sign, *first);
+  *last = selectEpi32(nonzero, sign, *last);
+}
+
+// classifyFace() of 4 faces of `n`(> 3) vertices at once, one face per lane.
+// The lanes do the operations of classifyFace() in the same order, so the
+// classes are the same(unless the compiler contracts the scalar ones to
+// FMA). `batch` holds the corners as rows of 4 x, 4 y and 4 z.
+static void classifyFaces4(const vertex_index_t *const vertex_indices[4],
+                           size_t n, const std::vector<real_t> &v,
+                           std::vector<float> *batch,
+                           unsigned char classes[4]) {
+  batch->resize(n * 12);
+  float *pos = &(*batch)[0];
+  for (size_t k = 0; k < n; k++) {
+    for (size_t lane = 0; lane < 4; lane++) {
+      const real_t *p = &v[size_t(vertex_indices[lane][k].v_idx) * 3];
+      pos[k * 12 + lane] = p[0];
+      pos[k * 12 + 4 + lane] = p[1];
+      pos[k * 12 + 8 + lane] = p[2];
+    }
+  }
+
+  __m128 nx = _mm_setzero_ps();
+  __m128 ny = _mm_setzero_ps();
+  __m128 nz = _mm_setzero_ps();
+  __m128 px = _mm_loadu_ps(pos + (n - 1) * 12);
+  __m128 py = _mm_loadu_ps(pos + (n - 1) * 12 + 4);
+  __m128 pz = _mm_loadu_ps(pos + (n - 1) * 12 + 8);
+  for (size_t k = 0; k < n; k++) {
+    const __m128 qx = _mm_loadu_ps(pos + k * 12);
+    const __m128 qy = _mm_loadu_ps(pos + k * 12 + 4);
+    const __m128 qz = _mm_loadu_ps(pos + k * 12 + 8);
+    nx = _mm_add_ps(nx, _mm_mul_ps(_mm_sub_ps(py, qy), _mm_add_ps(pz, qz)));
+    ny = _mm_add_ps(ny, _mm_mul_ps(_mm_sub_ps(pz, qz), _mm_add_ps(px, qx)));
+    nz = _mm_add_ps(nz, _mm_mul_ps(_mm_sub_ps(px, qx), _mm_add_ps(py, qy)));
+    px = qx;
+    py = qy;
+    pz = qz;
+  }
+
+  // selectPolygonPlane(): lanes not projected along x use axes(0, 1) when
+  // projected along z, and(0, 2) otherwise.
+  const __m128 sign_bit = _mm_set1_ps(-0.0f);
+  const __m128 ax = _mm_andnot_ps(sign_bit, nx);
+  const __m128 ay = _mm_andnot_ps(sign_bit, ny);
+  const __m128 az = _mm_andnot_ps(sign_bit, nz);
+  const __m128 not_x = _mm_or_ps(_mm_cmple_ps(ax, ay), _mm_cmple_ps(ax, az));
+  const __m128 along_z =
+      _mm_and_ps(_mm_cmpgt_ps(az, ax), _mm_cmpgt_ps(az, ay));
+  const __m128 orientation =
+      selectPs(not_x, selectPs(along_z, nz, _mm_xor_ps(ny, sign_bit)), nx);
+
+  // Projected corners n - 1(a) and 0(b).
+  const float *corner = pos + (n - 1) * 12;
+  __m128 ax2 = selectPs(not_x, _mm_loadu_ps(corner), _mm_loadu_ps(corner + 4));
+  __m128 ay2 = selectPs(
+      not_x,
+      selectPs(along_z, _mm_loadu_ps(corner + 4), _mm_loadu_ps(corner + 8)),
+      _mm_loadu_ps(corner + 8));
+  __m128 bx2 = selectPs(not_x, _mm_loadu_ps(pos), _mm_loadu_ps(pos + 4));
+  __m128 by2 = selectPs(
+      not_x, selectPs(along_z, _mm_loadu_ps(pos + 4), _mm_loadu_ps(pos + 8)),
+      _mm_loadu_ps(pos + 8));
+
+  const __m128 zero = _mm_setzero_ps();
+  __m128 reflex = _mm_setzero_ps();
+  __m128i first_x = _mm_setzero_si128(), last_x = first_x, flips_x = first_x;
+  __m128i first_y = first_x, last_y = first_x, flips_y = first_x;
+  for (size_t k = 0; k < n; k++) {
+    corner = pos + ((k + 1 == n) ? 0 : k + 1) * 12;
+    const __m128 cx2 =
+        selectPs(not_x, _mm_loadu_ps(corner), _mm_loadu_ps(corner + 4));
+    const __m128 cy2 = selectPs(
+        not_x,
+        selectPs(along_z, _mm_loadu_ps(corner + 4), _mm_loadu_ps(corner + 8)),
+        _mm_loadu_ps(corner + 8));
+    const __m128 e0x = _mm_sub_ps(bx2, ax2);
+    const __m128 e0y = _mm_sub_ps(by2, ay2);
+    const __m128 e1x = _mm_sub_ps(cx2, bx2);
+    const __m128 e1y = _mm_sub_ps(cy2, by2);
+    const __m128 turn = _mm_mul_ps(
+        _mm_sub_ps(_mm_mul_ps(e0x, e1y), _mm_mul_ps(e0y, e1x)), orientation);
+    reflex = _mm_or_ps(reflex, _mm_cmplt_ps(turn, zero));
+    countFlips4(e1x, &first_x, &last_x, &flips_x);
+    countFlips4(e1y, &first_y, &last_y, &flips_y);
+    ax2 = bx2;
+    ay2 = by2;
+    bx2 = cx2;
+    by2 = cy2;
+  }
+
+  const __m128i zeroi = _mm_setzero_si128();
+  const __m128i ones = _mm_set1_epi32(-1);
+  flips_x = _mm_sub_epi32(
+      flips_x, _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi32(first_x, zeroi),
+                                             _mm_cmpeq_epi32(first_x, last_x)),
+                                ones));
+  flips_y = _mm_sub_epi32(
+      flips_y, _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi32(first_y, zeroi),
+                                             _mm_cmpeq_epi32(first_y, last_y)),
+                                ones));
+  const __m128i two = _mm_set1_epi32(2);
+  const __m128 tangled = _mm_castsi128_ps(_mm_or_si128(
+      _mm_cmpgt_epi32(flips_x, two), _mm_cmpgt_epi32(flips_y, two)));
+  const __m128 non_degenerate = _mm_or_ps(_mm_cmplt_ps(orientation, zero),
+                                          _mm_cmpgt_ps(orientation, zero));
+  const int concave = _mm_movemask_ps(
+      _mm_or_ps(reflex, _mm_and_ps(tangled, non_degenerate)));
+  for (int lane = 0; lane < 4; lane++) {
+    classes[lane] = static_cast<unsigned char>(
+        ((concave >> lane) & 1) ? FACE_CONCAVE : FACE_CONVEX);
+  }
+}
+#endif
+
+// Classifies faces [face_begin, face_end) into `classes`(one per face, 3+
+// vertices). Runs of 4 faces with the same number of vertices are classified
+// together with SSE2.
+static void classifyFaces(const face_vector_t &faces,
+                          const vertex_index_vector_t &face_indices,
+                          size_t face_begin, size_t face_end,
+                          const std::vector<real_t> &v,
+                          std::vector<unsigned char> *classes,
+                          std::vector<float> *batch) {
+  classes->resize(face_end - face_begin);
+  size_t i = face_begin;
+  while (i < face_end) {
+    const size_t n = faces[i].num_vertices;
+    unsigned char *face_class = &(*classes)[i - face_begin];
+    if (n <= 3) {
+      *face_class = FACE_TRIANGLE;
+      i++;
+      continue;
+    }
+#if defined(TINYOBJLOADER_USE_SSE2) && !defined(TINYOBJLOADER_USE_DOUBLE)
+    if ((i + 4 <= face_end) && (faces[i + 1].num_vertices == n) &&
+        (faces[i + 2].num_vertices == n) && (faces[i + 3].num_vertices == n)) {
+      const vertex_index_t *const vertex_indices[4] = {
+          &face_indices[faces[i].vertex_offset],
+          &face_indices[faces[i + 1].vertex_offset],
+          &face_indices[faces[i + 2].vertex_offset],
+          &face_indices[faces[i + 3].vertex_offset]};
+      classifyFaces4(vertex_indices, n, v, batch, face_class);
+      i += 4;
+      continue;
+    }
+#else
+    (void)batch;
+#endif
+    *face_class = static_cast<unsigned char>(
+        classifyFace(&face_indices[faces[i].vertex_offset], n, v));
+    i++;
+  }
+}
+
+// Triangulates the polygons of exportFaceGroupToShape().
+// Triangles are returned as corners(0 .. n - 1) of the polygon, in the
+// winding of the polygon. Convex polygons are fanned from the first corner.
+// Concave ones are ear clipped; only reflex corners can lie inside an ear,
+// so they are looked up in a grid instead of testing every corner.
+class PolygonTriangulator {
+ public:
+  // Appends n - 2 triangles of the polygon `vertex_indices[0, n)` to
+  // `corners`.
+  void triangulate(const vertex_index_t *vertex_indices, size_t n,
+                   const std::vector<real_t> &v,
+                   std::vector<unsigned int> *corners) {
+    if (classifyFace(vertex_indices, n, v) != FACE_CONCAVE) {
+      for (unsigned int k = 2; k < n; k++) {
+        corners->push_back(0);
+        corners->push_back(k - 1);
+        corners->push_back(k);
+      }
+      return;
+    }
+    triangulateConcave(vertex_indices, n, v, corners);
+  }
+
+  // triangulate() of a polygon classified as FACE_CONCAVE.
+  void triangulateConcave(const vertex_index_t *vertex_indices, size_t n,
+                          const std::vector<real_t> &v,
+                          std::vector<unsigned int> *corners) {
+    project(vertex_indices, n, v);
+    if ((n == 4) && splitQuad(corners)) {
+      return;
+    }
+    clipEars(corners);
+  }
+
+ private:
+  // > 0 when the turn at `b` goes the way of the polygon.
+  real_t turn(unsigned int a, unsigned int b, unsigned int c) const {
+    const real_t e0x = m_x[b] - m_x[a];
+    const real_t e0y = m_y[b] - m_y[a];
+    const real_t e1x = m_x[c] - m_x[b];
+    const real_t e1y = m_y[c] - m_y[b];
+    return (e0x * e1y - e0y * e1x) * m_orientation;
+  }
+
+  // Projects the polygon to the plane of selectPolygonPlane().
+  void project(const vertex_index_t *vertex_indices, size_t n,
+               const std::vector<real_t> &v) {
+    real_t normal[3];
+    size_t axes[2];
+    polygonNormal(vertex_indices, n, v, normal);
+    selectPolygonPlane(normal, axes, &m_orientation);
+
+    m_x.resize(n);
+    m_y.resize(n);
+    for (size_t k = 0; k < n; k++) {
+      const size_t vi = size_t(vertex_indices[k].v_idx);
+      m_x[k] = v[vi * 3 + axes[0]];
+      m_y[k] = v[vi * 3 + axes[1]];
+    }
+  }
+
+  size_t cellX(real_t x) const {
+    const real_t cell = (x - m_gridMinX) * m_gridScaleX;
+    if (!(cell > 0)) return 0;
+    return std::min(static_cast<size_t>(cell), m_gridSize - 1);
+  }
+
+  size_t cellY(real_t y) const {
+    const real_t cell = (y - m_gridMinY) * m_gridScaleY;
+    if (!(cell > 0)) return 0;
+    return std::min(static_cast<size_t>(cell), m_gridSize - 1);
+  }
+
+  // Buckets the reflex corners into a grid of about one corner per cell.
+  void buildGrid() {
+    size_t num_reflex = 0;
+    m_gridMinX = m_gridMinY = std::numeric_limits<real_t>::max();
+    real_t max_x = -std::numeric_limits<real_t>::max();
+    real_t max_y = -std::numeric_limits<real_t>::max();
+    for (size_t k = 0; k < m_reflex.size(); k++) {
+      if (m_reflex[k]) {
+        num_reflex++;
+        m_gridMinX = std::min(m_gridMinX, m_x[k]);
+        m_gridMinY = std::min(m_gridMinY, m_y[k]);
+        max_x = std::max(max_x, m_x[k]);
+        max_y = std::max(max_y, m_y[k]);
+      }
+    }
+
+    m_gridSize = 1;
+    while (m_gridSize * m_gridSize < num_reflex) {
+      m_gridSize *= 2;
+    }
+    m_gridScaleX = (max_x > m_gridMinX)
+                       ? static_cast<real_t>(m_gridSize) / (max_x - m_gridMinX)
+                       : static_cast<real_t>(0);
+    m_gridScaleY = (max_y > m_gridMinY)
+                       ? static_cast<real_t>(m_gridSize) / (max_y - m_gridMinY)
+                       : static_cast<real_t>(0);
+
+    m_cellStart.assign(m_gridSize * m_gridSize + 1, 0);
+    for (size_t k = 0; k < m_reflex.size(); k++) {
+      if (m_reflex[k]) {
+        m_cellStart[cellY(m_y[k]) * m_gridSize + cellX(m_x[k]) + 1]++;
+      }
+    }
+    for (size_t c = 0; c + 1 < m_cellStart.size(); c++) {
+      m_cellStart[c + 1] += m_cellStart[c];
+    }
+    m_cellItems.resize(num_reflex);
+    m_cellFill.assign(m_cellStart.begin(), m_cellStart.end() - 1);
+    for (size_t k = 0; k < m_reflex.size(); k++) {
+      if (m_reflex[k]) {
+        const size_t c = cellY(m_y[k]) * m_gridSize + cellX(m_x[k]);
+        m_cellItems[m_cellFill[c]++] = static_cast<unsigned int>(k);
+      }
+    }
+  }
+
+  // True when a reflex corner other than `a`, `b` and `c` lies inside or on
+  // the triangle.
+  bool containsReflex(unsigned int a, unsigned int b, unsigned int c) const {
+    const real_t min_x = std::min(m_x[a], std::min(m_x[b], m_x[c]));
+    const real_t min_y = std::min(m_y[a], std::min(m_y[b], m_y[c]));
+    const real_t max_x = std::max(m_x[a], std::max(m_x[b], m_x[c]));
+    const real_t max_y = std::max(m_y[a], std::max(m_y[b], m_y[c]));
+    const size_t x0 = cellX(min_x), x1 = cellX(max_x);
+    const size_t y0 = cellY(min_y), y1 = cellY(max_y);
+    for (size_t cy = y0; cy <= y1; cy++) {
+      for (size_t cx = x0; cx <= x1; cx++) {
+        const size_t cell = cy * m_gridSize + cx;
+        for (size_t i = m_cellStart[cell]; i < m_cellStart[cell + 1]; i++) {
+          const unsigned int p = m_cellItems[i];
+          if (!m_reflex[p] || (p == a) || (p == b) || (p == c)) {
+            continue;
+          }
+          if ((m_x[p] < min_x) || (m_x[p] > max_x) || (m_y[p] < min_y) ||
+              (m_y[p] > max_y)) {
+            continue;
+          }
+          if ((turn(a, b, p) >= 0) && (turn(b, c, p) >= 0) &&
+              (turn(c, a, p) >= 0)) {
+            return true;
+          }
+        }
+      }
+    }
+    return false;
+  }
+
+  // Ear test of `relax`: 0 requires a convex ear free of reflex corners, 1
+  // only a convex ear and 2 accepts any ear, so that self-intersecting or
+  // degenerate polygons are still finished.
+  bool isEar(unsigned int a, unsigned int b, unsigned int c,
+             int relax) const {
+    if (relax >= 2) {
+      return true;
+    }
+    if (turn(a, b, c) < 0) {
+      return false;
+    }
+    return (relax >= 1) || !containsReflex(a, b, c);
+  }
+
+  // A quad with one reflex corner can only be split by the diagonal from
+  // that corner. Gives the triangles of clipEars() without its grid; returns
+  // false for other quads(self-intersecting, or with a straight corner).
+  bool splitQuad(std::vector<unsigned int> *corners) const {
+    int num_reflex = 0;
+    unsigned int reflex = 0;
+    for (unsigned int k = 0; k < 4; k++) {
+      const real_t t = turn((k + 3) % 4, k, (k + 1) % 4);
+      if (t < 0) {
+        num_reflex++;
+        reflex = k;
+      } else if (!(t > 0)) {
+        return false;
+      }
+    }
+    if (num_reflex != 1) {
+      return false;
+    }
+    // clipEars() clips(0, 1, 2) first unless the diagonal is(1, 3).
+    const unsigned int quad[2][6] = {{0, 1, 2, 0, 2, 3}, {1, 2, 3, 0, 1, 3}};
+    corners->insert(corners->end(), quad[reflex % 2],
+                    quad[reflex % 2] + 6);
+    return true;
+  }
+
+  void clipEars(std::vector<unsigned int> *corners) {
+    const unsigned int n = static_cast<unsigned int>(m_x.size());
+    m_prev.resize(n);
+    m_next.resize(n);
+    m_reflex.resize(n);
+    for (unsigned int k = 0; k < n; k++) {
+      m_prev[k] = (k == 0) ? n - 1 : k - 1;
+      m_next[k] = (k + 1 == n) ? 0 : k + 1;
+    }
+    for (unsigned int k = 0; k < n; k++) {
+      m_reflex[k] = (turn(m_prev[k], k, m_next[k]) < 0) ? 1 : 0;
+    }
+    buildGrid();
+
+    // Like a fan, the first ear tried is(0, 1, 2) and after an ear is clipped
+    // its first corner is kept for the next one.
+    unsigned int b = 1;
+    unsigned int remaining = n;
+    unsigned int misses = 0;
+    int relax = 0;
+    while (remaining > 3) {
+      const unsigned int a = m_prev[b];
+      const unsigned int c = m_next[b];
+      if (!isEar(a, b, c, relax)) {
+        b = c;
+        if (++misses >= remaining) {
+          // A whole round without an ear.
+          relax++;
+          misses = 0;
+        }
+        continue;
+      }
+
+      corners->push_back(a);
+      corners->push_back(b);
+      corners->push_back(c);
+      m_next[a] = c;
+      m_prev[c] = a;
+      m_reflex[b] = 0;
+      remaining--;
+
+      // Clipping an ear can only make its neighbors convex.
+      if (m_reflex[a] && (turn(m_prev[a], a, c) >= 0)) {
+        m_reflex[a] = 0;
+      }
+      if (m_reflex[c] && (turn(a, c, m_next[c]) >= 0)) {
+        m_reflex[c] = 0;
+      }
+      b = c;
+      misses = 0;
+      relax = 0;
+    }
+
+    // The last triangle starts at its lowest corner.
+    unsigned int a = m_prev[b];
+    if ((b < a) && (b < m_next[b])) {
+      a = b;
+    } else if ((m_next[b] < a) && (m_next[b] < b)) {
+      a = m_next[b];
+    }
+    corners->push_back(a);
+    corners->push_back(m_next[a]);
+    corners->push_back(m_next[m_next[a]]);
+  }
+
+  real_t m_orientation;  // Twice the signed area of the projection.
+  std::vector<real_t> m_x;
+  std::vector<real_t> m_y;
+  std::vector<unsigned int> m_prev;
+  std::vector<unsigned int> m_next;
+  std::vector<unsigned char> m_reflex;
+
+  // Grid of the reflex corners; cell `c` holds
+  // `m_cellItems[m_cellStart[c], m_cellStart[c + 1])`.
+  size_t m_gridSize;
+  real_t m_gridMinX;
+  real_t m_gridMinY;
+  real_t m_gridScaleX;
+  real_t m_gridScaleY;
+  std::vector<size_t> m_cellStart;
+  std::vector<size_t> m_cellFill;
+  std::vector<unsigned int> m_cellItems;
+};
+
+// Index arrays of a mesh filled by exportFaceGroupToShape().
+typedef struct {
+  bool split;      // `vertex_indices`, ... instead of `indices`.
+  bool normals;    // `normal_indices`
+  bool texcoords;  // `texcoord_indices`
+} index_streams_t;
+
+// Finds whether faces [face_begin, face_end) refer to normals and texcoords.
+static void findIndexStreams(const face_vector_t &faces,
+                             const vertex_index_vector_t &face_indices,
+                             size_t face_begin, size_t face_end,
+                             index_streams_t *streams) {
+  streams->normals = false;
+  streams->texcoords = false;
+  for (size_t i = face_begin; i < face_end; i++) {
+    const face_t &face = faces[i];
+    if (face.num_vertices < 3) {
+      continue;
+    }
+    const vertex_index_t *vertex_indices = &face_indices[face.vertex_offset];
+    for (size_t k = 0; k < face.num_vertices; k++) {
+      streams->normals |= (vertex_indices[k].vn_idx >= 0);
+      streams->texcoords |= (vertex_indices[k].vt_idx >= 0);
+    }
+    if (streams->normals && streams->texcoords) {
+      return;
+    }
+  }
+}
+
+static inline void pushIndex(mesh_t *mesh, const vertex_index_t &vi,
+                             const index_streams_t &streams) {
+  if (!streams.split) {
+    index_t idx;
+    idx.vertex_index = vi.v_idx;
+    idx.normal_index = vi.vn_idx;
+    idx.texcoord_index = vi.vt_idx;
+    mesh->indices.push_back(idx);
+    return;
+  }
+  mesh->vertex_indices.push_back(vi.v_idx);
+  if (streams.normals) {
+    mesh->normal_indices.push_back(vi.vn_idx);
+  }
+  if (streams.texcoords) {
+    mesh->texcoord_indices.push_back(vi.vt_idx);
+  }
+}
+
+static inline void setIndex(mesh_t *mesh, size_t pos, const vertex_index_t &vi,
+                            const index_streams_t &streams) {
+  if (!streams.split) {
+    index_t &idx = mesh->indices[pos];
+    idx.vertex_index = vi.v_idx;
+    idx.normal_index = vi.vn_idx;
+    idx.texcoord_index = vi.vt_idx;
+    return;
+  }
+  mesh->vertex_indices[pos] = vi.v_idx;
+  if (streams.normals) {
+    mesh->normal_indices[pos] = vi.vn_idx;
+  }
+  if (streams.texcoords) {
+    mesh->texcoord_indices[pos] = vi.vt_idx;
+  }
+}
+
+// Faces [face_begin, face_end) of a face group, whose triangles go to the
+// slots of shape `shape` from triangle `first_triangle` on.
+typedef struct {
+  size_t shape;
+  size_t face_begin;
+  size_t face_end;
+  size_t first_triangle;
+  size_t num_triangles;
+  int material_id;
+  index_streams_t streams;
+} triangulation_job_t;
+
+// Large face groups are split into jobs of about this many triangles.
+static const size_t kTriangulationJobSize = 16 * 1024;
+
+// Per-thread buffers of triangulateFaces().
+struct triangulation_scratch_t {
+  PolygonTriangulator triangulator;
+  std::vector<unsigned int> corners;
+  std::vector<unsigned char> classes;
+  std::vector<float> batch;
+};
+
+static inline void setTriangle(mesh_t *mesh, size_t t, const face_t &face,
+                               const vertex_index_t &a,
+                               const vertex_index_t &b,
+                               const vertex_index_t &c,
+                               const triangulation_job_t &job) {
+  setIndex(mesh, t * 3 + 0, a, job.streams);
+  setIndex(mesh, t * 3 + 1, b, job.streams);
+  setIndex(mesh, t * 3 + 2, c, job.streams);
+
+  mesh->num_face_vertices[t] = 3;
+  mesh->material_ids[t] = job.material_id;
+  mesh->smoothing_group_ids[t] = face.smoothing_group_id;
+}
+
+// Writes the triangles of `job` to the slots reserved for them in `mesh`.
+// The faces are classified first, so that only concave ones go through the
+// triangulator; triangles and convex faces are fanned right here.
+static void triangulateFaces(const triangulation_job_t &job,
+                             const face_vector_t &faces,
+                             const vertex_index_vector_t &face_indices,
+                             const std::vector<real_t> &v, mesh_t *mesh,
+                             triangulation_scratch_t *scratch) {
+  classifyFaces(faces, face_indices, job.face_begin, job.face_end, v,
+                &scratch->classes, &scratch->batch);
+
+  size_t t = job.first_triangle;
+  for (size_t i = job.face_begin; i < job.face_end; i++) {
+    const face_t &face = faces[i];
+    if (face.num_vertices < 3) {
+      continue;
+    }
+
+    const vertex_index_t *vertex_indices = &face_indices[face.vertex_offset];
+    if (scratch->classes[i - job.face_begin] != FACE_CONCAVE) {
+      for (size_t k = 2; k < face.num_vertices; k++, t++) {
+        setTriangle(mesh, t, face, vertex_indices[0], vertex_indices[k - 1],
+                    vertex_indices[k], job);
+      }
+      continue;
+    }
+
+    std::vector<unsigned int> &corners = scratch->corners;
+    corners.clear();
+    scratch->triangulator.triangulateConcave(vertex_indices, face.num_vertices,
+                                             v, &corners);
+    for (size_t k = 0; k < corners.size(); k += 3, t++) {
+      setTriangle(mesh, t, face, vertex_indices[corners[k + 0]],
+                  vertex_indices[corners[k + 1]],
+                  vertex_indices[corners[k + 2]], job);
+    }
+  }
+}
+
+// TODO(syoyo): refactor function.
+// Exports faces [face_begin, face_end) of `faces` to `shape`.
+// With triangulation, the triangles get slots in `shape` and are written by
+// triangulateFaces(): right away when `jobs` is NULL, otherwise later for
+// each of the jobs appended to `jobs`. `shape_index` is the index `shape`
+// will have in the list of shapes.
+// `face_indices` holds the vertex indices of all faces.
+static bool exportFaceGroupToShape(
+    shape_t *shape, const face_vector_t &faces,
+    const vertex_index_vector_t &face_indices, size_t face_begin,
+    size_t face_end, const std::vector<tag_t> &tags, const int material_id,
+    const std::string &name, bool triangulate, bool split_indices,
+    const std::vector<real_t> &v, size_t shape_index,
+    std::vector<triangulation_job_t> *jobs) {
+  if (face_begin >= face_end) {
+    return false;
+  }
+
+  mesh_t &mesh = shape->mesh;
+  index_streams_t streams;
+  streams.split = split_indices;
+  if (split_indices) {
+    // A stream used by an earlier face group of the shape, or by this one,
+    // gets an index for every face vertex of the shape.
+    findIndexStreams(faces, face_indices, face_begin, face_end, &streams);
+    streams.normals |= !mesh.normal_indices.empty();
+    streams.texcoords |= !mesh.texcoord_indices.empty();
+    if (streams.normals) {
+      mesh.normal_indices.resize(mesh.vertex_indices.size(), -1);
+    }
+    if (streams.texcoords) {
+      mesh.texcoord_indices.resize(mesh.vertex_indices.size(), -1);
+    }
+  }
+
+  if (triangulate) {
+    // A face of n vertices always gives n - 2 triangles.
+    std::vector<triangulation_job_t> local_jobs;
+    std::vector<triangulation_job_t> *out = jobs ? jobs : &local_jobs;
+    const size_t first_job = out->size();
+    triangulation_job_t job;
+    job.shape = shape_index;
+    job.face_begin = face_begin;
+    job.first_triangle = mesh.num_face_vertices.size();
+    job.num_triangles = 0;
+    job.material_id = material_id;
+    job.streams = streams;
+    for (size_t i = face_begin; i < face_end; i++) {
+      if (faces[i].num_vertices < 3) {
+        continue;
+      }
+      job.num_triangles += faces[i].num_vertices - 2;
+      if (job.num_triangles >= kTriangulationJobSize) {
+        job.face_end = i + 1;
+        out->push_back(job);
+        job.face_begin = i + 1;
+        job.first_triangle += job.num_triangles;
+        job.num_triangles = 0;
+      }
+    }
+    if (job.num_triangles > 0) {
+      job.face_end = face_end;
+      out->push_back(job);
+    }
+
+    const size_t num_triangles = job.first_triangle + job.num_triangles;
+    const size_t num_indices = num_triangles * 3;
+    if (split_indices) {
+      mesh.vertex_indices.resize(num_indices);
+      if (streams.normals) {
+        mesh.normal_indices.resize(num_indices);
+      }
+      if (streams.texcoords) {
+        mesh.texcoord_indices.resize(num_indices);
+      }
+    } else {
+      mesh.indices.resize(num_indices);
+    }
+    mesh.num_face_vertices.resize(num_triangles);
+    mesh.material_ids.resize(num_triangles);
+    mesh.smoothing_group_ids.resize(num_triangles);
+
+    if (!jobs) {
+      triangulation_scratch_t scratch;
+      for (size_t k = first_job; k < out->size(); k++) {
+        triangulateFaces((*out)[k], faces, face_indices, v, &mesh, &scratch);
+      }
+    }
+  } else {
+    PolygonTriangulator triangulator;
+    std::vector<unsigned int> corners;
+    for (size_t i = face_begin; i < face_end; i++) {
+      const face_t &face = faces[i];
+
+      if (face.num_vertices < 3) {
+        // Face must have 3+ vertices.
+        continue;
+      }
+
+      const vertex_index_t *vertex_indices = &face_indices[face.vertex_offset];
+      if (face.num_vertices > 255) {
+        // Too large for `num_face_vertices`.
+        corners.clear();
+        triangulator.triangulate(vertex_indices, face.num_vertices, v,
+                                 &corners);
+        for (size_t k = 0; k < corners.size(); k += 3) {
+          pushIndex(&mesh, vertex_indices[corners[k + 0]], streams);
+          pushIndex(&mesh, vertex_indices[corners[k + 1]], streams);
+          pushIndex(&mesh, vertex_indices[corners[k + 2]], streams);
+
+          mesh.num_face_vertices.push_back(3);
+          mesh.material_ids.push_back(material_id);
+          mesh.smoothing_group_ids.push_back(face.smoothing_group_id);
+        }
+        continue;
+      }
+
+      for (size_t k = 0; k < face.num_vertices; k++) {
+        pushIndex(&mesh, vertex_indices[k], streams);
+      }
+
+      mesh.num_face_vertices.push_back(
+          static_cast<unsigned char>(face.num_vertices));
+      mesh.material_ids.push_back(material_id);  // per face
+      mesh.smoothing_group_ids.push_back(face.smoothing_group_id);  // per face
+    }
+  }
+
+  shape->name = name;
+  // Tags are only ever appended, so the shape already has the first ones
+  // from its earlier face groups.
+  if (mesh.tags.size() <= tags.size()) {
+    mesh.tags.insert(mesh.tags.end(),
+                     tags.begin() + static_cast<ptrdiff_t>(mesh.tags.size()),
+                     tags.end());
+  } else {
+    mesh.tags = tags;
+  }
+
+  return true;
+}
+
+// Reserves `shape->mesh` for exporting faces [face_begin, face_end). Exact
+// without triangulation; an upper bound(n - 2 triangles per face) with it.
+static void reserveMesh(shape_t *shape, const face_vector_t &faces,
+                        const vertex_index_vector_t &face_indices,
+                        size_t face_begin, size_t face_end, bool triangulate,
+                        bool split_indices) {
+  size_t num_faces = 0;
+  size_t num_indices = 0;
+  for (size_t i = face_begin; i < face_end; i++) {
+    size_t npolys = faces[i].num_vertices;
+    if (npolys < 3) {
+      continue;
+    }
+    if (triangulate) {
+      num_faces += npolys - 2;
+      num_indices += (npolys - 2) * 3;
+    } else {
+      num_faces++;
+      num_indices += npolys;
+    }
+  }
 
-  // Fill with default value for texopt.
-  if (is_bump) {
-    texopt->imfchan = 'l';
+  mesh_t &mesh = shape->mesh;
+  if (split_indices) {
+    index_streams_t streams;
+    findIndexStreams(faces, face_indices, face_begin, face_end, &streams);
+    mesh.vertex_indices.reserve(mesh.vertex_indices.size() + num_indices);
+    if (streams.normals) {
+      mesh.normal_indices.reserve(mesh.normal_indices.size() + num_indices);
+    }
+    if (streams.texcoords) {
+      mesh.texcoord_indices.reserve(mesh.texcoord_indices.size() +
+                                    num_indices);
+    }
   } else {
-    texopt->imfchan = 'm';
+    mesh.indices.reserve(mesh.indices.size() + num_indices);
   }
-  texopt->bump_multiplier = static_cast<real_t>(1.0);
-  texopt->clamp = false;
-  texopt->blendu = true;
-  texopt->blendv = true;
-  texopt->sharpness = static_cast<real_t>(1.0);
-  texopt->brightness = static_cast<real_t>(0.0);
-  texopt->contrast = static_cast<real_t>(1.0);
-  texopt->origin_offset[0] = static_cast<real_t>(0.0);
-  texopt->origin_offset[1] = static_cast<real_t>(0.0);
-  texopt->origin_offset[2] = static_cast<real_t>(0.0);
-  texopt->scale[0] = static_cast<real_t>(1.0);
-  texopt->scale[1] = static_cast<real_t>(1.0);
-  texopt->scale[2] = static_cast<real_t>(1.0);
-  texopt->turbulence[0] = static_cast<real_t>(0.0);
-  texopt->turbulence[1] = static_cast<real_t>(0.0);
-  texopt->turbulence[2] = static_cast<real_t>(0.0);
-  texopt->type = TEXTURE_TYPE_NONE;
+  mesh.num_face_vertices.reserve(mesh.num_face_vertices.size() + num_faces);
+  mesh.material_ids.reserve(mesh.material_ids.size() + num_faces);
+  mesh.smoothing_group_ids.reserve(mesh.smoothing_group_ids.size() +
+                                   num_faces);
+}
+
+static bool fitsIndex16(const std::vector<int> &indices) {
+  for (size_t i = 0; i < indices.size(); i++) {
+    if (indices[i] >= 0xffff) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// 16-bit index of `idx`, where 0xffff means not used(-1).
+static unsigned short narrowIndex(int idx) {
+  return static_cast<unsigned short>((idx < 0) ? 0xffff : idx);
+}
+
+static int narrowIndex(unsigned short idx) {
+  return (idx == 0xffff) ? -1 : static_cast<int>(idx);
+}
+
+static void narrowIndices(std::vector<int> *src,
+                          std::vector<unsigned short> *dst) {
+  dst->resize(src->size());
+  for (size_t i = 0; i < src->size(); i++) {
+    (*dst)[i] = narrowIndex((*src)[i]);
+  }
+  std::vector<int>().swap(*src);
+}
+
+// Applies `load_option_t::narrow_indices` to the split index arrays of
+// `mesh`.
+static void narrowMesh(mesh_t *mesh) {
+  bool triangles = true;
+  for (size_t i = 0; i < mesh->num_face_vertices.size(); i++) {
+    if (mesh->num_face_vertices[i] != 3) {
+      triangles = false;
+      break;
+    }
+  }
+  if (triangles) {
+    std::vector<unsigned char>().swap(mesh->num_face_vertices);
+  }
+
+  if (fitsIndex16(mesh->vertex_indices) &&
+      fitsIndex16(mesh->normal_indices) &&
+      fitsIndex16(mesh->texcoord_indices)) {
+    narrowIndices(&mesh->vertex_indices, &mesh->vertex_indices16);
+    narrowIndices(&mesh->normal_indices, &mesh->normal_indices16);
+    narrowIndices(&mesh->texcoord_indices, &mesh->texcoord_indices16);
+  }
+}
+
+bool TriangulateShape(const attrib_t &attrib, shape_t *shape) {
+  mesh_t &mesh = shape->mesh;
+  size_t num_indices = 0;
+  size_t num_triangles = 0;
+  bool triangles = true;
+  for (size_t i = 0; i < mesh.num_face_vertices.size(); i++) {
+    num_indices += mesh.num_face_vertices[i];
+    num_triangles += (mesh.num_face_vertices[i] >= 3)
+                         ? size_t(mesh.num_face_vertices[i]) - 2
+                         : 0;
+    triangles &= (mesh.num_face_vertices[i] == 3);
+  }
+  if (triangles) {
+    return true;
+  }
+
+  const bool narrow = !mesh.vertex_indices16.empty();
+  const bool split = narrow || !mesh.vertex_indices.empty();
+  const size_t size = !split ? mesh.indices.size()
+                             : (narrow ? mesh.vertex_indices16.size()
+                                       : mesh.vertex_indices.size());
+  if ((size != num_indices) ||
+      (mesh.material_ids.size() != mesh.num_face_vertices.size()) ||
+      (mesh.smoothing_group_ids.size() != mesh.num_face_vertices.size())) {
+    return false;
+  }
+
+  // Gather the face vertices of whichever layout the mesh has.
+  std::vector<vertex_index_t> face_vertices(num_indices);
+  const size_t num_vertices = attrib.vertices.size() / 3;
+  for (size_t k = 0; k < num_indices; k++) {
+    vertex_index_t &vi = face_vertices[k];
+    if (!split) {
+      vi.v_idx = mesh.indices[k].vertex_index;
+      vi.vn_idx = mesh.indices[k].normal_index;
+      vi.vt_idx = mesh.indices[k].texcoord_index;
+    } else if (narrow) {
+      vi.v_idx = narrowIndex(mesh.vertex_indices16[k]);
+      if (!mesh.normal_indices16.empty()) {
+        vi.vn_idx = narrowIndex(mesh.normal_indices16[k]);
+      }
+      if (!mesh.texcoord_indices16.empty()) {
+        vi.vt_idx = narrowIndex(mesh.texcoord_indices16[k]);
+      }
+    } else {
+      vi.v_idx = mesh.vertex_indices[k];
+      if (!mesh.normal_indices.empty()) {
+        vi.vn_idx = mesh.normal_indices[k];
+      }
+      if (!mesh.texcoord_indices.empty()) {
+        vi.vt_idx = mesh.texcoord_indices[k];
+      }
+    }
+    if ((vi.v_idx < 0) || (static_cast<size_t>(vi.v_idx) >= num_vertices)) {
+      return false;
+    }
+  }
+
+  mesh_t triangulated;
+  index_streams_t streams;
+  streams.split = split;
+  streams.normals = !mesh.normal_indices.empty() ||
+                    !mesh.normal_indices16.empty();
+  streams.texcoords = !mesh.texcoord_indices.empty() ||
+                      !mesh.texcoord_indices16.empty();
+  if (split) {
+    triangulated.vertex_indices.reserve(num_triangles * 3);
+    triangulated.normal_indices.reserve(streams.normals ? num_triangles * 3
+                                                        : 0);
+    triangulated.texcoord_indices.reserve(
+        streams.texcoords ? num_triangles * 3 : 0);
+  } else {
+    triangulated.indices.reserve(num_triangles * 3);
+  }
+  triangulated.num_face_vertices.reserve(num_triangles);
+  triangulated.material_ids.reserve(num_triangles);
+  triangulated.smoothing_group_ids.reserve(num_triangles);
+
+  PolygonTriangulator triangulator;
+  std::vector<unsigned int> corners;
+  size_t offset = 0;
+  for (size_t i = 0; i < mesh.num_face_vertices.size(); i++) {
+    const size_t npolys = mesh.num_face_vertices[i];
+    const vertex_index_t *vertex_indices = &face_vertices[offset];
+    offset += npolys;
+    if (npolys < 3) {
+      continue;
+    }
+
+    corners.clear();
+    triangulator.triangulate(vertex_indices, npolys, attrib.vertices,
+                             &corners);
+    for (size_t k = 0; k < corners.size(); k += 3) {
+      pushIndex(&triangulated, vertex_indices[corners[k + 0]], streams);
+      pushIndex(&triangulated, vertex_indices[corners[k + 1]], streams);
+      pushIndex(&triangulated, vertex_indices[corners[k + 2]], streams);
+
+      triangulated.num_face_vertices.push_back(3);
+      triangulated.material_ids.push_back(mesh.material_ids[i]);
+      triangulated.smoothing_group_ids.push_back(mesh.smoothing_group_ids[i]);
+    }
+  }
+
+  if (narrow) {
+    // As with `narrow_indices`: 16-bit indices and no `num_face_vertices`.
+    std::vector<unsigned short> *const dst[3] = {
+        &mesh.vertex_indices16, &mesh.normal_indices16,
+        &mesh.texcoord_indices16};
+    const std::vector<int> *const src[3] = {&triangulated.vertex_indices,
+                                            &triangulated.normal_indices,
+                                            &triangulated.texcoord_indices};
+    for (int a = 0; a < 3; a++) {
+      dst[a]->resize(src[a]->size());
+      for (size_t k = 0; k < src[a]->size(); k++) {
+        (*dst[a])[k] = narrowIndex((*src[a])[k]);
+      }
+    }
+    std::vector<unsigned char>().swap(mesh.num_face_vertices);
+  } else {
+    mesh.indices.swap(triangulated.indices);
+    mesh.vertex_indices.swap(triangulated.vertex_indices);
+    mesh.normal_indices.swap(triangulated.normal_indices);
+    mesh.texcoord_indices.swap(triangulated.texcoord_indices);
+    mesh.num_face_vertices.swap(triangulated.num_face_vertices);
+  }
+  mesh.material_ids.swap(triangulated.material_ids);
+  mesh.smoothing_group_ids.swap(triangulated.smoothing_group_ids);
+  return true;
+}
+
+// Split a string with specified delimiter character.
+// http://stackoverflow.com/questions/236129/split-a-string-in-c
+static void SplitString(const std::string &s, char delim,
+                        std::vector<std::string> &elems) {
+  std::stringstream ss;
+  ss.str(s);
+  std::string item;
+  while (std::getline(ss, item, delim)) {
+    elems.push_back(item);
+  }
+}
+
+// Keywords of .mtl lines.
+enum mtl_keyword_t {
+  MTL_UNKNOWN,
+  MTL_NEWMTL,
+  MTL_KA,
+  MTL_KD,
+  MTL_KS,
+  MTL_KT,  // `Kt` or `Tf`
+  MTL_NI,
+  MTL_KE,
+  MTL_NS,
+  MTL_ILLUM,
+  MTL_D,
+  MTL_TR,
+  MTL_PR,
+  MTL_PM,
+  MTL_PS,
+  MTL_PC,
+  MTL_PCR,
+  MTL_ANISO,
+  MTL_ANISOR,
+  MTL_MAP_KA,
+  MTL_MAP_KD,
+  MTL_MAP_KS,
+  MTL_MAP_NS,
+  MTL_MAP_BUMP,
+  MTL_MAP_BUMP_UPPER,  // `map_Bump`
+  MTL_BUMP,
+  MTL_MAP_D,
+  MTL_DISP,
+  MTL_REFL,
+  MTL_MAP_PR,
+  MTL_MAP_PM,
+  MTL_MAP_PS,
+  MTL_MAP_KE,
+  MTL_NORM
+};
+
+// Two characters as one switch label.
+#define MTL_KEY2(a, b)                                                \
+  ((static_cast<unsigned int>(static_cast<unsigned char>(a)) << 8) | \
+   static_cast<unsigned int>(static_cast<unsigned char>(b)))
+
+static mtl_keyword_t mtlKeywordIf(const char *token, const char *keyword,
+                                  size_t len, mtl_keyword_t ret) {
+  return (memcmp(token, keyword, len) == 0) ? ret : MTL_UNKNOWN;
+}
+
+// Classifies the keyword at `token` by its length and first characters
+// instead of comparing it with each keyword in turn. Only a keyword
+// followed by a space or a tab counts.
+static mtl_keyword_t findMtlKeyword(const char *token) {
+  size_t len = 0;
+  while ((token[len] != '\0') && !IS_SPACE(token[len])) {
+    len++;
+  }
+  if ((len == 0) || !IS_SPACE(token[len])) {
+    return MTL_UNKNOWN;
+  }
+
+  const unsigned int key = MTL_KEY2(token[0], token[1]);
+  switch (len) {
+    case 1:
+      return (token[0] == 'd') ? MTL_D : MTL_UNKNOWN;
+    case 2:
+      switch (key) {
+        case MTL_KEY2('K', 'a'):
+          return MTL_KA;
+        case MTL_KEY2('K', 'd'):
+          return MTL_KD;
+        case MTL_KEY2('K', 's'):
+          return MTL_KS;
+        case MTL_KEY2('K', 't'):
+        case MTL_KEY2('T', 'f'):
+          return MTL_KT;
+        case MTL_KEY2('N', 'i'):
+          return MTL_NI;
+        case MTL_KEY2('K', 'e'):
+          return MTL_KE;
+        case MTL_KEY2('N', 's'):
+          return MTL_NS;
+        case MTL_KEY2('T', 'r'):
+          return MTL_TR;
+        case MTL_KEY2('P', 'r'):
+          return MTL_PR;
+        case MTL_KEY2('P', 'm'):
+          return MTL_PM;
+        case MTL_KEY2('P', 's'):
+          return MTL_PS;
+        case MTL_KEY2('P', 'c'):
+          return MTL_PC;
+        default:
+          return MTL_UNKNOWN;
+      }
+    case 3:
+      return mtlKeywordIf(token, "Pcr", 3, MTL_PCR);
+    case 4:
+      switch (key) {
+        case MTL_KEY2('b', 'u'):
+          return mtlKeywordIf(token, "bump", 4, MTL_BUMP);
+        case MTL_KEY2('d', 'i'):
+          return mtlKeywordIf(token, "disp", 4, MTL_DISP);
+        case MTL_KEY2('r', 'e'):
+          return mtlKeywordIf(token, "refl", 4, MTL_REFL);
+        case MTL_KEY2('n', 'o'):
+          return mtlKeywordIf(token, "norm", 4, MTL_NORM);
+        default:
+          return MTL_UNKNOWN;
+      }
+    case 5:
+      switch (key) {
+        case MTL_KEY2('i', 'l'):
+          return mtlKeywordIf(token, "illum", 5, MTL_ILLUM);
+        case MTL_KEY2('a', 'n'):
+          return mtlKeywordIf(token, "aniso", 5, MTL_ANISO);
+        case MTL_KEY2('m', 'a'):
+          return mtlKeywordIf(token, "map_d", 5, MTL_MAP_D);
+        default:
+          return MTL_UNKNOWN;
+      }
+    case 6:
+      switch (key) {
+        case MTL_KEY2('n', 'e'):
+          return mtlKeywordIf(token, "newmtl", 6, MTL_NEWMTL);
+        case MTL_KEY2('a', 'n'):
+          return mtlKeywordIf(token, "anisor", 6, MTL_ANISOR);
+        case MTL_KEY2('m', 'a'):
+          if (memcmp(token, "map_", 4) != 0) {
+            return MTL_UNKNOWN;
+          }
+          switch (MTL_KEY2(token[4], token[5])) {
+            case MTL_KEY2('K', 'a'):
+              return MTL_MAP_KA;
+            case MTL_KEY2('K', 'd'):
+              return MTL_MAP_KD;
+            case MTL_KEY2('K', 's'):
+              return MTL_MAP_KS;
+            case MTL_KEY2('N', 's'):
+              return MTL_MAP_NS;
+            case MTL_KEY2('P', 'r'):
+              return MTL_MAP_PR;
+            case MTL_KEY2('P', 'm'):
+              return MTL_MAP_PM;
+            case MTL_KEY2('P', 's'):
+              return MTL_MAP_PS;
+            case MTL_KEY2('K', 'e'):
+              return MTL_MAP_KE;
+            default:
+              return MTL_UNKNOWN;
+          }
+        default:
+          return MTL_UNKNOWN;
+      }
+    case 8:
+      if (memcmp(token, "map_bump", 8) == 0) {
+        return MTL_MAP_BUMP;
+      }
+      return mtlKeywordIf(token, "map_Bump", 8, MTL_MAP_BUMP_UPPER);
+    default:
+      return MTL_UNKNOWN;
+  }
+}
+
+#undef MTL_KEY2
+
+static size_t numMaterials(const std::vector<material_t> *materials) {
+  return materials->size();
+}
+
+static size_t numMaterials(const CompactMaterials *materials) {
+  return materials->Size();
+}
+
+static void addMaterial(std::vector<material_t> *materials,
+                        const material_t &material) {
+  materials->push_back(material);
+}
+
+static void addMaterial(CompactMaterials *materials,
+                        const material_t &material) {
+  materials->Add(material);
+}
+
+template <typename Materials>
+static void loadMtl(std::map<std::string, int> *material_map,
+                    Materials *materials, std::istream *inStream,
+                    std::string *warning) {
+  // Create a default material anyway.
+  material_t material;
+  InitMaterial(&material);
+
+  // Issue 43. `d` wins against `Tr` since `Tr` is not in the MTL specification.
+  bool has_d = false;
+  bool has_tr = false;
+
+  std::stringstream ss;
+
+  std::vector<char> buf;
+  ReadStreamToBuffer(*inStream, &buf);
+  LineReader lines(buf.empty() ? NULL : &buf.at(0), buf.size());
+
+  std::string linebuf;
+  const char *line;
+  const char *line_end;
+  while (lines.next(&line, &line_end)) {
+    // Trim trailing whitespace.
+    while ((line_end > line) && IS_SPACE(line_end[-1])) {
+      line_end--;
+    }
+
+    // Skip if empty line.
+    if (line == line_end) {
+      continue;
+    }
+
+    // Copy with a terminator and padding for the token scanners.
+    linebuf.assign(line, line_end);
+    linebuf.append(kScanPadding, '\0');
+
+    // Skip leading space.
+    const char *token = linebuf.c_str();
+    token = skipSpace(token);
+
+    assert(token);
+    if (token[0] == '\0') continue;  // empty line
+
+    if (token[0] == '#') continue;  // comment line
+
+    switch (findMtlKeyword(token)) {
+      // new mtl
+      case MTL_NEWMTL: {
+        // flush previous material.
+        if (!material.name.empty()) {
+          material_map->insert(std::pair<std::string, int>(
+              material.name, static_cast<int>(numMaterials(materials))));
+          addMaterial(materials, material);
+        }
+
+        // initial temporary material
+        InitMaterial(&material);
+
+        has_d = false;
+        has_tr = false;
+
+        // set new mtl name
+        token += 7;
+        material.name.assign(token);
+        continue;
+      }
+
+      // ambient
+      case MTL_KA: {
+        token += 2;
+        real_t r, g, b;
+        parseReal3(&r, &g, &b, &token);
+        material.ambient[0] = r;
+        material.ambient[1] = g;
+        material.ambient[2] = b;
+        continue;
+      }
+
+      // diffuse
+      case MTL_KD: {
+        token += 2;
+        real_t r, g, b;
+        parseReal3(&r, &g, &b, &token);
+        material.diffuse[0] = r;
+        material.diffuse[1] = g;
+        material.diffuse[2] = b;
+        continue;
+      }
+
+      // specular
+      case MTL_KS: {
+        token += 2;
+        real_t r, g, b;
+        parseReal3(&r, &g, &b, &token);
+        material.specular[0] = r;
+        material.specular[1] = g;
+        material.specular[2] = b;
+        continue;
+      }
+
+      // transmittance
+      case MTL_KT: {
+        token += 2;
+        real_t r, g, b;
+        parseReal3(&r, &g, &b, &token);
+        material.transmittance[0] = r;
+        material.transmittance[1] = g;
+        material.transmittance[2] = b;
+        continue;
+      }
+
+      // ior(index of refraction)
+      case MTL_NI: {
+        token += 2;
+        material.ior = parseReal(&token);
+        continue;
+      }
+
+      // emission
+      case MTL_KE: {
+        token += 2;
+        real_t r, g, b;
+        parseReal3(&r, &g, &b, &token);
+        material.emission[0] = r;
+        material.emission[1] = g;
+        material.emission[2] = b;
+        continue;
+      }
+
+      // shininess
+      case MTL_NS: {
+        token += 2;
+        material.shininess = parseReal(&token);
+        continue;
+      }
+
+      // illum model
+      case MTL_ILLUM: {
+        token += 6;
+        material.illum = parseInt(&token);
+        continue;
+      }
+
+      // dissolve
+      case MTL_D: {
+        token += 1;
+        material.dissolve = parseReal(&token);
+
+        if (has_tr) {
+          ss << "WARN: Both `d` and `Tr` parameters defined for \""
+             << material.name << "\". Use the value of `d` for dissolve."
+             << std::endl;
+        }
+        has_d = true;
+        continue;
+      }
+      case MTL_TR: {
+        token += 2;
+        if (has_d) {
+          // `d` wins. Ignore `Tr` value.
+          ss << "WARN: Both `d` and `Tr` parameters defined for \""
+             << material.name << "\". Use the value of `d` for dissolve."
+             << std::endl;
+        } else {
+          // We invert value of Tr(assume Tr is in range [0, 1])
+          // NOTE: Interpretation of Tr is application(exporter) dependent. For
+          // some application(e.g. 3ds max obj exporter), Tr = d(Issue 43)
+          material.dissolve = static_cast<real_t>(1.0) - parseReal(&token);
+        }
+        has_tr = true;
+        continue;
+      }
+
+      // PBR: roughness
+      case MTL_PR: {
+        token += 2;
+        material.roughness = parseReal(&token);
+        continue;
+      }
+
+      // PBR: metallic
+      case MTL_PM: {
+        token += 2;
+        material.metallic = parseReal(&token);
+        continue;
+      }
+
+      // PBR: sheen
+      case MTL_PS: {
+        token += 2;
+        material.sheen = parseReal(&token);
+        continue;
+      }
+
+      // PBR: clearcoat thickness
+      case MTL_PC: {
+        token += 2;
+        material.clearcoat_thickness = parseReal(&token);
+        continue;
+      }
+
+      // PBR: clearcoat roughness
+      case MTL_PCR: {
+        token += 4;
+        material.clearcoat_roughness = parseReal(&token);
+        continue;
+      }
+
+      // PBR: anisotropy
+      case MTL_ANISO: {
+        token += 6;
+        material.anisotropy = parseReal(&token);
+        continue;
+      }
+
+      // PBR: anisotropy rotation
+      case MTL_ANISOR: {
+        token += 7;
+        material.anisotropy_rotation = parseReal(&token);
+        continue;
+      }
+
+      // ambient texture
+      case MTL_MAP_KA: {
+        token += 7;
+        ParseTextureNameAndOption(&(material.ambient_texname),
+                                  &(material.ambient_texopt), token,
+                                  /* is_bump */ false);
+        continue;
+      }
+
+      // diffuse texture
+      case MTL_MAP_KD: {
+        token += 7;
+        ParseTextureNameAndOption(&(material.diffuse_texname),
+                                  &(material.diffuse_texopt), token,
+                                  /* is_bump */ false);
+        continue;
+      }
+
+      // specular texture
+      case MTL_MAP_KS: {
+        token += 7;
+        ParseTextureNameAndOption(&(material.specular_texname),
+                                  &(material.specular_texopt), token,
+                                  /* is_bump */ false);
+        continue;
+      }
+
+      // specular highlight texture
+      case MTL_MAP_NS: {
+        token += 7;
+        ParseTextureNameAndOption(&(material.specular_highlight_texname),
+                                  &(material.specular_highlight_texopt), token,
+                                  /* is_bump */ false);
+        continue;
+      }
+
+      // bump texture
+      case MTL_MAP_BUMP: {
+        token += 9;
+        ParseTextureNameAndOption(&(material.bump_texname),
+                                  &(material.bump_texopt), token,
+                                  /* is_bump */ true);
+        continue;
+      }
+
+      // bump texture
+      case MTL_MAP_BUMP_UPPER: {
+        token += 9;
+        ParseTextureNameAndOption(&(material.bump_texname),
+                                  &(material.bump_texopt), token,
+                                  /* is_bump */ true);
+        continue;
+      }
+
+      // bump texture
+      case MTL_BUMP: {
+        token += 5;
+        ParseTextureNameAndOption(&(material.bump_texname),
+                                  &(material.bump_texopt), token,
+                                  /* is_bump */ true);
+        continue;
+      }
+
+      // alpha texture
+      case MTL_MAP_D: {
+        token += 6;
+        material.alpha_texname = token;
+        ParseTextureNameAndOption(&(material.alpha_texname),
+                                  &(material.alpha_texopt), token,
+                                  /* is_bump */ false);
+        continue;
+      }
+
+      // displacement texture
+      case MTL_DISP: {
+        token += 5;
+        ParseTextureNameAndOption(&(material.displacement_texname),
+                                  &(material.displacement_texopt), token,
+                                  /* is_bump */ false);
+        continue;
+      }
+
+      // reflection map
+      case MTL_REFL: {
+        token += 5;
+        ParseTextureNameAndOption(&(material.reflection_texname),
+                                  &(material.reflection_texopt), token,
+                                  /* is_bump */ false);
+        continue;
+      }
+
+      // PBR: roughness texture
+      case MTL_MAP_PR: {
+        token += 7;
+        ParseTextureNameAndOption(&(material.roughness_texname),
+                                  &(material.roughness_texopt), token,
+                                  /* is_bump */ false);
+        continue;
+      }
+
+      // PBR: metallic texture
+      case MTL_MAP_PM: {
+        token += 7;
+        ParseTextureNameAndOption(&(material.metallic_texname),
+                                  &(material.metallic_texopt), token,
+                                  /* is_bump */ false);
+        continue;
+      }
 
-  const char *token = linebuf;  // Assume line ends with NULL
+      // PBR: sheen texture
+      case MTL_MAP_PS: {
+        token += 7;
+        ParseTextureNameAndOption(&(material.sheen_texname),
+                                  &(material.sheen_texopt), token,
+                                  /* is_bump */ false);
+        continue;
+      }
 
-  while (!IS_NEW_LINE((*token))) {
-    token += strspn(token, " \t");  // skip space
-    if ((0 == strncmp(token, "-blendu", 7)) && IS_SPACE((token[7]))) {
-      token += 8;
-      texopt->blendu = parseOnOff(&token, /* default */ true);
-    } else if ((0 == strncmp(token, "-blendv", 7)) && IS_SPACE((token[7]))) {
-      token += 8;
-      texopt->blendv = parseOnOff(&token, /* default */ true);
-    } else if ((0 == strncmp(token, "-clamp", 6)) && IS_SPACE((token[6]))) {
-      token += 7;
-      texopt->clamp = parseOnOff(&token, /* default */ true);
-    } else if ((0 == strncmp(token, "-boost", 6)) && IS_SPACE((token[6]))) {
-      token += 7;
-      texopt->sharpness = parseReal(&token, 1.0);
-    } else if ((0 == strncmp(token, "-bm", 3)) && IS_SPACE((token[3]))) {
-      token += 4;
-      texopt->bump_multiplier = parseReal(&token, 1.0);
-    } else if ((0 == strncmp(token, "-o", 2)) && IS_SPACE((token[2]))) {
-      token += 3;
-      parseReal3(&(texopt->origin_offset[0]), &(texopt->origin_offset[1]),
-                 &(texopt->origin_offset[2]), &token);
-    } else if ((0 == strncmp(token, "-s", 2)) && IS_SPACE((token[2]))) {
-      token += 3;
-      parseReal3(&(texopt->scale[0]), &(texopt->scale[1]), &(texopt->scale[2]),
-                 &token, 1.0, 1.0, 1.0);
-    } else if ((0 == strncmp(token, "-t", 2)) && IS_SPACE((token[2]))) {
-      token += 3;
-      parseReal3(&(texopt->turbulence[0]), &(texopt->turbulence[1]),
-                 &(texopt->turbulence[2]), &token);
-    } else if ((0 == strncmp(token, "-type", 5)) && IS_SPACE((token[5]))) {
-      token += 5;
-      texopt->type = parseTextureType((&token), TEXTURE_TYPE_NONE);
-    } else if ((0 == strncmp(token, "-imfchan", 8)) && IS_SPACE((token[8]))) {
-      token += 9;
-      token += strspn(token, " \t");
-      const char *end = token + strcspn(token, " \t\r");
-      if ((end - token) == 1) {  // Assume one char for -imfchan
-        texopt->imfchan = (*token);
+      // PBR: emissive texture
+      case MTL_MAP_KE: {
+        token += 7;
+        ParseTextureNameAndOption(&(material.emissive_texname),
+                                  &(material.emissive_texopt), token,
+                                  /* is_bump */ false);
+        continue;
       }
-      token = end;
-    } else if ((0 == strncmp(token, "-mm", 3)) && IS_SPACE((token[3]))) {
-      token += 4;
-      parseReal2(&(texopt->brightness), &(texopt->contrast), &token, 0.0, 1.0);
-    } else {
-    // Assume texture filename
-#if 0
-      size_t len = strcspn(token, " \t\r");  // untile next space
-      texture_name = std::string(token, token + len);
-      token += len;
 
-      token += strspn(token, " \t");  // skip space
-#else
-      // Read filename until line end to parse filename containing whitespace
-      // TODO(syoyo): Support parsing texture option flag after the filename.
-      texture_name = std::string(token);
-      token += texture_name.length();
-#endif
+      // PBR: normal map texture
+      case MTL_NORM: {
+        token += 5;
+        ParseTextureNameAndOption(
+            &(material.normal_texname), &(material.normal_texopt), token,
+            /* is_bump */ false);  // @fixme { is_bump will be true? }
+        continue;
+      }
 
-      found_texname = true;
+      default:
+        break;
+    }
+
+    // unknown parameter
+    const char *_space = strchr(token, ' ');
+    if (!_space) {
+      _space = strchr(token, '\t');
+    }
+    if (_space) {
+      std::ptrdiff_t len = _space - token;
+      std::string key(token, static_cast<size_t>(len));
+      std::string value = _space + 1;
+      material.unknown_parameter.insert(
+          std::pair<std::string, std::string>(key, value));
     }
   }
+  // flush last material.
+  material_map->insert(std::pair<std::string, int>(
+      material.name, static_cast<int>(numMaterials(materials))));
+  addMaterial(materials, material);
 
-  if (found_texname) {
-    (*texname) = texture_name;
-    return true;
-  } else {
-    return false;
+  if (warning) {
+    (*warning) = ss.str();
   }
 }
 
-static void InitMaterial(material_t *material) {
-  material->name = "";
-  material->ambient_texname = "";
-  material->diffuse_texname = "";
-  material->specular_texname = "";
-  material->specular_highlight_texname = "";
-  material->bump_texname = "";
-  material->displacement_texname = "";
-  material->reflection_texname = "";
-  material->alpha_texname = "";
+void LoadMtl(std::map<std::string, int> *material_map,
+             std::vector<material_t> *materials, std::istream *inStream,
+             std::string *warning) {
+  loadMtl(material_map, materials, inStream, warning);
+}
+
+void LoadMtl(std::map<std::string, int> *material_map,
+             CompactMaterials *materials, std::istream *inStream,
+             std::string *warning) {
+  loadMtl(material_map, materials, inStream, warning);
+}
+
+// `material_t` members of each `texture_slot_t`.
+static std::string material_t::*const kTextureNames[TEXTURE_SLOT_COUNT] = {
+    &material_t::ambient_texname,      &material_t::diffuse_texname,
+    &material_t::specular_texname,     &material_t::specular_highlight_texname,
+    &material_t::bump_texname,         &material_t::displacement_texname,
+    &material_t::alpha_texname,        &material_t::reflection_texname,
+    &material_t::roughness_texname,    &material_t::metallic_texname,
+    &material_t::sheen_texname,        &material_t::emissive_texname,
+    &material_t::normal_texname};
+
+static texture_option_t material_t::*const
+    kTextureOptions[TEXTURE_SLOT_COUNT] = {
+        &material_t::ambient_texopt,      &material_t::diffuse_texopt,
+        &material_t::specular_texopt,     &material_t::specular_highlight_texopt,
+        &material_t::bump_texopt,         &material_t::displacement_texopt,
+        &material_t::alpha_texopt,        &material_t::reflection_texopt,
+        &material_t::roughness_texopt,    &material_t::metallic_texopt,
+        &material_t::sheen_texopt,        &material_t::emissive_texopt,
+        &material_t::normal_texopt};
+
+static bool sameTextureOption(const texture_option_t &a,
+                              const texture_option_t &b) {
   for (int i = 0; i < 3; i++) {
-    material->ambient[i] = static_cast<real_t>(0.0);
-    material->diffuse[i] = static_cast<real_t>(0.0);
-    material->specular[i] = static_cast<real_t>(0.0);
-    material->transmittance[i] = static_cast<real_t>(0.0);
-    material->emission[i] = static_cast<real_t>(0.0);
+    if ((a.origin_offset[i] != b.origin_offset[i]) ||
+        (a.scale[i] != b.scale[i]) || (a.turbulence[i] != b.turbulence[i])) {
+      return false;
+    }
   }
-  material->illum = 0;
-  material->dissolve = static_cast<real_t>(1.0);
-  material->shininess = static_cast<real_t>(1.0);
-  material->ior = static_cast<real_t>(1.0);
+  return (a.type == b.type) && (a.sharpness == b.sharpness) &&
+         (a.brightness == b.brightness) && (a.contrast == b.contrast) &&
+         (a.clamp == b.clamp) && (a.imfchan == b.imfchan) &&
+         (a.blendu == b.blendu) && (a.blendv == b.blendv) &&
+         (a.bump_multiplier == b.bump_multiplier);
+}
 
-  material->roughness = static_cast<real_t>(0.0);
-  material->metallic = static_cast<real_t>(0.0);
-  material->sheen = static_cast<real_t>(0.0);
-  material->clearcoat_thickness = static_cast<real_t>(0.0);
-  material->clearcoat_roughness = static_cast<real_t>(0.0);
-  material->anisotropy_rotation = static_cast<real_t>(0.0);
-  material->anisotropy = static_cast<real_t>(0.0);
-  material->roughness_texname = "";
-  material->metallic_texname = "";
-  material->sheen_texname = "";
-  material->emissive_texname = "";
-  material->normal_texname = "";
+CompactMaterials::CompactMaterials() { intern(std::string()); }
 
-  material->unknown_parameter.clear();
+CompactMaterials::CompactMaterials(const CompactMaterials &other)
+    : m_materials(other.m_materials),
+      m_texopts(other.m_texopts),
+      m_unknownParameters(other.m_unknownParameters) {
+  // `m_strings` points into `m_stringIds`, so it is rebuilt in ID order.
+  m_strings.reserve(other.m_strings.size());
+  for (size_t i = 0; i < other.m_strings.size(); i++) {
+    intern(*other.m_strings[i]);
+  }
 }
 
-// code from https://wrf.ecse.rpi.edu//Research/Short_Notes/pnpoly.html
-template<typename T>
-static int pnpoly(int nvert, T *vertx, T *verty, T testx,
-                  T testy) {
-  int i, j, c = 0;
-  for (i = 0, j = nvert - 1; i < nvert; j = i++) {
-    if (((verty[i] > testy) != (verty[j] > testy)) &&
-        (testx <
-         (vertx[j] - vertx[i]) * (testy - verty[i]) / (verty[j] - verty[i]) +
-             vertx[i]))
-      c = !c;
-  }
-  return c;
+CompactMaterials &CompactMaterials::operator=(const CompactMaterials &other) {
+  CompactMaterials copy(other);
+  Swap(copy);
+  return *this;
 }
 
-// TODO(syoyo): refactor function.
-static bool exportFaceGroupToShape(shape_t *shape,
-                                   const std::vector<face_t> &faceGroup,
-                                   const std::vector<tag_t> &tags,
-                                   const int material_id,
-                                   const std::string &name, bool triangulate,
-                                   const std::vector<real_t> &v) {
-  if (faceGroup.empty()) {
-    return false;
+unsigned int CompactMaterials::intern(const std::string &str) {
+  std::map<std::string, unsigned int>::iterator it =
+      m_stringIds.lower_bound(str);
+  if ((it != m_stringIds.end()) && (it->first == str)) {
+    return it->second;
   }
 
-  // Flatten vertices and indices
-  for (size_t i = 0; i < faceGroup.size(); i++) {
-    const face_t &face = faceGroup[i];
+  const unsigned int id = static_cast<unsigned int>(m_strings.size());
+  it = m_stringIds.insert(it, std::make_pair(str, id));
+  m_strings.push_back(&it->first);
+  return id;
+}
 
-    if (face.vertex_indices.size() < 3) {
-      // Face must have 3+ vertices.
+size_t CompactMaterials::Add(const material_t &material) {
+  compact_material_t m;
+  material_params_t &params = m.params;
+  for (int i = 0; i < 3; i++) {
+    params.ambient[i] = material.ambient[i];
+    params.diffuse[i] = material.diffuse[i];
+    params.specular[i] = material.specular[i];
+    params.transmittance[i] = material.transmittance[i];
+    params.emission[i] = material.emission[i];
+  }
+  params.shininess = material.shininess;
+  params.ior = material.ior;
+  params.dissolve = material.dissolve;
+  params.roughness = material.roughness;
+  params.metallic = material.metallic;
+  params.sheen = material.sheen;
+  params.clearcoat_thickness = material.clearcoat_thickness;
+  params.clearcoat_roughness = material.clearcoat_roughness;
+  params.anisotropy = material.anisotropy;
+  params.anisotropy_rotation = material.anisotropy_rotation;
+  params.illum = material.illum;
+
+  m.name = intern(material.name);
+
+  m.first_texopt = static_cast<unsigned int>(m_texopts.size());
+  for (int i = 0; i < TEXTURE_SLOT_COUNT; i++) {
+    const texture_slot_t slot = static_cast<texture_slot_t>(i);
+    const std::string &texname = material.*kTextureNames[slot];
+    m.texnames[slot] = intern(texname);
+    if (texname.empty()) {
       continue;
     }
 
-    vertex_index_t i0 = face.vertex_indices[0];
-    vertex_index_t i1(-1);
-    vertex_index_t i2 = face.vertex_indices[1];
+    texture_option_t texopt;
+    initTextureOption(&texopt, slot == TEXTURE_SLOT_BUMP);
+    if (!sameTextureOption(material.*kTextureOptions[slot], texopt)) {
+      slot_texture_option_t slot_texopt;
+      slot_texopt.slot = slot;
+      slot_texopt.option = material.*kTextureOptions[slot];
+      m_texopts.push_back(slot_texopt);
+    }
+  }
+  m.num_texopts =
+      static_cast<unsigned int>(m_texopts.size()) - m.first_texopt;
+
+  m.first_unknown_parameter =
+      static_cast<unsigned int>(m_unknownParameters.size());
+  m.num_unknown_parameters =
+      static_cast<unsigned int>(material.unknown_parameter.size());
+  std::map<std::string, std::string>::const_iterator it =
+      material.unknown_parameter.begin();
+  for (; it != material.unknown_parameter.end(); ++it) {
+    unknown_parameter_t param;
+    param.key = intern(it->first);
+    param.value = intern(it->second);
+    m_unknownParameters.push_back(param);
+  }
 
-    size_t npolys = face.vertex_indices.size();
+  m_materials.push_back(m);
+  return m_materials.size() - 1;
+}
 
-    if (triangulate) {
-      // find the two axes to work in
-      size_t axes[2] = {1, 2};
-      for (size_t k = 0; k < npolys; ++k) {
-        i0 = face.vertex_indices[(k + 0) % npolys];
-        i1 = face.vertex_indices[(k + 1) % npolys];
-        i2 = face.vertex_indices[(k + 2) % npolys];
-        size_t vi0 = size_t(i0.v_idx);
-        size_t vi1 = size_t(i1.v_idx);
-        size_t vi2 = size_t(i2.v_idx);
-        real_t v0x = v[vi0 * 3 + 0];
-        real_t v0y = v[vi0 * 3 + 1];
-        real_t v0z = v[vi0 * 3 + 2];
-        real_t v1x = v[vi1 * 3 + 0];
-        real_t v1y = v[vi1 * 3 + 1];
-        real_t v1z = v[vi1 * 3 + 2];
-        real_t v2x = v[vi2 * 3 + 0];
-        real_t v2y = v[vi2 * 3 + 1];
-        real_t v2z = v[vi2 * 3 + 2];
-        real_t e0x = v1x - v0x;
-        real_t e0y = v1y - v0y;
-        real_t e0z = v1z - v0z;
-        real_t e1x = v2x - v1x;
-        real_t e1y = v2y - v1y;
-        real_t e1z = v2z - v1z;
-        real_t cx = std::fabs(e0y * e1z - e0z * e1y);
-        real_t cy = std::fabs(e0z * e1x - e0x * e1z);
-        real_t cz = std::fabs(e0x * e1y - e0y * e1x);
-        const real_t epsilon = std::numeric_limits<real_t>::epsilon();
-        if (cx > epsilon || cy > epsilon || cz > epsilon) {
-          // found a corner
-          if (cx > cy && cx > cz) {
-          } else {
-            axes[0] = 0;
-            if (cz > cx && cz > cy) axes[1] = 1;
-          }
-          break;
-        }
-      }
+void CompactMaterials::Add(const std::vector<material_t> &materials) {
+  m_materials.reserve(m_materials.size() + materials.size());
+  for (size_t i = 0; i < materials.size(); i++) {
+    Add(materials[i]);
+  }
+}
 
-      real_t area = 0;
-      for (size_t k = 0; k < npolys; ++k) {
-        i0 = face.vertex_indices[(k + 0) % npolys];
-        i1 = face.vertex_indices[(k + 1) % npolys];
-        size_t vi0 = size_t(i0.v_idx);
-        size_t vi1 = size_t(i1.v_idx);
-        real_t v0x = v[vi0 * 3 + axes[0]];
-        real_t v0y = v[vi0 * 3 + axes[1]];
-        real_t v1x = v[vi1 * 3 + axes[0]];
-        real_t v1y = v[vi1 * 3 + axes[1]];
-        area += (v0x * v1y - v0y * v1x) * static_cast<real_t>(0.5);
-      }
-
-      int maxRounds =
-          10;  // arbitrary max loop count to protect against unexpected errors
-
-      face_t remainingFace = face;  // copy
-      size_t guess_vert = 0;
-      vertex_index_t ind[3];
-      real_t vx[3];
-      real_t vy[3];
-      while (remainingFace.vertex_indices.size() > 3 && maxRounds > 0) {
-        npolys = remainingFace.vertex_indices.size();
-        if (guess_vert >= npolys) {
-          maxRounds -= 1;
-          guess_vert -= npolys;
-        }
-        for (size_t k = 0; k < 3; k++) {
-          ind[k] = remainingFace.vertex_indices[(guess_vert + k) % npolys];
-          size_t vi = size_t(ind[k].v_idx);
-          vx[k] = v[vi * 3 + axes[0]];
-          vy[k] = v[vi * 3 + axes[1]];
-        }
-        real_t e0x = vx[1] - vx[0];
-        real_t e0y = vy[1] - vy[0];
-        real_t e1x = vx[2] - vx[1];
-        real_t e1y = vy[2] - vy[1];
-        real_t cross = e0x * e1y - e0y * e1x;
-        // if an internal angle
-        if (cross * area < static_cast<real_t>(0.0)) {
-          guess_vert += 1;
-          continue;
-        }
+void CompactMaterials::Get(size_t index, material_t *material) const {
+  const compact_material_t &m = m_materials[index];
+  const material_params_t &params = m.params;
+  material->name = GetString(m.name);
+  for (int i = 0; i < 3; i++) {
+    material->ambient[i] = params.ambient[i];
+    material->diffuse[i] = params.diffuse[i];
+    material->specular[i] = params.specular[i];
+    material->transmittance[i] = params.transmittance[i];
+    material->emission[i] = params.emission[i];
+  }
+  material->shininess = params.shininess;
+  material->ior = params.ior;
+  material->dissolve = params.dissolve;
+  material->illum = params.illum;
+  material->dummy = 0;
+  material->roughness = params.roughness;
+  material->metallic = params.metallic;
+  material->sheen = params.sheen;
+  material->clearcoat_thickness = params.clearcoat_thickness;
+  material->clearcoat_roughness = params.clearcoat_roughness;
+  material->anisotropy = params.anisotropy;
+  material->anisotropy_rotation = params.anisotropy_rotation;
+  material->pad0 = static_cast<real_t>(0.0);
+  material->pad2 = 0;
+
+  for (int i = 0; i < TEXTURE_SLOT_COUNT; i++) {
+    const texture_slot_t slot = static_cast<texture_slot_t>(i);
+    material->*kTextureNames[slot] = GetString(m.texnames[slot]);
+    GetTextureOption(index, slot, &(material->*kTextureOptions[slot]));
+  }
 
-        // check all other verts in case they are inside this triangle
-        bool overlap = false;
-        for (size_t otherVert = 3; otherVert < npolys; ++otherVert) {
-          size_t ovi = size_t(
-              remainingFace.vertex_indices[(guess_vert + otherVert) % npolys]
-                  .v_idx);
-          real_t tx = v[ovi * 3 + axes[0]];
-          real_t ty = v[ovi * 3 + axes[1]];
-          if (pnpoly(3, vx, vy, tx, ty)) {
-            overlap = true;
-            break;
-          }
-        }
+  material->unknown_parameter.clear();
+  for (unsigned int i = 0; i < m.num_unknown_parameters; i++) {
+    const unknown_parameter_t &param =
+        m_unknownParameters[m.first_unknown_parameter + i];
+    // Stored in key order, so each one is inserted at the end.
+    material->unknown_parameter.insert(
+        material->unknown_parameter.end(),
+        std::make_pair(GetString(param.key), GetString(param.value)));
+  }
+}
 
-        if (overlap) {
-          guess_vert += 1;
-          continue;
-        }
+void CompactMaterials::Get(std::vector<material_t> *materials) const {
+  materials->resize(m_materials.size());
+  for (size_t i = 0; i < m_materials.size(); i++) {
+    Get(i, &(*materials)[i]);
+  }
+}
 
-        // this triangle is an ear
-        {
-          index_t idx0, idx1, idx2;
-          idx0.vertex_index = ind[0].v_idx;
-          idx0.normal_index = ind[0].vn_idx;
-          idx0.texcoord_index = ind[0].vt_idx;
-          idx1.vertex_index = ind[1].v_idx;
-          idx1.normal_index = ind[1].vn_idx;
-          idx1.texcoord_index = ind[1].vt_idx;
-          idx2.vertex_index = ind[2].v_idx;
-          idx2.normal_index = ind[2].vn_idx;
-          idx2.texcoord_index = ind[2].vt_idx;
-
-          shape->mesh.indices.push_back(idx0);
-          shape->mesh.indices.push_back(idx1);
-          shape->mesh.indices.push_back(idx2);
-
-          shape->mesh.num_face_vertices.push_back(3);
-          shape->mesh.material_ids.push_back(material_id);
-          shape->mesh.smoothing_group_ids.push_back(face.smoothing_group_id);
-        }
+void CompactMaterials::GetTextureOption(size_t index, texture_slot_t slot,
+                                        texture_option_t *option) const {
+  const compact_material_t &m = m_materials[index];
+  for (unsigned int i = 0; i < m.num_texopts; i++) {
+    const slot_texture_option_t &slot_texopt = m_texopts[m.first_texopt + i];
+    if (slot_texopt.slot == slot) {
+      (*option) = slot_texopt.option;
+      return;
+    }
+  }
+  initTextureOption(option, slot == TEXTURE_SLOT_BUMP);
+}
 
-        // remove v1 from the list
-        size_t removed_vert_index = (guess_vert + 1) % npolys;
-        while (removed_vert_index + 1 < npolys) {
-          remainingFace.vertex_indices[removed_vert_index] =
-              remainingFace.vertex_indices[removed_vert_index + 1];
-          removed_vert_index += 1;
-        }
-        remainingFace.vertex_indices.pop_back();
-      }
-
-      if (remainingFace.vertex_indices.size() == 3) {
-        i0 = remainingFace.vertex_indices[0];
-        i1 = remainingFace.vertex_indices[1];
-        i2 = remainingFace.vertex_indices[2];
-        {
-          index_t idx0, idx1, idx2;
-          idx0.vertex_index = i0.v_idx;
-          idx0.normal_index = i0.vn_idx;
-          idx0.texcoord_index = i0.vt_idx;
-          idx1.vertex_index = i1.v_idx;
-          idx1.normal_index = i1.vn_idx;
-          idx1.texcoord_index = i1.vt_idx;
-          idx2.vertex_index = i2.v_idx;
-          idx2.normal_index = i2.vn_idx;
-          idx2.texcoord_index = i2.vt_idx;
-
-          shape->mesh.indices.push_back(idx0);
-          shape->mesh.indices.push_back(idx1);
-          shape->mesh.indices.push_back(idx2);
-
-          shape->mesh.num_face_vertices.push_back(3);
-          shape->mesh.material_ids.push_back(material_id);
-          shape->mesh.smoothing_group_ids.push_back(face.smoothing_group_id);
-        }
+void CompactMaterials::Reserve(size_t num_materials) {
+  m_materials.reserve(num_materials);
+}
+
+void CompactMaterials::Clear() {
+  CompactMaterials empty;
+  Swap(empty);
+}
+
+void CompactMaterials::Swap(CompactMaterials &other) {
+  m_materials.swap(other.m_materials);
+  m_stringIds.swap(other.m_stringIds);
+  m_strings.swap(other.m_strings);
+  m_texopts.swap(other.m_texopts);
+  m_unknownParameters.swap(other.m_unknownParameters);
+}
+
+static bool loadCachedMtlFile(const std::string &filepath,
+                              std::vector<material_t> *materials,
+                              std::map<std::string, int> *matMap,
+                              std::string *err);
+
+static bool loadMtlFile(const std::string &filepath,
+                        std::vector<material_t> *materials,
+                        std::map<std::string, int> *matMap, std::string *err) {
+  std::ifstream matIStream(filepath.c_str());
+#ifdef TINYOBJLOADER_USE_ZLIB
+  // The file may be gzip compressed, also as `<filepath>.gz`.
+  std::vector<char> gz;
+  if (readGzipFile(filepath, &gz) ||
+      (!matIStream && readGzipFile(filepath + ".gz", &gz))) {
+    std::vector<char> mtl;
+    if (!inflateGzip(&gz.at(0), gz.size(), &mtl)) {
+      std::stringstream ss;
+      ss << "WARN: Material file [ " << filepath << " ] is corrupt."
+         << std::endl;
+      if (err) {
+        (*err) += ss.str();
       }
-    } else {
-      for (size_t k = 0; k < npolys; k++) {
-        index_t idx;
-        idx.vertex_index = face.vertex_indices[k].v_idx;
-        idx.normal_index = face.vertex_indices[k].vn_idx;
-        idx.texcoord_index = face.vertex_indices[k].vt_idx;
-        shape->mesh.indices.push_back(idx);
+      return false;
+    }
+    std::istringstream mtlIStream(std::string(mtl.begin(), mtl.end()));
+    std::string warning;
+    LoadMtl(matMap, materials, &mtlIStream, &warning);
+    if (!warning.empty()) {
+      if (err) {
+        (*err) += warning;
       }
-
-      shape->mesh.num_face_vertices.push_back(
-          static_cast<unsigned char>(npolys));
-      shape->mesh.material_ids.push_back(material_id);  // per face
-      shape->mesh.smoothing_group_ids.push_back(
-          face.smoothing_group_id);  // per face
     }
+    return true;
+  }
+#endif
+  if (!matIStream) {
+    std::stringstream ss;
+    ss << "WARN: Material file [ " << filepath << " ] not found." << std::endl;
+    if (err) {
+      (*err) += ss.str();
+    }
+    return false;
   }
 
-  shape->name = name;
-  shape->mesh.tags = tags;
-
-  return true;
-}
+  std::string warning;
+  LoadMtl(matMap, materials, &matIStream, &warning);
 
-// Split a string with specified delimiter character.
-// http://stackoverflow.com/questions/236129/split-a-string-in-c
-static void SplitString(const std::string &s, char delim,
-                        std::vector<std::string> &elems) {
-  std::stringstream ss;
-  ss.str(s);
-  std::string item;
-  while (std::getline(ss, item, delim)) {
-    elems.push_back(item);
+  if (!warning.empty()) {
+    if (err) {
+      (*err) += warning;
+    }
   }
-}
 
-void LoadMtl(std::map<std::string, int> *material_map,
-             std::vector<material_t> *materials, std::istream *inStream,
-             std::string *warning) {
-  // Create a default material anyway.
-  material_t material;
-  InitMaterial(&material);
+  return true;
+}
 
-  // Issue 43. `d` wins against `Tr` since `Tr` is not in the MTL specification.
-  bool has_d = false;
-  bool has_tr = false;
+bool MaterialFileReader::operator()(const std::string &matId,
+                                    std::vector<material_t> *materials,
+                                    std::map<std::string, int> *matMap,
+                                    std::string *err) {
+  std::string filepath;
 
-  std::stringstream ss;
+  if (!m_mtlBaseDir.empty()) {
+    filepath = std::string(m_mtlBaseDir) + matId;
+  } else {
+    filepath = matId;
+  }
 
-  std::string linebuf;
-  while (inStream->peek() != -1) {
-    safeGetline(*inStream, linebuf);
+  if (m_useCache) {
+    return loadCachedMtlFile(filepath, materials, matMap, err);
+  }
+  return loadMtlFile(filepath, materials, matMap, err);
+}
 
-    // Trim trailing whitespace.
-    if (linebuf.size() > 0) {
-      linebuf = linebuf.substr(0, linebuf.find_last_not_of(" \t") + 1);
+bool MaterialStreamReader::operator()(const std::string &matId,
+                                      std::vector<material_t> *materials,
+                                      std::map<std::string, int> *matMap,
+                                      std::string *err) {
+  (void)matId;
+  if (!m_inStream) {
+    std::stringstream ss;
+    ss << "WARN: Material stream in error state. " << std::endl;
+    if (err) {
+      (*err) += ss.str();
     }
+    return false;
+  }
 
-    // Trim newline '\r\n' or '\n'
-    if (linebuf.size() > 0) {
-      if (linebuf[linebuf.size() - 1] == '\n')
-        linebuf.erase(linebuf.size() - 1);
-    }
-    if (linebuf.size() > 0) {
-      if (linebuf[linebuf.size() - 1] == '\r')
-        linebuf.erase(linebuf.size() - 1);
-    }
+  std::string warning;
+  LoadMtl(matMap, materials, &m_inStream, &warning);
 
-    // Skip if empty line.
-    if (linebuf.empty()) {
-      continue;
+  if (!warning.empty()) {
+    if (err) {
+      (*err) += warning;
     }
+  }
 
-    // Skip leading space.
-    const char *token = linebuf.c_str();
-    token += strspn(token, " \t");
+  return true;
+}
 
-    assert(token);
-    if (token[0] == '\0') continue;  // empty line
+// Identifies a version of a file for the binary cache and the material
+// cache.
+struct file_stamp_t {
+  bool exists;
+  unsigned long long size;
+  long long mtime_sec;
+  long long mtime_nsec;
+  unsigned long long hash;  // Of the first, middle and last kStampSampleSize.
+
+  file_stamp_t()
+      : exists(false), size(0), mtime_sec(0), mtime_nsec(0), hash(0) {}
+};
 
-    if (token[0] == '#') continue;  // comment line
+// Bytes hashed at each of the three sample points of a file.
+static const size_t kStampSampleSize = 64 * 1024;
 
-    // new mtl
-    if ((0 == strncmp(token, "newmtl", 6)) && IS_SPACE((token[6]))) {
-      // flush previous material.
-      if (!material.name.empty()) {
-        material_map->insert(std::pair<std::string, int>(
-            material.name, static_cast<int>(materials->size())));
-        materials->push_back(material);
-      }
+// 64-bit FNV-1a.
+static unsigned long long hashBytes(unsigned long long hash, const char *p,
+                                    size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    hash ^= static_cast<unsigned char>(p[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
 
-      // initial temporary material
-      InitMaterial(&material);
+static file_stamp_t stampFile(const std::string &filename) {
+  file_stamp_t stamp;
+#if defined(_WIN32)
+  struct _stat64 sb;
+  if (_stat64(filename.c_str(), &sb) != 0) {
+    return stamp;
+  }
+#else
+  struct stat sb;
+  if (stat(filename.c_str(), &sb) != 0) {
+    return stamp;
+  }
+#if defined(__linux__)
+  stamp.mtime_nsec = static_cast<long long>(sb.st_mtim.tv_nsec);
+#elif defined(__APPLE__)
+  stamp.mtime_nsec = static_cast<long long>(sb.st_mtimespec.tv_nsec);
+#endif
+#endif
+  stamp.size = static_cast<unsigned long long>(sb.st_size);
+  stamp.mtime_sec = static_cast<long long>(sb.st_mtime);
 
-      has_d = false;
-      has_tr = false;
+  // Sampling keeps stamping a multi-GB file cheap. Any edit also changes
+  // the modification time.
+  std::ifstream ifs(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!ifs) {
+    return stamp;
+  }
+  unsigned long long offsets[3] = {0, 0, 0};
+  size_t num_samples = 1;
+  if (stamp.size > 3 * kStampSampleSize) {
+    offsets[1] = (stamp.size - kStampSampleSize) / 2;
+    offsets[2] = stamp.size - kStampSampleSize;
+    num_samples = 3;
+  }
+  std::vector<char> buf((num_samples == 1) ? (3 * kStampSampleSize)
+                                            : kStampSampleSize);
+  unsigned long long hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < num_samples; i++) {
+    ifs.seekg(static_cast<std::streamoff>(offsets[i]));
+    ifs.read(&buf.at(0), static_cast<std::streamsize>(buf.size()));
+    hash = hashBytes(hash, &buf.at(0), static_cast<size_t>(ifs.gcount()));
+  }
+  stamp.exists = true;
+  stamp.hash = hash;
+  return stamp;
+}
 
-      // set new mtl name
-      token += 7;
-      {
-        std::stringstream sstr;
-        sstr << token;
-        material.name = sstr.str();
-      }
-      continue;
-    }
+static bool sameStamp(const file_stamp_t &a, const file_stamp_t &b) {
+  return (a.exists == b.exists) && (a.size == b.size) &&
+         (a.mtime_sec == b.mtime_sec) && (a.mtime_nsec == b.mtime_nsec) &&
+         (a.hash == b.hash);
+}
 
-    // ambient
-    if (token[0] == 'K' && token[1] == 'a' && IS_SPACE((token[2]))) {
-      token += 2;
-      real_t r, g, b;
-      parseReal3(&r, &g, &b, &token);
-      material.ambient[0] = r;
-      material.ambient[1] = g;
-      material.ambient[2] = b;
-      continue;
-    }
+// A parsed .mtl file in the material cache. Never modified once cached.
+struct mtl_cache_entry_t {
+  file_stamp_t stamp;
+  std::vector<material_t> materials;
+  std::map<std::string, int> material_map;
+  std::string warning;
+};
 
-    // diffuse
-    if (token[0] == 'K' && token[1] == 'd' && IS_SPACE((token[2]))) {
-      token += 2;
-      real_t r, g, b;
-      parseReal3(&r, &g, &b, &token);
-      material.diffuse[0] = r;
-      material.diffuse[1] = g;
-      material.diffuse[2] = b;
-      continue;
-    }
+#ifdef TINYOBJLOADER_USE_THREADS
+typedef std::shared_ptr<const mtl_cache_entry_t> mtl_cache_ptr_t;
+#else
+// Without threads, no entry can be dropped while it is being copied.
+typedef const mtl_cache_entry_t *mtl_cache_ptr_t;
+#endif
 
-    // specular
-    if (token[0] == 'K' && token[1] == 's' && IS_SPACE((token[2]))) {
-      token += 2;
-      real_t r, g, b;
-      parseReal3(&r, &g, &b, &token);
-      material.specular[0] = r;
-      material.specular[1] = g;
-      material.specular[2] = b;
-      continue;
+// Process-wide cache of parsed .mtl files, keyed by path.
+class MaterialCache {
+ public:
+  MaterialCache() {}
+  ~MaterialCache() { clear(); }
+
+  // Returns the entry of `path` when it was parsed from the file `stamp`
+  // identifies, otherwise NULL.
+  mtl_cache_ptr_t find(const std::string &path, const file_stamp_t &stamp) {
+#ifdef TINYOBJLOADER_USE_THREADS
+    std::lock_guard<std::mutex> lock(m_mutex);
+#endif
+    std::map<std::string, mtl_cache_ptr_t>::const_iterator it =
+        m_entries.find(path);
+    if ((it == m_entries.end()) || !sameStamp(it->second->stamp, stamp)) {
+      return mtl_cache_ptr_t();
     }
+    return it->second;
+  }
 
-    // transmittance
-    if ((token[0] == 'K' && token[1] == 't' && IS_SPACE((token[2]))) ||
-        (token[0] == 'T' && token[1] == 'f' && IS_SPACE((token[2])))) {
-      token += 2;
-      real_t r, g, b;
-      parseReal3(&r, &g, &b, &token);
-      material.transmittance[0] = r;
-      material.transmittance[1] = g;
-      material.transmittance[2] = b;
-      continue;
+  // Takes ownership of `entry` and replaces any older entry of `path`.
+  mtl_cache_ptr_t store(const std::string &path, mtl_cache_entry_t *entry) {
+    mtl_cache_ptr_t ptr(entry);
+#ifdef TINYOBJLOADER_USE_THREADS
+    std::lock_guard<std::mutex> lock(m_mutex);
+#else
+    std::map<std::string, mtl_cache_ptr_t>::iterator it = m_entries.find(path);
+    if (it != m_entries.end()) {
+      delete it->second;
     }
+#endif
+    m_entries[path] = ptr;
+    return ptr;
+  }
 
-    // ior(index of refraction)
-    if (token[0] == 'N' && token[1] == 'i' && IS_SPACE((token[2]))) {
-      token += 2;
-      material.ior = parseReal(&token);
-      continue;
+  void clear() {
+#ifdef TINYOBJLOADER_USE_THREADS
+    std::lock_guard<std::mutex> lock(m_mutex);
+#else
+    for (std::map<std::string, mtl_cache_ptr_t>::iterator it =
+             m_entries.begin();
+         it != m_entries.end(); ++it) {
+      delete it->second;
     }
+#endif
+    m_entries.clear();
+  }
 
-    // emission
-    if (token[0] == 'K' && token[1] == 'e' && IS_SPACE(token[2])) {
-      token += 2;
-      real_t r, g, b;
-      parseReal3(&r, &g, &b, &token);
-      material.emission[0] = r;
-      material.emission[1] = g;
-      material.emission[2] = b;
-      continue;
-    }
+ private:
+  MaterialCache(const MaterialCache &);
+  MaterialCache &operator=(const MaterialCache &);
 
-    // shininess
-    if (token[0] == 'N' && token[1] == 's' && IS_SPACE(token[2])) {
-      token += 2;
-      material.shininess = parseReal(&token);
-      continue;
-    }
+  std::map<std::string, mtl_cache_ptr_t> m_entries;
+#ifdef TINYOBJLOADER_USE_THREADS
+  std::mutex m_mutex;
+#endif
+};
 
-    // illum model
-    if (0 == strncmp(token, "illum", 5) && IS_SPACE(token[5])) {
-      token += 6;
-      material.illum = parseInt(&token);
-      continue;
-    }
+static MaterialCache &materialCache() {
+  static MaterialCache cache;
+  return cache;
+}
 
-    // dissolve
-    if ((token[0] == 'd' && IS_SPACE(token[1]))) {
-      token += 1;
-      material.dissolve = parseReal(&token);
+void ClearMaterialCache() { materialCache().clear(); }
 
-      if (has_tr) {
-        ss << "WARN: Both `d` and `Tr` parameters defined for \""
-           << material.name << "\". Use the value of `d` for dissolve."
-           << std::endl;
-      }
-      has_d = true;
-      continue;
-    }
-    if (token[0] == 'T' && token[1] == 'r' && IS_SPACE(token[2])) {
-      token += 2;
-      if (has_d) {
-        // `d` wins. Ignore `Tr` value.
-        ss << "WARN: Both `d` and `Tr` parameters defined for \""
-           << material.name << "\". Use the value of `d` for dissolve."
-           << std::endl;
-      } else {
-        // We invert value of Tr(assume Tr is in range [0, 1])
-        // NOTE: Interpretation of Tr is application(exporter) dependent. For
-        // some application(e.g. 3ds max obj exporter), Tr = d(Issue 43)
-        material.dissolve = static_cast<real_t>(1.0) - parseReal(&token);
+static bool loadCachedMtlFile(const std::string &filepath,
+                              std::vector<material_t> *materials,
+                              std::map<std::string, int> *matMap,
+                              std::string *err) {
+  file_stamp_t stamp = stampFile(filepath);
+#ifdef TINYOBJLOADER_USE_ZLIB
+  if (!stamp.exists) {
+    stamp = stampFile(filepath + ".gz");
+  }
+#endif
+  if (!stamp.exists) {
+    return loadMtlFile(filepath, materials, matMap, err);
+  }
+
+  mtl_cache_ptr_t entry = materialCache().find(filepath, stamp);
+  if (!entry) {
+    // Parsed outside of the lock. Threads missing the same file at once
+    // each parse it and the last one is kept.
+    mtl_cache_entry_t *parsed = new mtl_cache_entry_t();
+    parsed->stamp = stamp;
+    if (!loadMtlFile(filepath, &parsed->materials, &parsed->material_map,
+                     &parsed->warning)) {
+      if (err) {
+        (*err) += parsed->warning;
       }
-      has_tr = true;
-      continue;
+      delete parsed;
+      return false;
     }
+    entry = materialCache().store(filepath, parsed);
+  }
 
-    // PBR: roughness
-    if (token[0] == 'P' && token[1] == 'r' && IS_SPACE(token[2])) {
-      token += 2;
-      material.roughness = parseReal(&token);
-      continue;
+  const size_t base = materials->size();
+  if ((base == 0) && matMap->empty()) {
+    (*matMap) = entry->material_map;
+  } else {
+    // Same as LoadMtl(): the first material of a name wins.
+    for (size_t i = 0; i < entry->materials.size(); i++) {
+      matMap->insert(std::pair<std::string, int>(
+          entry->materials[i].name, static_cast<int>(base + i)));
     }
+  }
+  materials->insert(materials->end(), entry->materials.begin(),
+                    entry->materials.end());
+  if (err) {
+    (*err) += entry->warning;
+  }
+  return true;
+}
 
-    // PBR: metallic
-    if (token[0] == 'P' && token[1] == 'm' && IS_SPACE(token[2])) {
-      token += 2;
-      material.metallic = parseReal(&token);
-      continue;
-    }
+// Binary cache file layout, in native byte order:
+//   header(obj_cache_header_t)
+//   attrib_t, shape_t[], material_t[]
+// Integers and reals are stored as is. Strings are stored as a 64-bit length
+// followed by their bytes. Vectors of integers, reals and index_t are stored
+// as a 64-bit count, padding to a multiple of 8 bytes and their elements, so
+// that the cache can also be used in place when memory mapped.
+static const char kObjCacheMagic[8] = {'t', 'i', 'n', 'y', 'o', 'b', 'j', '\0'};
+// Increase when the layout or the loaded data changes.
+static const unsigned int kObjCacheVersion = 4;
+static const unsigned int kObjCacheByteOrderMark = 0x01020304;
+
+struct obj_cache_header_t {
+  char magic[8];
+  unsigned int version;
+  unsigned int byte_order_mark;
+  unsigned int real_size;
+  unsigned int triangulate;
+  unsigned int split_indices;
+  unsigned int narrow_indices;
+  file_stamp_t obj;
+  // The same .obj names other .mtl files under another base directory.
+  std::string mtl_basedir;
+  std::vector<std::string> mtl_filenames;
+  std::vector<file_stamp_t> mtls;
+};
 
-    // PBR: sheen
-    if (token[0] == 'P' && token[1] == 's' && IS_SPACE(token[2])) {
-      token += 2;
-      material.sheen = parseReal(&token);
-      continue;
-    }
+static void initObjCacheHeader(obj_cache_header_t *header,
+                               const file_stamp_t &obj_stamp,
+                               const std::string &mtl_basedir,
+                               const std::vector<std::string> &mtl_filenames,
+                               const load_option_t &option) {
+  memcpy(header->magic, kObjCacheMagic, sizeof(kObjCacheMagic));
+  header->version = kObjCacheVersion;
+  header->byte_order_mark = kObjCacheByteOrderMark;
+  header->real_size = sizeof(real_t);
+  header->triangulate = option.triangulate ? 1 : 0;
+  header->split_indices = option.split_indices ? 1 : 0;
+  header->narrow_indices = option.narrow_indices ? 1 : 0;
+  header->obj = obj_stamp;
+  header->mtl_basedir = mtl_basedir;
+  header->mtl_filenames = mtl_filenames;
+  header->mtls.clear();
+  for (size_t i = 0; i < mtl_filenames.size(); i++) {
+    header->mtls.push_back(stampFile(mtl_filenames[i]));
+  }
+}
 
-    // PBR: clearcoat thickness
-    if (token[0] == 'P' && token[1] == 'c' && IS_SPACE(token[2])) {
-      token += 2;
-      material.clearcoat_thickness = parseReal(&token);
-      continue;
-    }
+class ObjCacheWriter {
+ public:
+  explicit ObjCacheWriter(std::ostream *os) : m_os(os), m_pos(0) {}
 
-    // PBR: clearcoat roughness
-    if ((0 == strncmp(token, "Pcr", 3)) && IS_SPACE(token[3])) {
-      token += 4;
-      material.clearcoat_roughness = parseReal(&token);
-      continue;
+  void bytes(void *p, size_t len) {
+    m_os->write(static_cast<const char *>(p),
+                static_cast<std::streamsize>(len));
+    m_pos += len;
+  }
+  template <typename T>
+  void pod(T *v) {
+    bytes(v, sizeof(T));
+  }
+  void count(size_t *n) {
+    unsigned long long v = *n;
+    pod(&v);
+  }
+  void str(std::string *s) {
+    size_t n = s->size();
+    count(&n);
+    bytes(const_cast<char *>(s->data()), n);
+  }
+  template <typename T>
+  void array(std::vector<T> *v) {
+    static const char kZeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    size_t n = v->size();
+    count(&n);
+    bytes(const_cast<char *>(kZeros), (8 - (m_pos % 8)) % 8);
+    if (n > 0) {
+      bytes(&v->at(0), n * sizeof(T));
     }
+  }
 
-    // PBR: anisotropy
-    if ((0 == strncmp(token, "aniso", 5)) && IS_SPACE(token[5])) {
-      token += 6;
-      material.anisotropy = parseReal(&token);
-      continue;
-    }
+ private:
+  std::ostream *m_os;
+  size_t m_pos;
+};
 
-    // PBR: anisotropy rotation
-    if ((0 == strncmp(token, "anisor", 6)) && IS_SPACE(token[6])) {
-      token += 7;
-      material.anisotropy_rotation = parseReal(&token);
-      continue;
-    }
+// Reads what ObjCacheWriter wrote. Reading past the end or a count larger
+// than the rest of the data fails ok().
+class ObjCacheReader {
+ public:
+  ObjCacheReader(const char *data, size_t len)
+      : m_begin(data), m_cur(data), m_end(data + len), m_ok(true) {}
 
-    // ambient texture
-    if ((0 == strncmp(token, "map_Ka", 6)) && IS_SPACE(token[6])) {
-      token += 7;
-      ParseTextureNameAndOption(&(material.ambient_texname),
-                                &(material.ambient_texopt), token,
-                                /* is_bump */ false);
-      continue;
-    }
+  bool ok() const { return m_ok; }
+  bool atEnd() const { return m_cur == m_end; }
 
-    // diffuse texture
-    if ((0 == strncmp(token, "map_Kd", 6)) && IS_SPACE(token[6])) {
-      token += 7;
-      ParseTextureNameAndOption(&(material.diffuse_texname),
-                                &(material.diffuse_texopt), token,
-                                /* is_bump */ false);
-      continue;
+  void bytes(void *p, size_t len) {
+    if (!m_ok || (len > left())) {
+      m_ok = false;
+      return;
     }
-
-    // specular texture
-    if ((0 == strncmp(token, "map_Ks", 6)) && IS_SPACE(token[6])) {
-      token += 7;
-      ParseTextureNameAndOption(&(material.specular_texname),
-                                &(material.specular_texopt), token,
-                                /* is_bump */ false);
-      continue;
+    if (len > 0) {
+      memcpy(p, m_cur, len);
     }
-
-    // specular highlight texture
-    if ((0 == strncmp(token, "map_Ns", 6)) && IS_SPACE(token[6])) {
-      token += 7;
-      ParseTextureNameAndOption(&(material.specular_highlight_texname),
-                                &(material.specular_highlight_texopt), token,
-                                /* is_bump */ false);
-      continue;
+    m_cur += len;
+  }
+  template <typename T>
+  void pod(T *v) {
+    bytes(v, sizeof(T));
+  }
+  // Every counted element takes at least one byte.
+  void count(size_t *n) {
+    unsigned long long v = 0;
+    pod(&v);
+    if (!m_ok || (v > left())) {
+      m_ok = false;
+      v = 0;
     }
-
-    // bump texture
-    if ((0 == strncmp(token, "map_bump", 8)) && IS_SPACE(token[8])) {
-      token += 9;
-      ParseTextureNameAndOption(&(material.bump_texname),
-                                &(material.bump_texopt), token,
-                                /* is_bump */ true);
-      continue;
+    *n = static_cast<size_t>(v);
+  }
+  void str(std::string *s) {
+    size_t n;
+    count(&n);
+    s->assign(m_cur, n);
+    m_cur += n;
+  }
+  template <typename T>
+  void array(std::vector<T> *v) {
+    unsigned long long n = 0;
+    pod(&n);
+    size_t pad = (8 - (static_cast<size_t>(m_cur - m_begin) % 8)) % 8;
+    if (!m_ok || (pad > left()) || (n > (left() - pad) / sizeof(T))) {
+      m_ok = false;
+      v->clear();
+      return;
     }
-
-    // bump texture
-    if ((0 == strncmp(token, "map_Bump", 8)) && IS_SPACE(token[8])) {
-      token += 9;
-      ParseTextureNameAndOption(&(material.bump_texname),
-                                &(material.bump_texopt), token,
-                                /* is_bump */ true);
-      continue;
+    m_cur += pad;
+    v->resize(static_cast<size_t>(n));
+    if (n > 0) {
+      memcpy(&v->at(0), m_cur, v->size() * sizeof(T));
     }
+    m_cur += v->size() * sizeof(T);
+  }
 
-    // bump texture
-    if ((0 == strncmp(token, "bump", 4)) && IS_SPACE(token[4])) {
-      token += 5;
-      ParseTextureNameAndOption(&(material.bump_texname),
-                                &(material.bump_texopt), token,
-                                /* is_bump */ true);
-      continue;
-    }
+ private:
+  size_t left() const { return static_cast<size_t>(m_end - m_cur); }
 
-    // alpha texture
-    if ((0 == strncmp(token, "map_d", 5)) && IS_SPACE(token[5])) {
-      token += 6;
-      material.alpha_texname = token;
-      ParseTextureNameAndOption(&(material.alpha_texname),
-                                &(material.alpha_texopt), token,
-                                /* is_bump */ false);
-      continue;
-    }
+  const char *m_begin;
+  const char *m_cur;
+  const char *m_end;
+  bool m_ok;
+};
 
-    // displacement texture
-    if ((0 == strncmp(token, "disp", 4)) && IS_SPACE(token[4])) {
-      token += 5;
-      ParseTextureNameAndOption(&(material.displacement_texname),
-                                &(material.displacement_texopt), token,
-                                /* is_bump */ false);
-      continue;
-    }
+// The serialize*() functions below write the data with an ObjCacheWriter
+// and read it back with an ObjCacheReader.
+
+template <typename Archive>
+static void serializeFileStamp(Archive *ar, file_stamp_t *stamp) {
+  unsigned int exists = stamp->exists ? 1 : 0;
+  ar->pod(&exists);
+  stamp->exists = (exists != 0);
+  ar->pod(&stamp->size);
+  ar->pod(&stamp->mtime_sec);
+  ar->pod(&stamp->mtime_nsec);
+  ar->pod(&stamp->hash);
+}
 
-    // reflection map
-    if ((0 == strncmp(token, "refl", 4)) && IS_SPACE(token[4])) {
-      token += 5;
-      ParseTextureNameAndOption(&(material.reflection_texname),
-                                &(material.reflection_texopt), token,
-                                /* is_bump */ false);
-      continue;
-    }
+template <typename Archive>
+static void serializeObjCacheHeader(Archive *ar, obj_cache_header_t *header) {
+  ar->bytes(header->magic, sizeof(header->magic));
+  ar->pod(&header->version);
+  ar->pod(&header->byte_order_mark);
+  ar->pod(&header->real_size);
+  ar->pod(&header->triangulate);
+  ar->pod(&header->split_indices);
+  ar->pod(&header->narrow_indices);
+  serializeFileStamp(ar, &header->obj);
+  ar->str(&header->mtl_basedir);
+  size_t n = header->mtl_filenames.size();
+  ar->count(&n);
+  header->mtl_filenames.resize(n);
+  header->mtls.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    ar->str(&header->mtl_filenames[i]);
+    serializeFileStamp(ar, &header->mtls[i]);
+  }
+}
 
-    // PBR: roughness texture
-    if ((0 == strncmp(token, "map_Pr", 6)) && IS_SPACE(token[6])) {
-      token += 7;
-      ParseTextureNameAndOption(&(material.roughness_texname),
-                                &(material.roughness_texopt), token,
-                                /* is_bump */ false);
-      continue;
-    }
+template <typename Archive>
+static void serializeTextureOption(Archive *ar, texture_option_t *opt) {
+  ar->pod(&opt->type);
+  ar->pod(&opt->sharpness);
+  ar->pod(&opt->brightness);
+  ar->pod(&opt->contrast);
+  ar->pod(&opt->origin_offset);
+  ar->pod(&opt->scale);
+  ar->pod(&opt->turbulence);
+  ar->pod(&opt->clamp);
+  ar->pod(&opt->imfchan);
+  ar->pod(&opt->blendu);
+  ar->pod(&opt->blendv);
+  ar->pod(&opt->bump_multiplier);
+}
 
-    // PBR: metallic texture
-    if ((0 == strncmp(token, "map_Pm", 6)) && IS_SPACE(token[6])) {
-      token += 7;
-      ParseTextureNameAndOption(&(material.metallic_texname),
-                                &(material.metallic_texopt), token,
-                                /* is_bump */ false);
-      continue;
-    }
+template <typename Archive>
+static void serializeMaterial(Archive *ar, material_t *m) {
+  ar->str(&m->name);
+  ar->pod(&m->ambient);
+  ar->pod(&m->diffuse);
+  ar->pod(&m->specular);
+  ar->pod(&m->transmittance);
+  ar->pod(&m->emission);
+  ar->pod(&m->shininess);
+  ar->pod(&m->ior);
+  ar->pod(&m->dissolve);
+  ar->pod(&m->illum);
+  ar->pod(&m->dummy);
+
+  ar->str(&m->ambient_texname);
+  ar->str(&m->diffuse_texname);
+  ar->str(&m->specular_texname);
+  ar->str(&m->specular_highlight_texname);
+  ar->str(&m->bump_texname);
+  ar->str(&m->displacement_texname);
+  ar->str(&m->alpha_texname);
+  ar->str(&m->reflection_texname);
+
+  serializeTextureOption(ar, &m->ambient_texopt);
+  serializeTextureOption(ar, &m->diffuse_texopt);
+  serializeTextureOption(ar, &m->specular_texopt);
+  serializeTextureOption(ar, &m->specular_highlight_texopt);
+  serializeTextureOption(ar, &m->bump_texopt);
+  serializeTextureOption(ar, &m->displacement_texopt);
+  serializeTextureOption(ar, &m->alpha_texopt);
+  serializeTextureOption(ar, &m->reflection_texopt);
+
+  ar->pod(&m->roughness);
+  ar->pod(&m->metallic);
+  ar->pod(&m->sheen);
+  ar->pod(&m->clearcoat_thickness);
+  ar->pod(&m->clearcoat_roughness);
+  ar->pod(&m->anisotropy);
+  ar->pod(&m->anisotropy_rotation);
+  ar->pod(&m->pad0);
+  ar->str(&m->roughness_texname);
+  ar->str(&m->metallic_texname);
+  ar->str(&m->sheen_texname);
+  ar->str(&m->emissive_texname);
+  ar->str(&m->normal_texname);
+
+  serializeTextureOption(ar, &m->roughness_texopt);
+  serializeTextureOption(ar, &m->metallic_texopt);
+  serializeTextureOption(ar, &m->sheen_texopt);
+  serializeTextureOption(ar, &m->emissive_texopt);
+  serializeTextureOption(ar, &m->normal_texopt);
+
+  ar->pod(&m->pad2);
+
+  // Written in key order, so reading inserts at the end of the map.
+  size_t n = m->unknown_parameter.size();
+  ar->count(&n);
+  std::map<std::string, std::string>::iterator it =
+      m->unknown_parameter.begin();
+  for (size_t i = 0; i < n; i++) {
+    std::string key = (it != m->unknown_parameter.end()) ? it->first : "";
+    std::string value = (it != m->unknown_parameter.end()) ? it->second : "";
+    ar->str(&key);
+    ar->str(&value);
+    it = m->unknown_parameter.insert(it, std::make_pair(key, value));
+    ++it;
+  }
+}
 
-    // PBR: sheen texture
-    if ((0 == strncmp(token, "map_Ps", 6)) && IS_SPACE(token[6])) {
-      token += 7;
-      ParseTextureNameAndOption(&(material.sheen_texname),
-                                &(material.sheen_texopt), token,
-                                /* is_bump */ false);
-      continue;
+template <typename Archive>
+static void serializeShape(Archive *ar, shape_t *shape) {
+  ar->str(&shape->name);
+  mesh_t &mesh = shape->mesh;
+  ar->array(&mesh.indices);
+  ar->array(&mesh.vertex_indices);
+  ar->array(&mesh.normal_indices);
+  ar->array(&mesh.texcoord_indices);
+  ar->array(&mesh.vertex_indices16);
+  ar->array(&mesh.normal_indices16);
+  ar->array(&mesh.texcoord_indices16);
+  ar->array(&mesh.num_face_vertices);
+  ar->array(&mesh.material_ids);
+  ar->array(&mesh.smoothing_group_ids);
+  size_t n = mesh.tags.size();
+  ar->count(&n);
+  mesh.tags.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    tag_t &tag = mesh.tags[i];
+    ar->str(&tag.name);
+    ar->array(&tag.intValues);
+    ar->array(&tag.floatValues);
+    size_t num_strings = tag.stringValues.size();
+    ar->count(&num_strings);
+    tag.stringValues.resize(num_strings);
+    for (size_t j = 0; j < num_strings; j++) {
+      ar->str(&tag.stringValues[j]);
     }
+  }
+}
 
-    // PBR: emissive texture
-    if ((0 == strncmp(token, "map_Ke", 6)) && IS_SPACE(token[6])) {
-      token += 7;
-      ParseTextureNameAndOption(&(material.emissive_texname),
-                                &(material.emissive_texopt), token,
-                                /* is_bump */ false);
-      continue;
-    }
+template <typename Archive>
+static void serializeObj(Archive *ar, attrib_t *attrib,
+                         std::vector<shape_t> *shapes,
+                         std::vector<material_t> *materials) {
+  ar->array(&attrib->vertices);
+  ar->array(&attrib->normals);
+  ar->array(&attrib->texcoords);
+  ar->array(&attrib->colors);
+  ar->pod(&attrib->has_colors);
+
+  size_t n = shapes->size();
+  ar->count(&n);
+  shapes->resize(n);
+  for (size_t i = 0; i < n; i++) {
+    serializeShape(ar, &(*shapes)[i]);
+  }
 
-    // PBR: normal map texture
-    if ((0 == strncmp(token, "norm", 4)) && IS_SPACE(token[4])) {
-      token += 5;
-      ParseTextureNameAndOption(
-          &(material.normal_texname), &(material.normal_texopt), token,
-          /* is_bump */ false);  // @fixme { is_bump will be true? }
-      continue;
-    }
+  n = materials->size();
+  ar->count(&n);
+  materials->resize(n);
+  for (size_t i = 0; i < n; i++) {
+    serializeMaterial(ar, &(*materials)[i]);
+  }
+}
 
-    // unknown parameter
-    const char *_space = strchr(token, ' ');
-    if (!_space) {
-      _space = strchr(token, '\t');
-    }
-    if (_space) {
-      std::ptrdiff_t len = _space - token;
-      std::string key(token, static_cast<size_t>(len));
-      std::string value = _space + 1;
-      material.unknown_parameter.insert(
-          std::pair<std::string, std::string>(key, value));
+// Loads `cache_filename` when it is valid for `obj_stamp`, `mtl_basedir` and
+// `option`. `materials` is appended to like LoadObj() does.
+static bool loadObjCache(attrib_t *attrib, std::vector<shape_t> *shapes,
+                         std::vector<material_t> *materials,
+                         const char *cache_filename,
+                         const file_stamp_t &obj_stamp,
+                         const std::string &mtl_basedir,
+                         const load_option_t &option) {
+  MappedFile file;
+  if (!file.open(cache_filename)) {
+    return false;
+  }
+  ObjCacheReader ar(file.data(), file.size());
+
+  obj_cache_header_t header;
+  serializeObjCacheHeader(&ar, &header);
+  obj_cache_header_t expected;
+  initObjCacheHeader(&expected, obj_stamp, mtl_basedir, header.mtl_filenames,
+                     option);
+  if (!ar.ok() ||
+      (memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0) ||
+      (header.version != expected.version) ||
+      (header.byte_order_mark != expected.byte_order_mark) ||
+      (header.real_size != expected.real_size) ||
+      (header.triangulate != expected.triangulate) ||
+      (header.split_indices != expected.split_indices) ||
+      (header.narrow_indices != expected.narrow_indices) ||
+      !sameStamp(header.obj, expected.obj) ||
+      (header.mtl_basedir != expected.mtl_basedir)) {
+    return false;
+  }
+  for (size_t i = 0; i < header.mtls.size(); i++) {
+    if (!sameStamp(header.mtls[i], expected.mtls[i])) {
+      return false;
     }
   }
-  // flush last material.
-  material_map->insert(std::pair<std::string, int>(
-      material.name, static_cast<int>(materials->size())));
-  materials->push_back(material);
 
-  if (warning) {
-    (*warning) = ss.str();
+  attrib_t cached_attrib;
+  std::vector<shape_t> cached_shapes;
+  std::vector<material_t> cached_materials;
+  serializeObj(&ar, &cached_attrib, &cached_shapes, &cached_materials);
+  if (!ar.ok() || !ar.atEnd()) {
+    return false;
   }
-}
 
-bool MaterialFileReader::operator()(const std::string &matId,
-                                    std::vector<material_t> *materials,
-                                    std::map<std::string, int> *matMap,
-                                    std::string *err) {
-  std::string filepath;
-
-  if (!m_mtlBaseDir.empty()) {
-    filepath = std::string(m_mtlBaseDir) + matId;
+  attrib->vertices.swap(cached_attrib.vertices);
+  attrib->normals.swap(cached_attrib.normals);
+  attrib->texcoords.swap(cached_attrib.texcoords);
+  attrib->colors.swap(cached_attrib.colors);
+  attrib->has_colors = cached_attrib.has_colors;
+  shapes->swap(cached_shapes);
+  if (materials->empty()) {
+    materials->swap(cached_materials);
   } else {
-    filepath = matId;
+    materials->insert(materials->end(), cached_materials.begin(),
+                      cached_materials.end());
   }
+  return true;
+}
 
-  std::ifstream matIStream(filepath.c_str());
-  if (!matIStream) {
-    std::stringstream ss;
-    ss << "WARN: Material file [ " << filepath << " ] not found." << std::endl;
-    if (err) {
-      (*err) += ss.str();
+// Writes the data loaded from the .obj of `obj_stamp` and the .mtl files
+// `mtl_filenames` under `mtl_basedir` to `cache_filename`. Materials before
+// `first_material` were not loaded by it.
+static bool saveObjCache(const char *cache_filename,
+                         const file_stamp_t &obj_stamp,
+                         const std::string &mtl_basedir,
+                         const std::vector<std::string> &mtl_filenames,
+                         const attrib_t &attrib,
+                         const std::vector<shape_t> &shapes,
+                         const std::vector<material_t> &materials,
+                         size_t first_material, const load_option_t &option) {
+  // Written next to the cache and renamed, so that a concurrent LoadObj()
+  // never sees a partial file.
+  std::string tmp_filename = std::string(cache_filename) + ".tmp";
+  {
+    std::ofstream ofs(tmp_filename.c_str(),
+                      std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+      return false;
+    }
+    ObjCacheWriter ar(&ofs);
+
+    obj_cache_header_t header;
+    initObjCacheHeader(&header, obj_stamp, mtl_basedir, mtl_filenames,
+                       option);
+    serializeObjCacheHeader(&ar, &header);
+
+    // The writer only reads through these pointers.
+    std::vector<material_t> loaded_materials(
+        materials.begin() + static_cast<std::ptrdiff_t>(first_material),
+        materials.end());
+    serializeObj(&ar, const_cast<attrib_t *>(&attrib),
+                 const_cast<std::vector<shape_t> *>(&shapes),
+                 &loaded_materials);
+
+    ofs.flush();
+    if (!ofs) {
+      ofs.close();
+      std::remove(tmp_filename.c_str());
+      return false;
     }
-    return false;
   }
 
-  std::string warning;
-  LoadMtl(matMap, materials, &matIStream, &warning);
+  std::remove(cache_filename);  // rename() does not replace on Windows.
+  if (std::rename(tmp_filename.c_str(), cache_filename) != 0) {
+    std::remove(tmp_filename.c_str());
+    return false;
+  }
+  return true;
+}
 
-  if (!warning.empty()) {
-    if (err) {
-      (*err) += warning;
-    }
+// Passes .mtl loading on to `reader`(a MaterialFileReader for
+// `mtl_basedir`) and records the files it reads for the cache.
+class MaterialFileRecorder : public MaterialReader {
+ public:
+  MaterialFileRecorder(MaterialReader *reader, const std::string &mtl_basedir)
+      : m_reader(reader), m_mtlBaseDir(mtl_basedir) {}
+  virtual ~MaterialFileRecorder() {}
+  virtual bool operator()(const std::string &matId,
+                          std::vector<material_t> *materials,
+                          std::map<std::string, int> *matMap,
+                          std::string *err) {
+    m_filenames.push_back(m_mtlBaseDir + matId);
+#ifdef TINYOBJLOADER_USE_ZLIB
+    m_filenames.push_back(m_mtlBaseDir + matId + ".gz");
+#endif
+    return (*m_reader)(matId, materials, matMap, err);
   }
 
-  return true;
-}
+  const std::vector<std::string> &filenames() const { return m_filenames; }
+
+ private:
+  MaterialReader *m_reader;
+  std::string m_mtlBaseDir;
+  std::vector<std::string> m_filenames;
+};
+
+bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
+             std::vector<material_t> *materials, std::string *err,
+             const char *filename, const char *mtl_basedir, bool trianglulate) {
+  load_option_t option;
+  option.triangulate = trianglulate;
+  return LoadObj(attrib, shapes, materials, err, filename, mtl_basedir,
+                 option);
+}
+
+static size_t numParseThreads(size_t len, int num_threads);
+static bool loadObjFromBuffer(attrib_t *attrib, std::vector<shape_t> *shapes,
+                              std::vector<material_t> *materials,
+                              std::string *err, const char *data, size_t len,
+                              MaterialReader *readMatFn,
+                              const load_option_t &option,
+                              const ReadProgress *progress,
+                              const scratch_allocator_t &alloc);
+#ifdef TINYOBJLOADER_USE_ZLIB
+static bool loadGzipObj(attrib_t *attrib, std::vector<shape_t> *shapes,
+                        std::vector<material_t> *materials, std::string *err,
+                        const char *data, size_t len, MaterialReader *readMatFn,
+                        const load_option_t &option,
+                        const scratch_allocator_t &alloc);
+#endif
+
+// LoadObj(filename) without the cache.
+static bool loadObjFile(attrib_t *attrib, std::vector<shape_t> *shapes,
+                        std::vector<material_t> *materials, std::string *err,
+                        const char *filename, MaterialReader *readMatFn,
+                        const load_option_t &option,
+                        const scratch_allocator_t &alloc) {
+  std::stringstream errss;
 
-bool MaterialStreamReader::operator()(const std::string &matId,
-                                      std::vector<material_t> *materials,
-                                      std::map<std::string, int> *matMap,
-                                      std::string *err) {
-  (void)matId;
-  if (!m_inStream) {
-    std::stringstream ss;
-    ss << "WARN: Material stream in error state. " << std::endl;
+  MappedFile file;
+  if (!file.open(filename)) {
+    errss << "Cannot open file [" << filename << "]" << std::endl;
     if (err) {
-      (*err) += ss.str();
+      (*err) = errss.str();
     }
     return false;
   }
 
-  std::string warning;
-  LoadMtl(matMap, materials, &m_inStream, &warning);
+#ifdef TINYOBJLOADER_USE_ZLIB
+  if (isGzip(file.data(), file.size())) {
+    return loadGzipObj(attrib, shapes, materials, err, file.data(),
+                       file.size(), readMatFn, option, alloc);
+  }
+#endif
 
-  if (!warning.empty()) {
-    if (err) {
-      (*err) += warning;
-    }
+#ifdef TINYOBJLOADER_USE_READ_AHEAD
+  if (file.mapped()) {
+    // Parse while the file is being read in.
+    MappedFileReadAhead ahead(file.data(), file.size());
+    ahead.start(numParseThreads(file.size(), option.num_threads));
+    return loadObjFromBuffer(attrib, shapes, materials, err, file.data(),
+                             file.size(), readMatFn, option, &ahead, alloc);
   }
+#endif
 
-  return true;
+  return loadObjFromBuffer(attrib, shapes, materials, err, file.data(),
+                           file.size(), readMatFn, option, NULL, alloc);
 }
 
-bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
-             std::vector<material_t> *materials, std::string *err,
-             const char *filename, const char *mtl_basedir, bool trianglulate) {
+static bool loadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
+                    std::vector<material_t> *materials, std::string *err,
+                    const char *filename, const char *mtl_basedir,
+                    const load_option_t &option,
+                    const scratch_allocator_t &alloc) {
   attrib->vertices.clear();
   attrib->normals.clear();
   attrib->texcoords.clear();
   attrib->colors.clear();
+  attrib->has_colors = false;
   shapes->clear();
 
-  std::stringstream errss;
+  std::string baseDir;
+  if (mtl_basedir) {
+    baseDir = mtl_basedir;
+  }
+  MaterialFileReader matFileReader(baseDir, option.cache_materials);
 
-  std::ifstream ifs(filename);
-  if (!ifs) {
-    errss << "Cannot open file [" << filename << "]" << std::endl;
+  if (!option.cache_filename) {
+    return loadObjFile(attrib, shapes, materials, err, filename,
+                       &matFileReader, option, alloc);
+  }
+
+  file_stamp_t obj_stamp = stampFile(filename);
+  if (obj_stamp.exists && loadObjCache(attrib, shapes, materials,
+                                       option.cache_filename, obj_stamp,
+                                       baseDir, option)) {
+    return true;
+  }
+
+  size_t num_materials = materials->size();
+  MaterialFileRecorder matFileRecorder(&matFileReader, baseDir);
+  if (!loadObjFile(attrib, shapes, materials, err, filename, &matFileRecorder,
+                   option, alloc)) {
+    return false;
+  }
+  if (!saveObjCache(option.cache_filename, obj_stamp, baseDir,
+                    matFileRecorder.filenames(), *attrib, *shapes, *materials,
+                    num_materials, option)) {
+    std::stringstream ss;
+    ss << "WARN: Cannot write cache file [ " << option.cache_filename << " ]."
+       << std::endl;
     if (err) {
-      (*err) = errss.str();
+      (*err) += ss.str();
     }
-    return false;
   }
+  return true;
+}
 
-  std::string baseDir;
-  if (mtl_basedir) {
-    baseDir = mtl_basedir;
-  }
-  MaterialFileReader matFileReader(baseDir);
+bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
+             std::vector<material_t> *materials, std::string *err,
+             const char *filename, const char *mtl_basedir,
+             const load_option_t &option) {
+  return loadObj(attrib, shapes, materials, err, filename, mtl_basedir, option,
+                 scratch_allocator_t());
+}
 
-  return LoadObj(attrib, shapes, materials, err, &ifs, &matFileReader,
-                 trianglulate);
+#ifdef TINYOBJLOADER_USE_PMR
+bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
+             std::vector<material_t> *materials, std::string *err,
+             const char *filename, const char *mtl_basedir,
+             const load_option_t &option,
+             std::pmr::memory_resource *resource) {
+  return loadObj(attrib, shapes, materials, err, filename, mtl_basedir, option,
+                 scratch_allocator_t(resource ? resource
+                                              : std::pmr::get_default_resource()));
 }
+#endif
 
 bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
              std::vector<material_t> *materials, std::string *err,
              std::istream *inStream, MaterialReader *readMatFn /*= NULL*/,
              bool triangulate) {
-  std::stringstream errss;
+  load_option_t option;
+  option.triangulate = triangulate;
+  return LoadObj(attrib, shapes, materials, err, inStream, readMatFn, option);
+}
+
+bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
+             std::vector<material_t> *materials, std::string *err,
+             std::istream *inStream, MaterialReader *readMatFn,
+             const load_option_t &option) {
+  std::vector<char> buf;
+  ReadStreamToBuffer(*inStream, &buf);
+
+  return LoadObjFromMemory(attrib, shapes, materials, err,
+                           buf.empty() ? NULL : &buf.at(0), buf.size(),
+                           readMatFn, option);
+}
+
+enum command_type_t {
+  COMMAND_USEMTL,
+  COMMAND_MTLLIB,
+  COMMAND_GROUP,
+  COMMAND_OBJECT,
+  COMMAND_TAG
+};
+
+// `usemtl`, `mtllib`, `g`, `o` or `t` line.
+// These change the grouping state and are replayed in file order after all
+// chunks have been parsed.
+struct obj_command_t {
+  command_type_t type;
+  size_t face_offset;  // # of faces in the chunk preceding this command.
+  std::string str;     // material name, mtllib arguments or group/object name.
+  tag_t tag;
+};
+
+// Parse result of a range of whole lines of an .obj.
+// Large inputs are split into several chunks which are parsed concurrently.
+struct obj_chunk_t {
+  const char *begin;
+  const char *end;
+  const ReadProgress *progress;  // Set while the input is still being read.
+
+  // # of `v`, `vn`, `vt` and `f` lines and face vertex indices in this chunk.
+  size_t num_v;
+  size_t num_vn;
+  size_t num_vt;
+  size_t num_f;
+  size_t num_face_indices;
+
+  // # of `v`, `vn`, `vt` lines and faces in all preceding chunks.
+  // The former are needed to resolve relative(negative) face indices.
+  size_t v_base;
+  size_t vn_base;
+  size_t vt_base;
+  size_t face_base;
+  size_t face_index_base;
 
   std::vector<real_t> v;
   std::vector<real_t> vn;
   std::vector<real_t> vt;
-  std::vector<real_t> vc;
+  std::vector<real_t> vc;  // Empty until a `v` line with a color is seen.
+  face_vector_t faces;
+  vertex_index_vector_t face_indices;
+  scratch_vector<obj_command_t>::type commands;
+  bool has_colors;
+
+  // When the whole-file arrays are sized in advance, attributes and faces
+  // are written to them at these positions instead of being appended to
+  // the vectors above.
+  real_t *v_out;
+  real_t *vn_out;
+  real_t *vt_out;
+  face_t *faces_out;
+  vertex_index_t *face_indices_out;
+
+  // Faces before the first `s` line continue the smoothing group of the
+  // preceding chunk(`initial_smoothing_id`).
+  size_t num_leading_faces;
+  bool has_smoothing_group;
+  unsigned int last_smoothing_id;
+  unsigned int initial_smoothing_id;
+
+  bool failed;  // Parsing stopped at an invalid `f` line.
+
+  explicit obj_chunk_t(const scratch_allocator_t &alloc = scratch_allocator_t())
+      : begin(NULL),
+        end(NULL),
+        progress(NULL),
+        num_v(0),
+        num_vn(0),
+        num_vt(0),
+        num_f(0),
+        num_face_indices(0),
+        v_base(0),
+        vn_base(0),
+        vt_base(0),
+        face_base(0),
+        face_index_base(0),
+        faces(alloc),
+        face_indices(alloc),
+        commands(alloc),
+        has_colors(false),
+        v_out(NULL),
+        vn_out(NULL),
+        vt_out(NULL),
+        faces_out(NULL),
+        face_indices_out(NULL),
+        num_leading_faces(0),
+        has_smoothing_group(false),
+        last_smoothing_id(0),
+        initial_smoothing_id(0),
+        failed(false) {}
+};
+
+// Swaps `a` and `b` without copying their arrays(std::swap() copies before
+// C++11).
+static void swapShape(shape_t *a, shape_t *b) {
+  a->name.swap(b->name);
+  a->mesh.indices.swap(b->mesh.indices);
+  a->mesh.vertex_indices.swap(b->mesh.vertex_indices);
+  a->mesh.normal_indices.swap(b->mesh.normal_indices);
+  a->mesh.texcoord_indices.swap(b->mesh.texcoord_indices);
+  a->mesh.vertex_indices16.swap(b->mesh.vertex_indices16);
+  a->mesh.normal_indices16.swap(b->mesh.normal_indices16);
+  a->mesh.texcoord_indices16.swap(b->mesh.texcoord_indices16);
+  a->mesh.num_face_vertices.swap(b->mesh.num_face_vertices);
+  a->mesh.material_ids.swap(b->mesh.material_ids);
+  a->mesh.smoothing_group_ids.swap(b->mesh.smoothing_group_ids);
+  a->mesh.tags.swap(b->mesh.tags);
+}
+
+// Builds shapes from parsed faces by replaying the grouping commands of
+// the parsed chunks(`usemtl`, `mtllib`, `g`, `o` and `t`) in file order.
+struct shape_builder_t {
+  bool triangulate;
+  bool split_indices;
+  MaterialReader *readMatFn;
+  std::vector<material_t> *materials;
+  std::string *err;
+
   std::vector<tag_t> tags;
-  std::vector<face_t> faceGroup;
   std::string name;
 
   // material
   std::map<std::string, int> material_map;
-  int material = -1;
-
-  // smoothing group id
-  unsigned int current_smoothing_id =
-      0;  // Initial value. 0 means no smoothing.
+  int material;
 
   shape_t shape;
-
-  std::string linebuf;
-  while (inStream->peek() != -1) {
-    safeGetline(*inStream, linebuf);
-
-    // Trim newline '\r\n' or '\n'
-    if (linebuf.size() > 0) {
-      if (linebuf[linebuf.size() - 1] == '\n')
-        linebuf.erase(linebuf.size() - 1);
-    }
-    if (linebuf.size() > 0) {
-      if (linebuf[linebuf.size() - 1] == '\r')
-        linebuf.erase(linebuf.size() - 1);
-    }
-
-    // Skip if empty line.
-    if (linebuf.empty()) {
-      continue;
-    }
-
-    // Skip leading space.
-    const char *token = linebuf.c_str();
-    token += strspn(token, " \t");
-
-    assert(token);
-    if (token[0] == '\0') continue;  // empty line
-
-    if (token[0] == '#') continue;  // comment line
-
-    // vertex
-    if (token[0] == 'v' && IS_SPACE((token[1]))) {
-      token += 2;
-      real_t x, y, z;
-      real_t r, g, b;
-      parseVertexWithColor(&x, &y, &z, &r, &g, &b, &token);
-      v.push_back(x);
-      v.push_back(y);
-      v.push_back(z);
-
-      vc.push_back(r);
-      vc.push_back(g);
-      vc.push_back(b);
-      continue;
-    }
-
-    // normal
-    if (token[0] == 'v' && token[1] == 'n' && IS_SPACE((token[2]))) {
-      token += 3;
-      real_t x, y, z;
-      parseReal3(&x, &y, &z, &token);
-      vn.push_back(x);
-      vn.push_back(y);
-      vn.push_back(z);
-      continue;
-    }
-
-    // texcoord
-    if (token[0] == 'v' && token[1] == 't' && IS_SPACE((token[2]))) {
-      token += 3;
-      real_t x, y;
-      parseReal2(&x, &y, &token);
-      vt.push_back(x);
-      vt.push_back(y);
-      continue;
+  size_t group_begin;  // First face of the current face group.
+
+  // Face offsets of the `g` and `o` lines and of the end of the input.
+  // When given, each shape is reserved for all faces up to the next one.
+  const scratch_vector<size_t>::type *shape_ends;
+  size_t shape_index;
+
+  // When given, polygons are not triangulated while the shapes are built;
+  // the jobs to do so are appended here instead(see runTriangulationJobs()).
+  std::vector<triangulation_job_t> *jobs;
+
+  shape_builder_t()
+      : triangulate(true),
+        split_indices(false),
+        readMatFn(NULL),
+        materials(NULL),
+        err(NULL),
+        material(-1),
+        group_begin(0),
+        shape_ends(NULL),
+        shape_index(0),
+        jobs(NULL) {}
+
+  // Starts a new shape at face `face_begin`.
+  void beginShape(const face_vector_t &faces,
+                  const vertex_index_vector_t &face_indices,
+                  size_t face_begin) {
+    if (shape_ends) {
+      reserveMesh(&shape, faces, face_indices, face_begin,
+                  (*shape_ends)[shape_index], triangulate, split_indices);
+      shape_index++;
     }
+  }
 
-    // face
-    if (token[0] == 'f' && IS_SPACE((token[1]))) {
-      token += 2;
-      token += strspn(token, " \t");
-
-      face_t face;
-
-      face.smoothing_group_id = current_smoothing_id;
-      face.vertex_indices.reserve(3);
-
-      while (!IS_NEW_LINE(token[0])) {
-        vertex_index_t vi;
-        if (!parseTriple(&token, static_cast<int>(v.size() / 3),
-                         static_cast<int>(vn.size() / 3),
-                         static_cast<int>(vt.size() / 2), &vi)) {
-          if (err) {
-            (*err) = "Failed parse `f' line(e.g. zero value for face index).\n";
-          }
-          return false;
-        }
-
-        face.vertex_indices.push_back(vi);
-        size_t n = strspn(token, " \t\r");
-        token += n;
+  // Moves `shape` to the end of `shapes`, leaving an empty shape.
+  void emitShape(std::vector<shape_t> *shapes) {
+    if (shapes->size() == shapes->capacity()) {
+      // Grow by swapping, as reallocation copies the shapes before C++11.
+      std::vector<shape_t> grown;
+      grown.reserve(shapes->size() * 2 + 1);
+      grown.resize(shapes->size());
+      for (size_t i = 0; i < shapes->size(); i++) {
+        swapShape(&grown[i], &(*shapes)[i]);
       }
-
-      // replace with emplace_back + std::move on C++11
-      faceGroup.push_back(face);
-
-      continue;
+      shapes->swap(grown);
     }
+    shapes->push_back(shape_t());
+    swapShape(&shapes->back(), &shape);
+  }
 
-    // use mtl
-    if ((0 == strncmp(token, "usemtl", 6)) && IS_SPACE((token[6]))) {
-      token += 7;
-      std::stringstream ss;
-      ss << token;
-      std::string namebuf = ss.str();
+  // Applies `command`, which comes after the first `group_end` faces.
+  // Finished shapes are appended to `shapes`.
+  void replay(const obj_command_t &command, size_t group_end,
+              const face_vector_t &faces,
+              const vertex_index_vector_t &face_indices,
+              const std::vector<real_t> &v, std::vector<shape_t> *shapes) {
+    if (command.type == COMMAND_USEMTL) {
+      const std::string &namebuf = command.str;
 
       int newMaterialId = -1;
-      if (material_map.find(namebuf) != material_map.end()) {
-        newMaterialId = material_map[namebuf];
+      std::map<std::string, int>::const_iterator it =
+          material_map.find(namebuf);
+      if (it != material_map.end()) {
+        newMaterialId = it->second;
       } else {
         // { error!! material not found }
       }
 
       if (newMaterialId != material) {
-        // Create per-face material. Thus we don't add `shape` to `shapes` at
-        // this time.
-        // just clear `faceGroup` after `exportFaceGroupToShape()` call.
-        exportFaceGroupToShape(&shape, faceGroup, tags, material, name,
-                               triangulate, v);
-        faceGroup.clear();
+        // Create per-face material. Thus we don't add `shape` to `shapes`
+        // at this time.
+        // just start a new face group after `exportFaceGroupToShape()`
+        // call.
+        exportFaceGroupToShape(&shape, faces, face_indices, group_begin,
+                               group_end, tags, material, name, triangulate,
+                               split_indices, v, shapes->size(), jobs);
+        group_begin = group_end;
         material = newMaterialId;
       }
-
-      continue;
-    }
-
-    // load mtl
-    if ((0 == strncmp(token, "mtllib", 6)) && IS_SPACE((token[6]))) {
+    } else if (command.type == COMMAND_MTLLIB) {
       if (readMatFn) {
-        token += 7;
-
         std::vector<std::string> filenames;
-        SplitString(std::string(token), ' ', filenames);
+        SplitString(command.str, ' ', filenames);
 
         if (filenames.empty()) {
           if (err) {
@@ -1897,71 +6215,367 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
           }
         }
       }
+    } else if (command.type == COMMAND_GROUP) {
+      // flush previous face group.
+      bool ret = exportFaceGroupToShape(&shape, faces, face_indices,
+                                        group_begin, group_end, tags,
+                                        material, name, triangulate,
+                                        split_indices, v, shapes->size(),
+                                        jobs);
+      (void)ret;  // return value not used.
+
+      if (shape.mesh.num_face_vertices.size() > 0) {
+        emitShape(shapes);
+      }
+
+      shape = shape_t();
+
+      // material = -1;
+      group_begin = group_end;
+
+      name = command.str;
+      beginShape(faces, face_indices, group_begin);
+    } else if (command.type == COMMAND_OBJECT) {
+      // flush previous face group.
+      bool ret = exportFaceGroupToShape(&shape, faces, face_indices,
+                                        group_begin, group_end, tags,
+                                        material, name, triangulate,
+                                        split_indices, v, shapes->size(),
+                                        jobs);
+      // As in finish(), the shape also has faces when `usemtl` came right
+      // before this line. Its triangulation jobs are queued for the index
+      // it is emitted at, so it must not be dropped.
+      if (ret || shape.mesh.num_face_vertices.size()) {
+        emitShape(shapes);
+      }
+
+      // material = -1;
+      group_begin = group_end;
+      shape = shape_t();
+
+      name = command.str;
+      beginShape(faces, face_indices, group_begin);
+    } else if (command.type == COMMAND_TAG) {
+      tags.push_back(command.tag);
+    }
+  }
+
+  // Exports the remaining faces after the last command.
+  void finish(const face_vector_t &faces,
+              const vertex_index_vector_t &face_indices,
+              const std::vector<real_t> &v, std::vector<shape_t> *shapes) {
+    bool ret = exportFaceGroupToShape(&shape, faces, face_indices, group_begin,
+                                      faces.size(), tags, material, name,
+                                      triangulate, split_indices, v,
+                                      shapes->size(), jobs);
+    // exportFaceGroupToShape return false when `usemtl` is called in the last
+    // line.
+    // we also add `shape` to `shapes` when `shape.mesh` has already some
+    // faces(indices)
+    if (ret || shape.mesh.num_face_vertices.size()) {
+      emitShape(shapes);
+    }
+    shape = shape_t();
+    group_begin = faces.size();
+  }
+};
+
+// Minimum input size per thread for `load_option_t::num_threads` = 0.
+static const size_t kMinBytesPerThread = 1024 * 1024;
+
+static size_t numParseThreads(size_t len, int num_threads) {
+#ifdef TINYOBJLOADER_USE_THREADS
+  if (num_threads > 0) {
+    return static_cast<size_t>(num_threads);
+  }
+  size_t n = static_cast<size_t>(std::thread::hardware_concurrency());
+  size_t max_n = len / kMinBytesPerThread;
+  if (n > max_n) {
+    n = max_n;
+  }
+  return (n > 0) ? n : 1;
+#else
+  (void)len;
+  (void)num_threads;
+  return 1;
+#endif
+}
+
+// Splits [data, data + len) into at most `n` chunks of whole lines.
+static void splitObjChunks(const char *data, size_t len, size_t n,
+                           const ReadProgress *progress,
+                           const scratch_allocator_t &alloc,
+                           std::vector<obj_chunk_t> *chunks) {
+  const char *end = data + len;
+  const char *p = data;
+  chunks->clear();
+  chunks->reserve(n);
+  for (size_t i = 1; i <= n; i++) {
+    const char *e = (i == n) ? end : data + (len / n) * i;
+    if (e <= p) {
+      continue;
+    }
+    while (e < end) {
+      const char *ready = progress ? progress->waitFor(e, kReadProgressStep)
+                                   : end;
+      const void *nl = memchr(e, '\n', static_cast<size_t>(ready - e));
+      e = nl ? (static_cast<const char *>(nl) + 1) : ready;
+      if (nl) {
+        break;
+      }
+    }
+#ifdef TINYOBJLOADER_USE_PMR
+    // A copy would take its buffers from the default resource.
+    chunks->emplace_back(alloc);
+#else
+    chunks->push_back(obj_chunk_t(alloc));
+#endif
+    obj_chunk_t &chunk = chunks->back();
+    chunk.begin = p;
+    chunk.end = e;
+    chunk.progress = progress;
+    p = e;
+  }
+}
+
+// # of vertex indices in the rest of an `f` line. Must split the line the
+// same way as parseObjChunk().
+static size_t countFaceIndices(const char *token) {
+  size_t n = 0;
+  token = skipSpace(token);
+  while (!IS_NEW_LINE(token[0])) {
+    n++;
+    token = findTokenEnd(token);
+    token = skipSeparator(token);
+  }
+  return n;
+}
+
+// Counts `v`, `vn` and `vt` lines(and `f` lines and their vertex indices
+// when `count_faces` is set). Must classify lines the same way as
+// parseObjChunk().
+static void countObjChunk(obj_chunk_t *chunk, bool count_faces) {
+  LineReader lines(chunk->begin,
+                   static_cast<size_t>(chunk->end - chunk->begin),
+                   chunk->progress);
+  const char *line;
+  const char *line_end;
+  while (lines.next(&line, &line_end)) {
+    const char *token = skipSpace(line);
+    if (token[0] != 'v') {
+      if (count_faces && (token[0] == 'f') && IS_SPACE(token[1])) {
+        chunk->num_f++;
+        chunk->num_face_indices += countFaceIndices(token + 2);
+      }
+      continue;
+    }
+    if (IS_SPACE(token[1])) {
+      chunk->num_v++;
+    } else if (token[1] == 'n' && IS_SPACE(token[2])) {
+      chunk->num_vn++;
+    } else if (token[1] == 't' && IS_SPACE(token[2])) {
+      chunk->num_vt++;
+    }
+  }
+}
+
+// Stores the `i`th triple at `out`, or appends it to `vec` when `out` is NULL.
+static inline void storeReal3(real_t *out, std::vector<real_t> *vec, size_t i,
+                              real_t x, real_t y, real_t z) {
+  if (out) {
+    out += i * 3;
+    out[0] = x;
+    out[1] = y;
+    out[2] = z;
+  } else {
+    vec->push_back(x);
+    vec->push_back(y);
+    vec->push_back(z);
+  }
+}
+
+static void parseObjChunk(obj_chunk_t *chunk) {
+  // smoothing group id
+  unsigned int current_smoothing_id =
+      0;  // Initial value. 0 means no smoothing.
+
+  // # of attributes, faces and face vertex indices parsed so far.
+  size_t num_v = 0;
+  size_t num_vn = 0;
+  size_t num_vt = 0;
+  size_t num_faces = 0;
+  size_t num_face_indices = 0;
+
+  LineReader lines(chunk->begin,
+                   static_cast<size_t>(chunk->end - chunk->begin),
+                   chunk->progress);
+  const char *line;
+  const char *line_end;
+  while (lines.next(&line, &line_end)) {
+    // Skip if empty line.
+    if (line == line_end) {
+      continue;
+    }
+
+    // Skip leading space.
+    const char *token = line;
+    token = skipSpace(token);
+
+    assert(token);
+    if (IS_NEW_LINE(token[0])) continue;  // empty line
+
+    if (token[0] == '#') continue;  // comment line
+
+    // vertex
+    if (token[0] == 'v' && IS_SPACE((token[1]))) {
+      token += 2;
+      real_t x, y, z;
+      real_t r, g, b;
+      const bool has_color =
+          parseVertexWithColor(&x, &y, &z, &r, &g, &b, &token);
+      storeReal3(chunk->v_out, &chunk->v, num_v, x, y, z);
+      if (has_color && !chunk->has_colors) {
+        // Backfill the vertices before the first color.
+        chunk->vc.assign(num_v * 3, static_cast<real_t>(1.0));
+        chunk->has_colors = true;
+      }
+      if (chunk->has_colors) {
+        chunk->vc.push_back(r);
+        chunk->vc.push_back(g);
+        chunk->vc.push_back(b);
+      }
+      num_v++;
+      continue;
+    }
+
+    // normal
+    if (token[0] == 'v' && token[1] == 'n' && IS_SPACE((token[2]))) {
+      token += 3;
+      real_t x, y, z;
+      parseReal3(&x, &y, &z, &token);
+      storeReal3(chunk->vn_out, &chunk->vn, num_vn, x, y, z);
+      num_vn++;
+      continue;
+    }
+
+    // texcoord
+    if (token[0] == 'v' && token[1] == 't' && IS_SPACE((token[2]))) {
+      token += 3;
+      real_t x, y;
+      parseReal2(&x, &y, &token);
+      if (chunk->vt_out) {
+        chunk->vt_out[num_vt * 2 + 0] = x;
+        chunk->vt_out[num_vt * 2 + 1] = y;
+      } else {
+        chunk->vt.push_back(x);
+        chunk->vt.push_back(y);
+      }
+      num_vt++;
+      continue;
+    }
+
+    // face
+    if (token[0] == 'f' && IS_SPACE((token[1]))) {
+      token += 2;
+      token = skipSpace(token);
+
+      const size_t first_index = num_face_indices;
+
+      while (!IS_NEW_LINE(token[0])) {
+        vertex_index_t vi;
+        if (!parseTriple(&token, static_cast<int>(chunk->v_base + num_v),
+                         static_cast<int>(chunk->vn_base + num_vn),
+                         static_cast<int>(chunk->vt_base + num_vt), &vi)) {
+          chunk->failed = true;
+          break;
+        }
+
+        if (chunk->face_indices_out) {
+          chunk->face_indices_out[num_face_indices] = vi;
+        } else {
+          chunk->face_indices.push_back(vi);
+        }
+        num_face_indices++;
+        token = skipSeparator(token);
+      }
+      if (chunk->failed) {
+        if (!chunk->face_indices_out) {
+          chunk->face_indices.resize(first_index);
+        }
+        num_face_indices = first_index;
+        break;
+      }
+
+      face_t face;
+      face.smoothing_group_id = current_smoothing_id;
+      face.num_vertices =
+          static_cast<unsigned int>(num_face_indices - first_index);
+      face.vertex_offset = chunk->face_index_base + first_index;
+      if (chunk->faces_out) {
+        chunk->faces_out[num_faces] = face;
+      } else {
+        chunk->faces.push_back(face);
+      }
+      num_faces++;
 
       continue;
     }
 
-    // group name
-    if (token[0] == 'g' && IS_SPACE((token[1]))) {
-      // flush previous face group.
-      bool ret = exportFaceGroupToShape(&shape, faceGroup, tags, material, name,
-                                        triangulate, v);
-      (void)ret;  // return value not used.
-
-      if (shape.mesh.indices.size() > 0) {
-        shapes->push_back(shape);
-      }
+    obj_command_t command;
+    command.face_offset = num_faces;
 
-      shape = shape_t();
+    // use mtl
+    if ((0 == strncmp(token, "usemtl", 6)) && IS_SPACE((token[6]))) {
+      token += 7;
+      command.type = COMMAND_USEMTL;
+      command.str.assign(token, line_end);
+      chunk->commands.push_back(command);
+      continue;
+    }
 
-      // material = -1;
-      faceGroup.clear();
+    // load mtl
+    if ((0 == strncmp(token, "mtllib", 6)) && IS_SPACE((token[6]))) {
+      token += 7;
+      command.type = COMMAND_MTLLIB;
+      command.str.assign(token, line_end);
+      chunk->commands.push_back(command);
+      continue;
+    }
 
+    // group name
+    if (token[0] == 'g' && IS_SPACE((token[1]))) {
       std::vector<std::string> names;
       names.reserve(2);
 
       while (!IS_NEW_LINE(token[0])) {
         std::string str = parseString(&token);
         names.push_back(str);
-        token += strspn(token, " \t\r");  // skip tag
+        token = skipSeparator(token);  // skip tag
       }
 
       assert(names.size() > 0);
 
       // names[0] must be 'g', so skip the 0th element.
+      command.type = COMMAND_GROUP;
       if (names.size() > 1) {
-        name = names[1];
-      } else {
-        name = "";
+        command.str = names[1];
       }
-
+      chunk->commands.push_back(command);
       continue;
     }
 
     // object name
     if (token[0] == 'o' && IS_SPACE((token[1]))) {
-      // flush previous face group.
-      bool ret = exportFaceGroupToShape(&shape, faceGroup, tags, material, name,
-                                        triangulate, v);
-      if (ret) {
-        shapes->push_back(shape);
-      }
-
-      // material = -1;
-      faceGroup.clear();
-      shape = shape_t();
-
       // @todo { multiple object name? }
       token += 2;
-      std::stringstream ss;
-      ss << token;
-      name = ss.str();
-
+      command.type = COMMAND_OBJECT;
+      command.str.assign(token, line_end);
+      chunk->commands.push_back(command);
       continue;
     }
 
     if (token[0] == 't' && IS_SPACE(token[1])) {
-      tag_t tag;
+      tag_t &tag = command.tag;
 
       token += 2;
 
@@ -1985,7 +6599,8 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
         tag.stringValues[i] = parseString(&token);
       }
 
-      tags.push_back(tag);
+      command.type = COMMAND_TAG;
+      chunk->commands.push_back(command);
 
       continue;
     }
@@ -1995,19 +6610,17 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
       token += 2;
 
       // skip space.
-      token += strspn(token, " \t");  // skip space
-
-      if (token[0] == '\0') {
-        continue;
-      }
+      token = skipSpace(token);  // skip space
 
-      if (token[0] == '\r' || token[1] == '\n') {
+      if (IS_NEW_LINE(token[0])) {
         continue;
       }
 
-      if (strlen(token) >= 3) {
+      if (line_end - token >= 3) {
         if (token[0] == 'o' && token[1] == 'f' && token[2] == 'f') {
           current_smoothing_id = 0;
+        } else {
+          continue;
         }
       } else {
         // assume number
@@ -2021,22 +6634,428 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
         }
       }
 
+      if (!chunk->has_smoothing_group) {
+        chunk->has_smoothing_group = true;
+        chunk->num_leading_faces = num_faces;
+      }
+
       continue;
     }  // smoothing group id
 
     // Ignore unknown command.
   }
 
-  bool ret = exportFaceGroupToShape(&shape, faceGroup, tags, material, name,
-                                    triangulate, v);
-  // exportFaceGroupToShape return false when `usemtl` is called in the last
-  // line.
-  // we also add `shape` to `shapes` when `shape.mesh` has already some
-  // faces(indices)
-  if (ret || shape.mesh.indices.size()) {
-    shapes->push_back(shape);
+  if (!chunk->has_smoothing_group) {
+    chunk->num_leading_faces = num_faces;
+  }
+  chunk->last_smoothing_id = current_smoothing_id;
+  chunk->num_v = num_v;
+  chunk->num_vn = num_vn;
+  chunk->num_vt = num_vt;
+  chunk->num_f = num_faces;
+  chunk->num_face_indices = num_face_indices;
+}
+
+// Moves the colors and faces of a parsed chunk into their place in the
+// whole-file arrays and fixes up the smoothing group of the faces before its
+// first `s` line.
+static void mergeObjChunk(obj_chunk_t *chunk, std::vector<real_t> *colors,
+                          face_vector_t *faces,
+                          vertex_index_vector_t *face_indices) {
+  if (chunk->has_colors) {
+    std::copy(chunk->vc.begin(), chunk->vc.end(),
+              colors->begin() + static_cast<ptrdiff_t>(chunk->v_base * 3));
+    std::vector<real_t>().swap(chunk->vc);
+  }
+
+  if (chunk->faces_out) {
+    // Parsed in place.
+    for (size_t i = 0; i < chunk->num_leading_faces; i++) {
+      chunk->faces_out[i].smoothing_group_id = chunk->initial_smoothing_id;
+    }
+    return;
+  }
+
+  std::copy(chunk->face_indices.begin(), chunk->face_indices.end(),
+            face_indices->begin() + chunk->face_index_base);
+  vertex_index_vector_t(chunk->face_indices.get_allocator())
+      .swap(chunk->face_indices);
+
+  for (size_t i = 0; i < chunk->faces.size(); i++) {
+    face_t &face = (*faces)[chunk->face_base + i];
+    face = chunk->faces[i];
+    face.vertex_offset += chunk->face_index_base;
+    if (i < chunk->num_leading_faces) {
+      face.smoothing_group_id = chunk->initial_smoothing_id;
+    }
+  }
+  face_vector_t(chunk->faces.get_allocator()).swap(chunk->faces);
+}
+
+// Runs one phase of the chunked parser on every chunk.
+struct obj_chunk_task_t {
+  enum phase_t { COUNT, PARSE, MERGE };
+
+  phase_t phase;
+  bool count_faces;
+  std::vector<obj_chunk_t> *chunks;
+  std::vector<real_t> *colors;
+  face_vector_t *faces;
+  vertex_index_vector_t *face_indices;
+
+  void operator()(size_t i) const {
+    obj_chunk_t *chunk = &(*chunks)[i];
+    if (phase == COUNT) {
+      countObjChunk(chunk, count_faces);
+    } else if (phase == PARSE) {
+      parseObjChunk(chunk);
+    } else {
+      mergeObjChunk(chunk, colors, faces, face_indices);
+    }
+  }
+};
+
+// Runs `task(i)` for i in [0, n), one thread per index.
+template <typename Task>
+static void forEachChunk(size_t n, const Task &task) {
+#ifdef TINYOBJLOADER_USE_THREADS
+  if (n > 1) {
+    std::vector<std::thread> workers;
+    workers.reserve(n - 1);
+    for (size_t i = 1; i < n; i++) {
+      workers.push_back(std::thread([&task, i]() { task(i); }));
+    }
+    task(0);
+    for (size_t i = 0; i < workers.size(); i++) {
+      workers[i].join();
+    }
+    return;
+  }
+#endif
+  for (size_t i = 0; i < n; i++) {
+    task(i);
+  }
+}
+
+// Runs the triangulation jobs [job_begin[i], job_begin[i + 1]) for thread i.
+struct triangulation_task_t {
+  const std::vector<triangulation_job_t> *jobs;
+  const std::vector<size_t> *job_begin;
+  const face_vector_t *faces;
+  const vertex_index_vector_t *face_indices;
+  const std::vector<real_t> *v;
+  std::vector<shape_t> *shapes;
+
+  void operator()(size_t i) const {
+    triangulation_scratch_t scratch;
+    for (size_t k = (*job_begin)[i]; k < (*job_begin)[i + 1]; k++) {
+      const triangulation_job_t &job = (*jobs)[k];
+      triangulateFaces(job, *faces, *face_indices, *v,
+                       &(*shapes)[job.shape].mesh, &scratch);
+    }
+  }
+};
+
+// Runs `jobs` on up to `num_threads` threads, each taking consecutive jobs
+// of about the same number of triangles. Every job writes to its own slots,
+// so the result does not depend on the number of threads.
+static void runTriangulationJobs(const std::vector<triangulation_job_t> &jobs,
+                                 const face_vector_t &faces,
+                                 const vertex_index_vector_t &face_indices,
+                                 const std::vector<real_t> &v,
+                                 std::vector<shape_t> *shapes,
+                                 size_t num_threads) {
+  size_t num_triangles = 0;
+  for (size_t k = 0; k < jobs.size(); k++) {
+    num_triangles += jobs[k].num_triangles;
+  }
+  if (num_threads > jobs.size()) {
+    num_threads = jobs.size();
+  }
+  if (num_threads < 1) {
+    return;
+  }
+
+  std::vector<size_t> job_begin(1, 0);
+  size_t done = 0;
+  for (size_t k = 0; k < jobs.size(); k++) {
+    done += jobs[k].num_triangles;
+    if ((job_begin.size() < num_threads) &&
+        (done * num_threads >= num_triangles * job_begin.size())) {
+      job_begin.push_back(k + 1);
+    }
+  }
+  job_begin.push_back(jobs.size());
+
+  triangulation_task_t task;
+  task.jobs = &jobs;
+  task.job_begin = &job_begin;
+  task.faces = &faces;
+  task.face_indices = &face_indices;
+  task.v = &v;
+  task.shapes = shapes;
+  forEachChunk(job_begin.size() - 1, task);
+}
+
+bool LoadObjFromMemory(attrib_t *attrib, std::vector<shape_t> *shapes,
+                       std::vector<material_t> *materials, std::string *err,
+                       const char *data, size_t len,
+                       MaterialReader *readMatFn /*= NULL*/,
+                       bool triangulate /*= true*/) {
+  load_option_t option;
+  option.triangulate = triangulate;
+  return LoadObjFromMemory(attrib, shapes, materials, err, data, len,
+                           readMatFn, option);
+}
+
+static bool loadObjFromMemory(attrib_t *attrib, std::vector<shape_t> *shapes,
+                              std::vector<material_t> *materials,
+                              std::string *err, const char *data, size_t len,
+                              MaterialReader *readMatFn,
+                              const load_option_t &option,
+                              const scratch_allocator_t &alloc) {
+#ifdef TINYOBJLOADER_USE_ZLIB
+  if (isGzip(data, len)) {
+    return loadGzipObj(attrib, shapes, materials, err, data, len, readMatFn,
+                       option, alloc);
+  }
+#endif
+  return loadObjFromBuffer(attrib, shapes, materials, err, data, len,
+                           readMatFn, option, NULL, alloc);
+}
+
+bool LoadObjFromMemory(attrib_t *attrib, std::vector<shape_t> *shapes,
+                       std::vector<material_t> *materials, std::string *err,
+                       const char *data, size_t len, MaterialReader *readMatFn,
+                       const load_option_t &option) {
+  return loadObjFromMemory(attrib, shapes, materials, err, data, len,
+                           readMatFn, option, scratch_allocator_t());
+}
+
+#ifdef TINYOBJLOADER_USE_PMR
+bool LoadObjFromMemory(attrib_t *attrib, std::vector<shape_t> *shapes,
+                       std::vector<material_t> *materials, std::string *err,
+                       const char *data, size_t len, MaterialReader *readMatFn,
+                       const load_option_t &option,
+                       std::pmr::memory_resource *resource) {
+  return loadObjFromMemory(
+      attrib, shapes, materials, err, data, len, readMatFn, option,
+      scratch_allocator_t(resource ? resource
+                                   : std::pmr::get_default_resource()));
+}
+#endif
+
+#if defined(TINYOBJLOADER_USE_PMR) && defined(TINYOBJLOADER_USE_THREADS)
+// Serializes the allocations of parse threads sharing a memory resource,
+// which need not be thread-safe(e.g. std::pmr::monotonic_buffer_resource).
+class LockedMemoryResource : public std::pmr::memory_resource {
+ public:
+  explicit LockedMemoryResource(std::pmr::memory_resource *upstream)
+      : m_upstream(upstream) {}
+
+ private:
+  virtual void *do_allocate(size_t bytes, size_t alignment) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_upstream->allocate(bytes, alignment);
+  }
+  virtual void do_deallocate(void *p, size_t bytes, size_t alignment) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_upstream->deallocate(p, bytes, alignment);
+  }
+  virtual bool do_is_equal(const std::pmr::memory_resource &other) const
+      noexcept {
+    return this == &other;
+  }
+
+  std::pmr::memory_resource *m_upstream;
+  std::mutex m_mutex;
+};
+#endif
+
+static bool loadObjFromBuffer(attrib_t *attrib, std::vector<shape_t> *shapes,
+                              std::vector<material_t> *materials,
+                              std::string *err, const char *data, size_t len,
+                              MaterialReader *readMatFn,
+                              const load_option_t &option,
+                              const ReadProgress *progress,
+                              const scratch_allocator_t &alloc) {
+  std::stringstream errss;
+  const bool triangulate = option.triangulate;
+  const size_t num_chunks = numParseThreads(len, option.num_threads);
+
+#if defined(TINYOBJLOADER_USE_PMR) && defined(TINYOBJLOADER_USE_THREADS)
+  LockedMemoryResource locked_resource(alloc.resource());
+  const scratch_allocator_t scratch(
+      (num_chunks > 1) ? &locked_resource : alloc.resource());
+#else
+  const scratch_allocator_t scratch(alloc);
+#endif
+
+  // The attribute arrays become the output, so they always use the heap.
+  std::vector<real_t> v;
+  std::vector<real_t> vn;
+  std::vector<real_t> vt;
+  std::vector<real_t> vc;
+  face_vector_t faces(scratch);
+  vertex_index_vector_t face_indices(scratch);
+
+  std::vector<obj_chunk_t> chunks;
+  splitObjChunks(data, len, num_chunks, progress, scratch, &chunks);
+
+  // Relative face indices need the # of attributes defined before each
+  // chunk, so count them first when there is more than one chunk. With
+  // known counts the chunks are parsed straight into the whole-file arrays.
+  const bool counted =
+      (chunks.size() > 1) || (option.precount && !chunks.empty());
+
+  obj_chunk_task_t task;
+  task.count_faces = option.precount;
+  task.chunks = &chunks;
+  task.colors = &vc;
+  task.faces = &faces;
+  task.face_indices = &face_indices;
+
+  if (counted) {
+    task.phase = obj_chunk_task_t::COUNT;
+    forEachChunk(chunks.size(), task);
+    for (size_t i = 1; i < chunks.size(); i++) {
+      chunks[i].v_base = chunks[i - 1].v_base + chunks[i - 1].num_v;
+      chunks[i].vn_base = chunks[i - 1].vn_base + chunks[i - 1].num_vn;
+      chunks[i].vt_base = chunks[i - 1].vt_base + chunks[i - 1].num_vt;
+      chunks[i].face_base = chunks[i - 1].face_base + chunks[i - 1].num_f;
+      chunks[i].face_index_base =
+          chunks[i - 1].face_index_base + chunks[i - 1].num_face_indices;
+    }
+
+    const obj_chunk_t &last = chunks.back();
+    v.resize((last.v_base + last.num_v) * 3);
+    vn.resize((last.vn_base + last.num_vn) * 3);
+    vt.resize((last.vt_base + last.num_vt) * 2);
+    if (option.precount) {
+      faces.resize(last.face_base + last.num_f);
+      face_indices.resize(last.face_index_base + last.num_face_indices);
+    }
+    for (size_t i = 0; i < chunks.size(); i++) {
+      obj_chunk_t &chunk = chunks[i];
+      if (!v.empty()) {
+        chunk.v_out = &v[0] + chunk.v_base * 3;
+      }
+      if (!vn.empty()) {
+        chunk.vn_out = &vn[0] + chunk.vn_base * 3;
+      }
+      if (!vt.empty()) {
+        chunk.vt_out = &vt[0] + chunk.vt_base * 2;
+      }
+      if (!faces.empty()) {
+        chunk.faces_out = &faces[0] + chunk.face_base;
+      }
+      if (!face_indices.empty()) {
+        chunk.face_indices_out = &face_indices[0] + chunk.face_index_base;
+      }
+    }
+  }
+
+  task.phase = obj_chunk_task_t::PARSE;
+  forEachChunk(chunks.size(), task);
+
+  if (!counted) {
+    if (!chunks.empty()) {
+      v.swap(chunks[0].v);
+      vn.swap(chunks[0].vn);
+      vt.swap(chunks[0].vt);
+      vc.swap(chunks[0].vc);
+      faces.swap(chunks[0].faces);
+      face_indices.swap(chunks[0].face_indices);
+    }
+  } else {
+    size_t num_faces = 0;
+    size_t num_face_indices = 0;
+    unsigned int smoothing_id = 0;
+    bool has_colors = false;
+    for (size_t i = 0; i < chunks.size(); i++) {
+      obj_chunk_t &chunk = chunks[i];
+      has_colors = has_colors || chunk.has_colors;
+      if (!option.precount) {
+        chunk.face_base = num_faces;
+        chunk.face_index_base = num_face_indices;
+        num_faces += chunk.num_f;
+        num_face_indices += chunk.num_face_indices;
+      }
+      chunk.initial_smoothing_id = smoothing_id;
+      if (chunk.has_smoothing_group) {
+        smoothing_id = chunk.last_smoothing_id;
+      }
+    }
+    if (!option.precount) {
+      faces.resize(num_faces);
+      face_indices.resize(num_face_indices);
+    }
+    if (has_colors) {
+      vc.resize(v.size(), static_cast<real_t>(1.0));
+    }
+
+    task.phase = obj_chunk_task_t::MERGE;
+    forEachChunk(chunks.size(), task);
+  }
+
+  // Replay grouping commands in file order.
+  const size_t first_shape = shapes->size();
+  shape_builder_t builder;
+  builder.triangulate = triangulate;
+  builder.split_indices = option.split_indices || option.narrow_indices;
+  builder.readMatFn = readMatFn;
+  builder.materials = materials;
+  builder.err = err;
+  std::vector<triangulation_job_t> triangulation_jobs;
+  builder.jobs = &triangulation_jobs;
+
+  // Reserve each shape for all faces up to the next `g` or `o` line, so that
+  // it is built without regrowing and handed over without a copy.
+  scratch_vector<size_t>::type shape_ends(scratch);
+  for (size_t c = 0; c < chunks.size(); c++) {
+    for (size_t k = 0; k < chunks[c].commands.size(); k++) {
+      const obj_command_t &command = chunks[c].commands[k];
+      if ((command.type == COMMAND_GROUP) ||
+          (command.type == COMMAND_OBJECT)) {
+        shape_ends.push_back(chunks[c].face_base + command.face_offset);
+      }
+    }
+  }
+  shape_ends.push_back(faces.size());
+  builder.shape_ends = &shape_ends;
+  builder.beginShape(faces, face_indices, 0);
+
+  for (size_t c = 0; c < chunks.size(); c++) {
+    const obj_chunk_t &chunk = chunks[c];
+    for (size_t k = 0; k < chunk.commands.size(); k++) {
+      builder.replay(chunk.commands[k],
+                     chunk.face_base + chunk.commands[k].face_offset, faces,
+                     face_indices, v, shapes);
+    }
+
+    if (chunk.failed) {
+      if (err) {
+        (*err) = "Failed parse `f' line(e.g. zero value for face index).\n";
+      }
+      // Finish the shapes built so far, but not the one being built.
+      while (!triangulation_jobs.empty() &&
+             (triangulation_jobs.back().shape >= shapes->size())) {
+        triangulation_jobs.pop_back();
+      }
+      runTriangulationJobs(triangulation_jobs, faces, face_indices, v, shapes,
+                           chunks.size());
+      return false;
+    }
+  }
+
+  builder.finish(faces, face_indices, v, shapes);
+  runTriangulationJobs(triangulation_jobs, faces, face_indices, v, shapes,
+                       chunks.size());
+  if (option.narrow_indices) {
+    for (size_t i = first_shape; i < shapes->size(); i++) {
+      narrowMesh(&(*shapes)[i].mesh);
+    }
   }
-  faceGroup.clear();  // for safety
 
   if (err) {
     (*err) += errss.str();
@@ -2046,10 +7065,379 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
   attrib->normals.swap(vn);
   attrib->texcoords.swap(vt);
   attrib->colors.swap(vc);
+  attrib->has_colors = !attrib->colors.empty();
+
+  return true;
+}
+
+#ifdef TINYOBJLOADER_USE_ZLIB
+// Parses a gzip compressed .obj, while it is being inflated when threads are
+// available.
+static bool loadGzipObj(attrib_t *attrib, std::vector<shape_t> *shapes,
+                        std::vector<material_t> *materials, std::string *err,
+                        const char *data, size_t len, MaterialReader *readMatFn,
+                        const load_option_t &option,
+                        const scratch_allocator_t &alloc) {
+#ifdef TINYOBJLOADER_USE_THREADS
+  if (gzipSizeHint(data, len) > 0) {
+    size_t num_shapes = shapes->size();
+    size_t num_materials = materials->size();
+    size_t err_len = err ? err->size() : 0;
+
+    GzipReadAhead ahead(data, len);
+    ahead.start();
+    bool ret = loadObjFromBuffer(attrib, shapes, materials, err, ahead.data(),
+                                 ahead.size(), readMatFn, option, &ahead,
+                                 alloc);
+    if (ahead.complete()) {
+      return ret;
+    }
+
+    // The hinted size was wrong(e.g. > 4GB) or the data is corrupt:
+    // start over with all of the inflated data.
+    shapes->resize(num_shapes);
+    materials->resize(num_materials);
+    if (err) {
+      err->resize(err_len);
+    }
+  }
+#endif
+
+  std::vector<char> buf;
+  if (!inflateGzip(data, len, &buf)) {
+    if (err) {
+      (*err) += "Cannot inflate gzip data.\n";
+    }
+    return false;
+  }
+  return loadObjFromBuffer(attrib, shapes, materials, err,
+                           buf.empty() ? NULL : &buf.at(0), buf.size(),
+                           readMatFn, option, NULL, alloc);
+}
+#endif  // TINYOBJLOADER_USE_ZLIB
+
+// ObjStreamReader reads and parses the input in blocks of whole lines of
+// about this size.
+static const size_t kStreamBlockSize = 1024 * 1024;
+
+// Returns the position of attribute `idx`(`n` reals each) of `src` in `dst`,
+// copying it there on first use. `map` holds the positions of attributes
+// copied so far(-1 = not copied) and `used` lists them.
+static int remapAttrib(int idx, size_t n, const std::vector<real_t> &src,
+                       std::vector<real_t> *dst, std::vector<int> *map,
+                       std::vector<int> *used) {
+  if ((idx < 0) || (static_cast<size_t>(idx) >= map->size())) {
+    return -1;  // No attribute, or one that has not been defined(yet).
+  }
+  int &pos = (*map)[static_cast<size_t>(idx)];
+  if (pos < 0) {
+    pos = static_cast<int>(dst->size() / n);
+    dst->insert(dst->end(), src.begin() + static_cast<ptrdiff_t>(idx * n),
+                src.begin() + static_cast<ptrdiff_t>((idx + 1) * n));
+    used->push_back(idx);
+  }
+  return pos;
+}
+
+struct ObjStreamReader::Impl {
+  std::ifstream file;
+  std::istream *stream;
+  MaterialFileReader matFileReader;
+  bool triangulate;
+  bool narrow_indices;
+
+  // Input that has been read but not parsed yet. Starts at a line boundary.
+  std::vector<char> buf;
+  size_t buf_len;
+  bool eof;
+  bool failed;
+
+  attrib_t attrib;
+  std::vector<material_t> materials;
+  std::string err;
+
+  // Faces of the shape being built.
+  face_vector_t faces;
+  vertex_index_vector_t face_indices;
+  unsigned int smoothing_id;
+  shape_builder_t builder;
+
+  // Finished shapes not yet returned by Next().
+  std::vector<shape_t> shapes;
+  size_t next_shape;
+
+  // Used by extractAttrib().
+  std::vector<int> v_map;
+  std::vector<int> vn_map;
+  std::vector<int> vt_map;
+  std::vector<int> used;
+
+  Impl()
+      : stream(NULL),
+        matFileReader(""),
+        triangulate(true),
+        narrow_indices(false),
+        buf_len(0),
+        eof(true),
+        failed(false),
+        smoothing_id(0),
+        next_shape(0) {}
+
+  void start(std::istream *inStream, MaterialReader *readMatFn,
+             const load_option_t &option) {
+    stream = inStream;
+    eof = false;
+    triangulate = option.triangulate;
+    builder.triangulate = option.triangulate;
+    builder.split_indices = option.split_indices || option.narrow_indices;
+    narrow_indices = option.narrow_indices;
+    builder.readMatFn = readMatFn;
+    builder.materials = &materials;
+    builder.err = &err;
+  }
+
+  // Reads and parses the next block of whole lines. Returns false at the end
+  // of the input or after a parse error.
+  bool readBlock() {
+    if (eof || failed) {
+      return false;
+    }
+
+    for (;;) {
+      const size_t begin = buf_len;
+      buf.resize(buf_len + kStreamBlockSize);
+      stream->read(&buf.at(buf_len),
+                   static_cast<std::streamsize>(kStreamBlockSize));
+      buf_len += static_cast<size_t>(stream->gcount());
+
+      if (!(*stream)) {
+        eof = true;
+        parseBlock(buf_len);
+        buf_len = 0;
+        if (!failed) {
+          builder.finish(faces, face_indices, attrib.vertices, &shapes);
+        }
+        return true;
+      }
+
+      // Parse up to the last line break and keep the rest for the next block.
+      size_t split = buf_len;
+      while ((split > begin) && (buf[split - 1] != '\n') &&
+             (buf[split - 1] != '\r')) {
+        split--;
+      }
+      if (split == begin) {
+        continue;  // No line break yet.
+      }
+
+      parseBlock(split);
+      buf_len -= split;
+      memmove(&buf[0], &buf[0] + split, buf_len);
+      return true;
+    }
+  }
+
+  // Parses the first `len` bytes of `buf` and replays their commands.
+  void parseBlock(size_t len) {
+    if (len == 0) {
+      return;
+    }
+
+    obj_chunk_t chunk;
+    chunk.begin = &buf.at(0);
+    chunk.end = chunk.begin + len;
+    chunk.v_base = attrib.vertices.size() / 3;
+    chunk.vn_base = attrib.normals.size() / 3;
+    chunk.vt_base = attrib.texcoords.size() / 2;
+    parseObjChunk(&chunk);
+
+    attrib.vertices.insert(attrib.vertices.end(), chunk.v.begin(),
+                           chunk.v.end());
+    if (chunk.has_colors || attrib.has_colors) {
+      // Backfill the vertices before the first color.
+      attrib.colors.resize(chunk.v_base * 3, static_cast<real_t>(1.0));
+      attrib.colors.insert(attrib.colors.end(), chunk.vc.begin(),
+                           chunk.vc.end());
+      attrib.colors.resize(attrib.vertices.size(), static_cast<real_t>(1.0));
+      attrib.has_colors = true;
+    }
+    attrib.normals.insert(attrib.normals.end(), chunk.vn.begin(),
+                          chunk.vn.end());
+    attrib.texcoords.insert(attrib.texcoords.end(), chunk.vt.begin(),
+                            chunk.vt.end());
+
+    const size_t face_base = faces.size();
+    const size_t index_base = face_indices.size();
+    face_indices.insert(face_indices.end(), chunk.face_indices.begin(),
+                        chunk.face_indices.end());
+    for (size_t i = 0; i < chunk.faces.size(); i++) {
+      face_t face = chunk.faces[i];
+      face.vertex_offset += index_base;
+      if (i < chunk.num_leading_faces) {
+        face.smoothing_group_id = smoothing_id;
+      }
+      faces.push_back(face);
+    }
+    if (chunk.has_smoothing_group) {
+      smoothing_id = chunk.last_smoothing_id;
+    }
+
+    for (size_t k = 0; k < chunk.commands.size(); k++) {
+      builder.replay(chunk.commands[k],
+                     face_base + chunk.commands[k].face_offset, faces,
+                     face_indices, attrib.vertices, &shapes);
+    }
+
+    if (chunk.failed) {
+      err += "Failed parse `f' line(e.g. zero value for face index).\n";
+      failed = true;
+      return;
+    }
+
+    // Drop the faces which have already been exported.
+    if (builder.group_begin > 0) {
+      const size_t first_index = (builder.group_begin < faces.size())
+                                     ? faces[builder.group_begin].vertex_offset
+                                     : face_indices.size();
+      faces.erase(faces.begin(),
+                  faces.begin() + static_cast<ptrdiff_t>(builder.group_begin));
+      face_indices.erase(
+          face_indices.begin(),
+          face_indices.begin() + static_cast<ptrdiff_t>(first_index));
+      for (size_t i = 0; i < faces.size(); i++) {
+        faces[i].vertex_offset -= first_index;
+      }
+      builder.group_begin = 0;
+    }
+  }
+
+  // Remaps one attribute index of `mesh`: `member` of `mesh->indices`, or
+  // `split` with `load_option_t::split_indices`. The attributes copied to
+  // `dst` are listed in `used`.
+  void remapIndices(mesh_t *mesh, int index_t::*member,
+                    std::vector<int> *split, size_t n,
+                    const std::vector<real_t> &src, std::vector<real_t> *dst,
+                    std::vector<int> *map) {
+    used.clear();
+    std::vector<index_t> &indices = mesh->indices;
+    for (size_t i = 0; i < indices.size(); i++) {
+      indices[i].*member =
+          remapAttrib(indices[i].*member, n, src, dst, map, &used);
+    }
+    for (size_t i = 0; i < split->size(); i++) {
+      (*split)[i] = remapAttrib((*split)[i], n, src, dst, map, &used);
+    }
+  }
+
+  // Copies the attributes referenced by `shape` to `out` and makes the
+  // indices of `shape` refer to them.
+  void extractAttrib(shape_t *shape, attrib_t *out) {
+    out->vertices.clear();
+    out->normals.clear();
+    out->texcoords.clear();
+    out->colors.clear();
+
+    v_map.resize(attrib.vertices.size() / 3, -1);
+    vn_map.resize(attrib.normals.size() / 3, -1);
+    vt_map.resize(attrib.texcoords.size() / 2, -1);
+
+    mesh_t &mesh = shape->mesh;
+    remapIndices(&mesh, &index_t::vertex_index, &mesh.vertex_indices, 3,
+                 attrib.vertices, &out->vertices, &v_map);
+    out->has_colors = attrib.has_colors;
+    if (attrib.has_colors) {
+      for (size_t i = 0; i < used.size(); i++) {
+        size_t k = static_cast<size_t>(used[i]) * 3;
+        out->colors.insert(out->colors.end(), attrib.colors.begin() + k,
+                           attrib.colors.begin() + k + 3);
+      }
+    }
+    for (size_t i = 0; i < used.size(); i++) {
+      v_map[static_cast<size_t>(used[i])] = -1;
+    }
+
+    remapIndices(&mesh, &index_t::normal_index, &mesh.normal_indices, 3,
+                 attrib.normals, &out->normals, &vn_map);
+    for (size_t i = 0; i < used.size(); i++) {
+      vn_map[static_cast<size_t>(used[i])] = -1;
+    }
+
+    remapIndices(&mesh, &index_t::texcoord_index, &mesh.texcoord_indices, 2,
+                 attrib.texcoords, &out->texcoords, &vt_map);
+    for (size_t i = 0; i < used.size(); i++) {
+      vt_map[static_cast<size_t>(used[i])] = -1;
+    }
+  }
+};
+
+ObjStreamReader::ObjStreamReader() : m_impl(new Impl()) {}
+
+ObjStreamReader::~ObjStreamReader() { delete m_impl; }
+
+bool ObjStreamReader::Open(const char *filename, const char *mtl_basedir,
+                           const load_option_t &option) {
+  delete m_impl;
+  m_impl = new Impl();
+
+  m_impl->file.open(filename, std::ios::in | std::ios::binary);
+  if (!m_impl->file) {
+    std::stringstream errss;
+    errss << "Cannot open file [" << filename << "]" << std::endl;
+    m_impl->err = errss.str();
+    return false;
+  }
+
+  m_impl->matFileReader = MaterialFileReader(mtl_basedir ? mtl_basedir : "",
+                                             option.cache_materials);
+  m_impl->start(&m_impl->file, &m_impl->matFileReader, option);
+  return true;
+}
+
+bool ObjStreamReader::Open(std::istream *inStream, MaterialReader *readMatFn,
+                           const load_option_t &option) {
+  delete m_impl;
+  m_impl = new Impl();
+
+  if (!inStream) {
+    return false;
+  }
+  m_impl->start(inStream, readMatFn, option);
+  return true;
+}
+
+bool ObjStreamReader::Next(shape_t *shape, attrib_t *shape_attrib) {
+  Impl &impl = *m_impl;
+  while (impl.next_shape >= impl.shapes.size()) {
+    impl.shapes.clear();
+    impl.next_shape = 0;
+    if (!impl.readBlock()) {
+      return false;
+    }
+  }
 
+  (*shape) = shape_t();
+  swapShape(shape, &impl.shapes[impl.next_shape]);
+  impl.next_shape++;
+
+  if (shape_attrib) {
+    impl.extractAttrib(shape, shape_attrib);
+  }
+  if (impl.narrow_indices) {
+    narrowMesh(&shape->mesh);
+  }
   return true;
 }
 
+const attrib_t &ObjStreamReader::GetAttrib() const { return m_impl->attrib; }
+
+const std::vector<material_t> &ObjStreamReader::GetMaterials() const {
+  return m_impl->materials;
+}
+
+const std::string &ObjStreamReader::GetError() const { return m_impl->err; }
+
+bool ObjStreamReader::Failed() const { return m_impl->failed; }
+
 bool LoadObjWithCallback(std::istream &inStream, const callback_t &callback,
                          void *user_data /*= NULL*/,
                          MaterialReader *readMatFn /*= NULL*/,
@@ -2067,31 +7455,24 @@ bool LoadObjWithCallback(std::istream &inStream, const callback_t &callback,
   std::string name;
   std::vector<const char *> names_out;
 
-  std::string linebuf;
-  while (inStream.peek() != -1) {
-    safeGetline(inStream, linebuf);
-
-    // Trim newline '\r\n' or '\n'
-    if (linebuf.size() > 0) {
-      if (linebuf[linebuf.size() - 1] == '\n')
-        linebuf.erase(linebuf.size() - 1);
-    }
-    if (linebuf.size() > 0) {
-      if (linebuf[linebuf.size() - 1] == '\r')
-        linebuf.erase(linebuf.size() - 1);
-    }
+  std::vector<char> buf;
+  ReadStreamToBuffer(inStream, &buf);
 
+  LineReader lines(buf.empty() ? NULL : &buf.at(0), buf.size());
+  const char *line;
+  const char *line_end;
+  while (lines.next(&line, &line_end)) {
     // Skip if empty line.
-    if (linebuf.empty()) {
+    if (line == line_end) {
       continue;
     }
 
     // Skip leading space.
-    const char *token = linebuf.c_str();
-    token += strspn(token, " \t");
+    const char *token = line;
+    token = skipSpace(token);
 
     assert(token);
-    if (token[0] == '\0') continue;  // empty line
+    if (IS_NEW_LINE(token[0])) continue;  // empty line
 
     if (token[0] == '#') continue;  // comment line
 
@@ -2132,7 +7513,7 @@ bool LoadObjWithCallback(std::istream &inStream, const callback_t &callback,
     // face
     if (token[0] == 'f' && IS_SPACE((token[1]))) {
       token += 2;
-      token += strspn(token, " \t");
+      token = skipSpace(token);
 
       indices.clear();
       while (!IS_NEW_LINE(token[0])) {
@@ -2144,8 +7525,7 @@ bool LoadObjWithCallback(std::istream &inStream, const callback_t &callback,
         idx.texcoord_index = vi.vt_idx;
 
         indices.push_back(idx);
-        size_t n = strspn(token, " \t\r");
-        token += n;
+        token = skipSeparator(token);
       }
 
       if (callback.index_cb && indices.size() > 0) {
@@ -2159,9 +7539,7 @@ bool LoadObjWithCallback(std::istream &inStream, const callback_t &callback,
     // use mtl
     if ((0 == strncmp(token, "usemtl", 6)) && IS_SPACE((token[6]))) {
       token += 7;
-      std::stringstream ss;
-      ss << token;
-      std::string namebuf = ss.str();
+      std::string namebuf(token, line_end);
 
       int newMaterialId = -1;
       if (material_map.find(namebuf) != material_map.end()) {
@@ -2187,7 +7565,7 @@ bool LoadObjWithCallback(std::istream &inStream, const callback_t &callback,
         token += 7;
 
         std::vector<std::string> filenames;
-        SplitString(std::string(token), ' ', filenames);
+        SplitString(std::string(token, line_end), ' ', filenames);
 
         if (filenames.empty()) {
           if (err) {
@@ -2236,7 +7614,7 @@ bool LoadObjWithCallback(std::istream &inStream, const callback_t &callback,
       while (!IS_NEW_LINE(token[0])) {
         std::string str = parseString(&token);
         names.push_back(str);
-        token += strspn(token, " \t\r");  // skip tag
+        token = skipSeparator(token);  // skip tag
       }
 
       assert(names.size() > 0);
@@ -2271,9 +7649,7 @@ bool LoadObjWithCallback(std::istream &inStream, const callback_t &callback,
       // @todo { multiple object name? }
       token += 2;
 
-      std::stringstream ss;
-      ss << token;
-      std::string object_name = ss.str();
+      std::string object_name(token, line_end);
 
       if (callback.object_cb) {
         callback.object_cb(user_data, object_name.c_str());
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <cstdint>
 #include <limits>
+#include <utility>
 
 using u8 = std::uint8_t;
 using u32 = std::uint32_t;
@@ -161,11 +162,12 @@ int main(const int argc, const char** argv) {
     std::vector<OKMesh>   overkillMeshes;
 
     overkillVertices.resize(attrib.vertices.size() / 3 );
+    overkillMeshes.reserve(shapes.size());
 
 
-    for (auto shape: shapes)
+    for (const auto& shape: shapes)
     {
-        auto& mesh = shape.mesh;
+        const auto& mesh = shape.mesh;
 
         auto overkillMesh = OKMesh{};
 
@@ -429,7 +431,7 @@ int main(const int argc, const char** argv) {
         overkillMaterial.m_unimaps.push_back(UniformTexture {"map_displacement", meshMaterial.displacement_texname});
 
 
-        overkillMesh.material = overkillMaterial;
+        overkillMesh.material = std::move(overkillMaterial);
     /*
         PBR = Physically based rendering.. Leaving these features commented out for now, since I want to focus only 
                 on core material properties. Hopefully I will get back to this soon. JSolsvik 08.05.2018
@@ -449,7 +451,7 @@ int main(const int argc, const char** argv) {
         printf("  material.norm   = %s\n", materials[i].normal_texname.c_str());
     */
 
-        overkillMeshes.push_back(overkillMesh);
+        overkillMeshes.push_back(std::move(overkillMesh));
 
     } // END FOR MESHES
 